@@ -0,0 +1,198 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <deque>
+#include <iostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "./../ext/headers/args.hxx"
+#include "analytic_system.h"
+#include "binary_trace.h"
+
+// this will not be used in a library file so it's ok to do this
+using namespace dramsim3;
+
+namespace {
+
+const uint64_t kNoLatency = 0;
+
+struct RunResult {
+    std::vector<uint64_t> latency;  // per trace index, kNoLatency if none
+    double seconds;
+    uint64_t reads_done;
+};
+
+// Replay the trace with the same back pressure as TraceBasedCPU and record
+// the latency of every read. |model| gets the uncorrected latency of the
+// analytic model if the system is one.
+RunResult Replay(BaseDRAMSystem &system, const std::vector<Transaction> &trace,
+                 uint64_t cycles, std::vector<uint64_t> *model) {
+    RunResult result;
+    result.latency.assign(trace.size(), kNoLatency);
+    result.reads_done = 0;
+    AnalyticDRAMSystem *analytic = dynamic_cast<AnalyticDRAMSystem *>(&system);
+    std::vector<uint64_t> issued(trace.size(), 0);
+    // reads to the same address complete in order
+    std::unordered_map<uint64_t, std::deque<size_t>> outstanding;
+    std::vector<DoneTransaction> done;
+
+    auto start = std::chrono::steady_clock::now();
+    size_t next = 0;
+    uint64_t clk = 0;
+    while (clk < cycles) {
+        while (next < trace.size() && trace[next].added_cycle <= clk &&
+               system.WillAcceptTransaction(trace[next].addr,
+                                            trace[next].is_write)) {
+            const Transaction &trans = trace[next];
+            system.AddTransaction(trans.addr, trans.is_write);
+            if (!trans.is_write) {
+                issued[next] = clk;
+                outstanding[trans.addr].push_back(next);
+                if (analytic) {
+                    (*model)[next] = analytic->LastReadModelLatency();
+                }
+            }
+            next++;
+        }
+        // an event driven model can sleep until it or the trace has news
+        uint64_t until = clk + 1;
+        if (analytic) {
+            until = std::max(until, system.NextEventCycle());
+            if (next < trace.size()) {
+                until = std::min(until, std::max(clk + 1,
+                                                 trace[next].added_cycle));
+            }
+            until = std::min(until, cycles);
+        }
+        done.clear();
+        system.ClockTicks(until - clk, done);
+        clk = until;
+        for (const auto &trans : done) {
+            if (trans.is_write) {
+                continue;
+            }
+            auto &queue = outstanding[trans.addr];
+            if (queue.empty()) {
+                continue;
+            }
+            size_t index = queue.front();
+            queue.pop_front();
+            result.latency[index] = trans.cycle - issued[index];
+            result.reads_done++;
+        }
+    }
+    std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - start;
+    result.seconds = elapsed.count();
+    return result;
+}
+
+}  // namespace
+
+// Fit the analytic model to the cycle accurate JEDEC model on a short
+// trace: both replay the same trace, and the read latencies of the
+// analytic model are mapped onto the JEDEC ones by least squares.
+int main(int argc, const char **argv) {
+    args::ArgumentParser parser(
+        "Calibrate the analytic DRAM model against the JEDEC model.",
+        "Examples: \n"
+        "./build/analyticcalib configs/DDR4_8Gb_x8_3200.ini -c 100000 -t "
+        "sample_trace.txt\n"
+        "Paste the printed lines into the [system] section of the config.");
+    args::HelpFlag help(parser, "help", "Display the help menu", {'h', "help"});
+    args::ValueFlag<uint64_t> num_cycles_arg(parser, "num_cycles",
+                                             "Number of cycles to simulate",
+                                             {'c', "cycles"}, 100000);
+    args::ValueFlag<std::string> trace_file_arg(
+        parser, "trace", "Trace file (text or binary, mandatory)",
+        {'t', "trace"});
+    args::Positional<std::string> config_arg(
+        parser, "config", "The config file name (mandatory)");
+
+    try {
+        parser.ParseCLI(argc, argv);
+    } catch (args::Help) {
+        std::cout << parser;
+        return 0;
+    } catch (args::ParseError e) {
+        std::cerr << e.what() << std::endl;
+        std::cerr << parser;
+        return 1;
+    }
+
+    std::string config_file = args::get(config_arg);
+    std::string trace_file = args::get(trace_file_arg);
+    if (config_file.empty() || trace_file.empty()) {
+        std::cerr << parser;
+        return 1;
+    }
+    uint64_t cycles = args::get(num_cycles_arg);
+
+    Config config(config_file, ".");
+    if (config.IsHMC()) {
+        std::cerr << "HMC configs are not supported" << std::endl;
+        return 1;
+    }
+    // no stats files, and fit the raw model
+    config.output_level = 0;
+    config.analytic_latency_scale = 1.0;
+    config.analytic_latency_offset = 0.0;
+    std::vector<Transaction> trace = LoadTrace(trace_file, cycles);
+    auto callback = [](uint64_t addr) {};
+
+    JedecDRAMSystem jedec(config, ".", callback, callback);
+    RunResult reference = Replay(jedec, trace, cycles, nullptr);
+    std::vector<uint64_t> model(trace.size(), kNoLatency);
+    AnalyticDRAMSystem analytic(config, ".", callback, callback);
+    RunResult raw = Replay(analytic, trace, cycles, &model);
+
+    // latency = scale * model + offset over the reads both models finished,
+    // reads forwarded from the write buffer carry no information
+    double n = 0, sx = 0, sy = 0, sxx = 0, sxy = 0;
+    for (size_t i = 0; i < trace.size(); i++) {
+        if (reference.latency[i] == kNoLatency ||
+            raw.latency[i] == kNoLatency || model[i] == kNoLatency) {
+            continue;
+        }
+        double x = static_cast<double>(model[i]);
+        double y = static_cast<double>(reference.latency[i]);
+        n += 1;
+        sx += x;
+        sy += y;
+        sxx += x * x;
+        sxy += x * y;
+    }
+    if (n < 2) {
+        std::cerr << "too few reads finished to calibrate, use a longer run"
+                  << std::endl;
+        return 1;
+    }
+    double var = n * sxx - sx * sx;
+    double scale = var > 0 ? (n * sxy - sx * sy) / var : 1.0;
+    double offset = (sy - scale * sx) / n;
+
+    double raw_error = 0, fit_error = 0;
+    for (size_t i = 0; i < trace.size(); i++) {
+        if (reference.latency[i] == kNoLatency ||
+            raw.latency[i] == kNoLatency || model[i] == kNoLatency) {
+            continue;
+        }
+        double y = static_cast<double>(reference.latency[i]);
+        raw_error += std::fabs(model[i] - y);
+        fit_error += std::fabs(scale * model[i] + offset - y);
+    }
+
+    std::cout << "reads compared:        " << n << std::endl;
+    std::cout << "JEDEC mean latency:    " << sy / n << " cycles, "
+              << reference.seconds << " s" << std::endl;
+    std::cout << "analytic mean latency: " << sx / n << " cycles, "
+              << raw.seconds << " s" << std::endl;
+    std::cout << "mean abs error:        " << raw_error / n << " raw, "
+              << fit_error / n << " fitted" << std::endl;
+    std::cout << std::endl << "[system]" << std::endl;
+    std::cout << "memory_model = ANALYTIC" << std::endl;
+    std::cout << "analytic_latency_scale = " << scale << std::endl;
+    std::cout << "analytic_latency_offset = " << offset << std::endl;
+    return 0;
+}
@@ -0,0 +1,490 @@
+#include "analytic_system.h"
+
+#include <algorithm>
+#include <iterator>
+#include <limits>
+
+namespace dramsim3 {
+
+AnalyticDRAMSystem::AnalyticDRAMSystem(
+    const Config &config, const std::string &output_dir,
+    std::function<void(uint64_t)> read_callback,
+    std::function<void(uint64_t)> write_callback)
+    : BaseDRAMSystem(config, output_dir, read_callback, write_callback),
+      banks_per_rank_(config_.banks),
+      close_page_(config_.row_buf_policy == "CLOSE_PAGE"),
+      latency_scale_(config_.analytic_latency_scale),
+      latency_offset_(config_.analytic_latency_offset),
+      refresh_interval_(static_cast<uint64_t>(config_.tREFI)),
+      seq_(0),
+      last_read_latency_(0),
+      last_trans_clk_(config_.channels, 0),
+      banks_(config_.channels * config_.ranks * config_.banks,
+             BankTiming{-1, 0, 0, 0}),
+      ranks_(config_.channels * config_.ranks,
+             RankTiming{0, 0, {}}),
+      channels_(config_.channels, ChannelTiming{{}, 0, 0, 0, {}}) {
+    if (config_.IsHMC()) {
+        std::cerr << "Initialized a memory system with an HMC config file!"
+                  << std::endl;
+        AbruptExit(__FILE__, __LINE__);
+    }
+
+    // same refresh spacing as the Refresh of the JEDEC controllers, bank
+    // level refresh is approximated by staggered rank refresh
+    for (int c = 0; c < config_.channels; c++) {
+        for (int r = 0; r < config_.ranks; r++) {
+            uint64_t first = refresh_interval_;
+            if (config_.refresh_policy !=
+                RefreshPolicy::RANK_LEVEL_SIMULTANEOUS) {
+                first = refresh_interval_ * (r + 1) / config_.ranks;
+            }
+            ranks_[c * config_.ranks + r].next_refresh = first;
+        }
+    }
+
+    stats_.reserve(config_.channels);
+    for (int i = 0; i < config_.channels; i++) {
+        stats_.emplace_back(config_, i);
+    }
+    const SimpleStats &stats = stats_[0];
+    stat_.num_cycles = stats.GetStatId("num_cycles");
+    stat_.epoch_num = stats.GetStatId("epoch_num");
+    stat_.num_reads_done = stats.GetStatId("num_reads_done");
+    stat_.num_writes_done = stats.GetStatId("num_writes_done");
+    stat_.num_write_buf_hits = stats.GetStatId("num_write_buf_hits");
+    stat_.num_write_coalesced = stats.GetStatId("num_write_coalesced");
+    stat_.num_read_cmds = stats.GetStatId("num_read_cmds");
+    stat_.num_read_row_hits = stats.GetStatId("num_read_row_hits");
+    stat_.num_write_cmds = stats.GetStatId("num_write_cmds");
+    stat_.num_write_row_hits = stats.GetStatId("num_write_row_hits");
+    stat_.num_act_cmds = stats.GetStatId("num_act_cmds");
+    stat_.num_pre_cmds = stats.GetStatId("num_pre_cmds");
+    stat_.num_ref_cmds = stats.GetStatId("num_ref_cmds");
+    stat_.all_bank_idle_cycles = stats.GetStatId("all_bank_idle_cycles");
+    stat_.rank_active_cycles = stats.GetStatId("rank_active_cycles");
+    stat_.read_latency = stats.GetStatId("read_latency");
+    stat_.interarrival_latency = stats.GetStatId("interarrival_latency");
+    if (config_.num_requesters > 0) {
+        stat_.req_reads_done = stats.GetStatId("requester_reads_done");
+        stat_.req_writes_done = stats.GetStatId("requester_writes_done");
+        stat_.req_read_row_hits = stats.GetStatId("requester_read_row_hits");
+        for (int i = 0; i < config_.num_requesters; i++) {
+            stat_.req_read_latency.push_back(stats.GetStatId(
+                "requester_read_latency." + std::to_string(i)));
+        }
+    }
+}
+
+AnalyticDRAMSystem::~AnalyticDRAMSystem() {}
+
+AnalyticDRAMSystem::BankTiming &AnalyticDRAMSystem::Bank(
+    const Address &addr) {
+    int rank = addr.channel * config_.ranks + addr.rank;
+    int bank = addr.bankgroup * config_.banks_per_group + addr.bank;
+    return banks_[rank * banks_per_rank_ + bank];
+}
+
+bool AnalyticDRAMSystem::WillAcceptTransaction(uint64_t hex_addr,
+                                               bool is_write) const {
+    // transactions occupy the queues until their column command issues
+    const ChannelTiming &chan = channels_[GetChannel(hex_addr)];
+    if (config_.unified_queue) {
+        return chan.queued_reads + chan.queued_writes <
+               config_.trans_queue_size;
+    }
+    if (is_write) {
+        auto pending = pending_writes_.find(config_.LineAddress(hex_addr));
+        if (pending != pending_writes_.end() && pending->second.buffered) {
+            return true;  // merges into the buffered write of its line
+        }
+    }
+    int queued = is_write ? chan.queued_writes : chan.queued_reads;
+    return queued < config_.trans_queue_size;
+}
+
+bool AnalyticDRAMSystem::AddTransaction(uint64_t hex_addr, bool is_write,
+                                        uint64_t id, int requester) {
+    Address addr = config_.AddressMapping(hex_addr);
+    int channel = addr.channel;
+    TraceTransaction(channel, hex_addr, is_write);
+    ChannelTiming &chan = channels_[channel];
+    stats_[channel].AddValue(stat_.interarrival_latency,
+                             clk_ - last_trans_clk_[channel]);
+    last_trans_clk_[channel] = clk_;
+    last_req_clk_ = clk_;
+
+    Transaction trans(hex_addr, is_write, id);
+    trans.requester = requester;
+    // buffered writes are kept per line, like the controllers do
+    uint64_t line = config_.LineAddress(hex_addr);
+    auto pending = pending_writes_.find(line);
+    if (is_write) {
+        // writes are acknowledged once buffered, like the controllers do
+        PushEvent(clk_ + 1, trans, channel, EventType::WRITE_DONE);
+        if (pending != pending_writes_.end() && pending->second.buffered) {
+            stats_[channel].Increment(stat_.num_write_coalesced);
+            return true;
+        }
+        pending_writes_[line].buffered = true;
+        chan.queued_writes++;
+        chan.write_buffer.push_back(line);
+        MaybeDrainWrites(channel);
+        return true;
+    }
+
+    if (pending != pending_writes_.end()) {
+        // served from the write buffer
+        stats_[channel].Increment(stat_.num_write_buf_hits);
+        last_read_latency_ = 0;
+        PushEvent(clk_ + 1, trans, channel, EventType::READ_DONE);
+        return true;
+    }
+    MaybeDrainWrites(channel);
+    chan.queued_reads++;
+    auto timing = ScheduleAccess(addr, false, requester);
+    PushEvent(timing.first, trans, channel, EventType::READ_ISSUED);
+
+    last_read_latency_ = timing.second - clk_;
+    double latency = latency_scale_ * last_read_latency_ + latency_offset_;
+    uint64_t cycles = latency < 1.0 ? 1 : static_cast<uint64_t>(latency + 0.5);
+    PushEvent(clk_ + cycles, trans, channel, EventType::READ_DONE);
+    return true;
+}
+
+void AnalyticDRAMSystem::MaybeDrainWrites(int channel) {
+    // same thresholds as Controller::ScheduleTransaction, with an idle
+    // data bus standing in for an empty command queue
+    ChannelTiming &chan = channels_[channel];
+    int buffered = static_cast<int>(chan.write_buffer.size());
+    if (buffered <= config_.write_low_watermark ||
+        (buffered < config_.write_high_watermark &&
+         (buffered <= config_.write_idle_drain || chan.bus_free > clk_))) {
+        return;
+    }
+    // the oldest ones go, down to the low watermark
+    auto end = chan.write_buffer.end() - config_.write_low_watermark;
+    for (auto it = chan.write_buffer.begin(); it != end; it++) {
+        PendingWrite &pending = pending_writes_[*it];
+        pending.buffered = false;
+        pending.draining++;
+        auto timing = ScheduleAccess(config_.AddressMapping(*it), true, -1);
+        PushEvent(timing.first, Transaction(*it, true), channel,
+                  EventType::WRITE_ISSUED);
+    }
+    chan.write_buffer.erase(chan.write_buffer.begin(), end);
+}
+
+uint64_t AnalyticDRAMSystem::BusGap(bool first_write,
+                                    bool second_write) const {
+    // a read command has to wait tWTR after the write data, a write only
+    // needs the bus turned around after read data
+    if (first_write && !second_write) {
+        return config_.tWTR_L + config_.RL;
+    } else if (!first_write && second_write) {
+        return config_.tRTRS;
+    }
+    return 0;
+}
+
+uint64_t AnalyticDRAMSystem::ReserveBus(int channel, uint64_t cycle,
+                                        bool is_write) {
+    ChannelTiming &chan = channels_[channel];
+    auto &bus = chan.bus;
+    // bursts this far in the past cannot constrain new ones any more
+    uint64_t horizon = config_.tWTR_L + config_.RL + config_.tRTRS;
+    while (!bus.empty() && bus.begin()->second.end + horizon < clk_) {
+        bus.erase(bus.begin());
+    }
+
+    uint64_t start = cycle;
+    auto next = bus.lower_bound(start);
+    if (next != bus.begin()) {
+        const Burst &prev = std::prev(next)->second;
+        start = std::max(start, prev.end + BusGap(prev.is_write, is_write));
+    }
+    while (true) {
+        next = bus.lower_bound(start);
+        if (next == bus.end() ||
+            start + config_.burst_cycle +
+                    BusGap(is_write, next->second.is_write) <=
+                next->first) {
+            break;
+        }
+        start = std::max(start, next->second.end +
+                                    BusGap(next->second.is_write, is_write));
+    }
+    uint64_t end = start + config_.burst_cycle;
+    bus.emplace(start, Burst{end, is_write});
+    chan.bus_free = std::max(chan.bus_free, end);
+    return start;
+}
+
+uint64_t AnalyticDRAMSystem::ScheduleAct(int channel, int rank,
+                                         uint64_t cycle) {
+    std::multiset<uint64_t> &acts =
+        ranks_[channel * config_.ranks + rank].acts;
+    while (!acts.empty() && *acts.begin() + config_.tFAW < clk_) {
+        acts.erase(acts.begin());
+    }
+
+    // like the data bus, an ACT may go in between ones booked earlier
+    uint64_t act = cycle;
+    while (true) {
+        auto after = acts.lower_bound(act);
+        if (after != acts.end() && *after < act + config_.tRRD_S) {
+            act = *after + config_.tRRD_S;
+            continue;
+        }
+        if (after != acts.begin() &&
+            *std::prev(after) + config_.tRRD_S > act) {
+            act = *std::prev(after) + config_.tRRD_S;
+            continue;
+        }
+        // no more than four ACTs in the tFAW before or after this one
+        auto it = after;
+        int count = 0;
+        while (it != acts.begin() && count < 4) {
+            it--;
+            count++;
+        }
+        if (count == 4 && *it + config_.tFAW > act) {
+            act = *it + config_.tFAW;
+            continue;
+        }
+        it = after;
+        for (count = 0; it != acts.end() && count < 3; count++) {
+            it++;
+        }
+        if (count == 3 && it != acts.end() && *it < act + config_.tFAW) {
+            act = *it + config_.tRRD_S;
+            continue;
+        }
+        break;
+    }
+    acts.insert(act);
+    return act;
+}
+
+std::pair<uint64_t, uint64_t> AnalyticDRAMSystem::ScheduleAccess(
+    const Address &addr, bool is_write, int requester) {
+    RefreshRank(addr.channel, addr.rank, clk_);
+    BankTiming &bank = Bank(addr);
+    SimpleStats &stats = stats_[addr.channel];
+
+    uint64_t col;
+    if (bank.open_row == addr.row) {
+        col = std::max(clk_, bank.col_ready);
+        stats.Increment(is_write ? stat_.num_write_row_hits
+                                 : stat_.num_read_row_hits);
+        if (!is_write && HasRequester(requester)) {
+            stats.IncrementVec(stat_.req_read_row_hits, requester);
+        }
+    } else {
+        uint64_t act = clk_;
+        if (bank.open_row != -1) {  // row conflict
+            act = std::max(clk_, bank.pre_ready) + config_.tRP;
+            stats.Increment(stat_.num_pre_cmds);
+        }
+        act = ScheduleAct(addr.channel, addr.rank,
+                          std::max(act, bank.act_ready));
+        stats.Increment(stat_.num_act_cmds);
+        SetOpenRow(addr.channel, addr.rank, bank, addr.row);
+        bank.act_ready = act + config_.tRC;
+        bank.pre_ready = std::max(bank.pre_ready, act + config_.tRAS);
+        col = std::max(act + config_.tRCD, bank.col_ready);
+    }
+
+    int col_delay = is_write ? config_.WL : config_.RL;
+    uint64_t data_start = ReserveBus(addr.channel, col + col_delay, is_write);
+    uint64_t data_end = data_start + config_.burst_cycle;
+    col = data_start - col_delay;
+
+    stats.Increment(is_write ? stat_.num_write_cmds : stat_.num_read_cmds);
+    bank.col_ready = col + config_.tCCD_L;
+    if (is_write) {
+        bank.pre_ready = std::max(bank.pre_ready, data_end + config_.tWR);
+    } else {
+        bank.pre_ready = std::max(bank.pre_ready, col + config_.tRTP);
+    }
+    if (close_page_) {  // READP/WRITEP
+        bank.act_ready =
+            std::max(bank.act_ready, bank.pre_ready + config_.tRP);
+        SetOpenRow(addr.channel, addr.rank, bank, -1);
+    }
+    return std::make_pair(col, data_end);
+}
+
+void AnalyticDRAMSystem::RefreshRank(int channel, int rank, uint64_t until) {
+    RankTiming &rank_timing = ranks_[channel * config_.ranks + rank];
+    while (rank_timing.next_refresh <= until) {
+        auto first = banks_.begin() +
+                     (channel * config_.ranks + rank) * banks_per_rank_;
+        auto last = first + banks_per_rank_;
+        // all banks are precharged first, then the rank is busy for tRFC
+        uint64_t start = rank_timing.next_refresh;
+        for (auto it = first; it != last; it++) {
+            if (it->open_row != -1) {
+                start = std::max(start, it->pre_ready + config_.tRP);
+            }
+        }
+        for (auto it = first; it != last; it++) {
+            SetOpenRow(channel, rank, *it, -1);
+            it->act_ready = std::max(it->act_ready, start + config_.tRFC);
+        }
+        stats_[channel].Increment(stat_.num_ref_cmds);
+        rank_timing.next_refresh += refresh_interval_;
+    }
+}
+
+void AnalyticDRAMSystem::SetOpenRow(int channel, int rank, BankTiming &bank,
+                                    int row) {
+    RankTiming &rank_timing = ranks_[channel * config_.ranks + rank];
+    if (bank.open_row == -1 && row != -1) {
+        rank_timing.open_banks++;
+    } else if (bank.open_row != -1 && row == -1) {
+        rank_timing.open_banks--;
+    }
+    bank.open_row = row;
+}
+
+void AnalyticDRAMSystem::PushEvent(uint64_t cycle, const Transaction &trans,
+                                   int channel, EventType type) {
+    events_.push(Event{cycle, seq_++, trans.addr, trans.id, clk_, channel,
+                       trans.requester, type});
+}
+
+bool AnalyticDRAMSystem::HandleEvent(const Event &event) {
+    SimpleStats &stats = stats_[event.channel];
+    switch (event.type) {
+        case EventType::READ_DONE:
+            stats.Increment(stat_.num_reads_done);
+            stats.AddValue(stat_.read_latency,
+                           event.cycle - event.added_cycle);
+            if (HasRequester(event.requester)) {
+                stats.IncrementVec(stat_.req_reads_done, event.requester);
+                stats.AddValue(stat_.req_read_latency[event.requester],
+                               event.cycle - event.added_cycle);
+            }
+            return true;
+        case EventType::WRITE_DONE:
+            stats.Increment(stat_.num_writes_done);
+            if (HasRequester(event.requester)) {
+                stats.IncrementVec(stat_.req_writes_done, event.requester);
+            }
+            return true;
+        case EventType::READ_ISSUED:
+            channels_[event.channel].queued_reads--;
+            return false;
+        case EventType::WRITE_ISSUED: {
+            channels_[event.channel].queued_writes--;
+            auto pending = pending_writes_.find(event.addr);
+            if (--pending->second.draining == 0 && !pending->second.buffered) {
+                pending_writes_.erase(pending);
+            }
+            return false;
+        }
+    }
+    return false;
+}
+
+void AnalyticDRAMSystem::AdvanceStats(uint64_t cycles) {
+    // a rank with an open row is counted as active standby
+    for (int c = 0; c < config_.channels; c++) {
+        stats_[c].IncrementBy(stat_.num_cycles, cycles);
+        for (int r = 0; r < config_.ranks; r++) {
+            RefreshRank(c, r, clk_ + cycles - 1);
+            if (ranks_[c * config_.ranks + r].open_banks > 0) {
+                stats_[c].IncrementVecBy(stat_.rank_active_cycles, r, cycles);
+            } else {
+                stats_[c].IncrementVecBy(stat_.all_bank_idle_cycles, r,
+                                         cycles);
+            }
+        }
+    }
+}
+
+void AnalyticDRAMSystem::ClockTick() {
+    while (!events_.empty() && events_.top().cycle <= clk_) {
+        Event event = events_.top();
+        events_.pop();
+        if (!HandleEvent(event)) {
+            continue;
+        }
+        Transaction trans(event.addr, event.type == EventType::WRITE_DONE,
+                          event.id);
+        ReturnTransaction(trans, event.channel);
+    }
+    AdvanceStats(1);
+    clk_++;
+
+    if (clk_ % config_.epoch_period == 0) {
+        PrintEpochStats();
+    }
+}
+
+void AnalyticDRAMSystem::ClockTicks(uint64_t cycles,
+                                    std::vector<DoneTransaction> &done) {
+    // jump from event to event, only stopping at epoch boundaries
+    while (cycles > 0) {
+        uint64_t to_epoch = config_.epoch_period - clk_ % config_.epoch_period;
+        uint64_t batch = std::min(cycles, to_epoch);
+        uint64_t end = clk_ + batch;
+        while (!events_.empty() && events_.top().cycle < end) {
+            Event event = events_.top();
+            events_.pop();
+            if (HandleEvent(event)) {
+                done.push_back({std::max(event.cycle, clk_), event.addr,
+                                event.type == EventType::WRITE_DONE,
+                                event.id, event.channel});
+            }
+        }
+        AdvanceStats(batch);
+        clk_ = end;
+        cycles -= batch;
+        if (clk_ % config_.epoch_period == 0) {
+            PrintEpochStats();
+        }
+    }
+}
+
+uint64_t AnalyticDRAMSystem::NextEventCycle() const {
+    if (events_.empty()) {
+        return std::numeric_limits<uint64_t>::max();
+    }
+    return std::max(clk_, events_.top().cycle);
+}
+
+void AnalyticDRAMSystem::PrintEpochStats() {
+    EpochWriter *writer = EpochStatsWriter();
+    for (auto &stats : stats_) {
+        stats.Increment(stat_.epoch_num);
+        stats.PrintEpochStats(writer);
+    }
+}
+
+void AnalyticDRAMSystem::PrintStats() {
+    FinishEpochStats();
+    FinishTrace();
+
+    std::ofstream json_out(config_.json_stats_name, std::ofstream::out);
+    json_out << "{";
+    json_out.close();
+    for (size_t i = 0; i < stats_.size(); i++) {
+        stats_[i].PrintFinalStats();
+        if (i != stats_.size() - 1) {
+            std::ofstream chan_out(config_.json_stats_name, std::ofstream::app);
+            chan_out << "," << std::endl;
+        }
+    }
+    json_out.open(config_.json_stats_name, std::ofstream::app);
+    json_out << "}";
+}
+
+void AnalyticDRAMSystem::ResetStats() {
+    for (auto &stats : stats_) {
+        stats.Reset();
+    }
+}
+
+}  // namespace dramsim3
@@ -0,0 +1,164 @@
+#ifndef __ANALYTIC_SYSTEM_H
+#define __ANALYTIC_SYSTEM_H
+
+#include <functional>
+#include <map>
+#include <queue>
+#include <set>
+#include <string>
+#include <utility>
+#include <unordered_map>
+#include <vector>
+
+#include "dram_system.h"
+#include "simple_stats.h"
+
+namespace dramsim3 {
+
+// Event driven queueing model of a JEDEC memory system for fast sweeps.
+// Nothing is ticked per cycle: when a transaction arrives its column
+// command and data burst are placed right away from the state of its bank
+// (open row, earliest ACT/PRE/column cycle) and its channel (data bus free
+// cycle, last direction), using the row hit/miss/conflict timing of the
+// INI file, and its completion becomes an event. Reads are served in
+// arrival order per bank, writes are buffered and drained in batches with
+// the same thresholds as the controllers, ACTs of a rank respect tRRD and
+// tFAW, refresh blocks a rank for tRFC every tREFI, and
+// the read latency can be corrected by a linear fit against the JEDEC
+// model (see analytic_latency_scale/offset and the analyticcalib tool).
+// The stats use the same names and files as the JEDEC controllers.
+class AnalyticDRAMSystem : public BaseDRAMSystem {
+   public:
+    AnalyticDRAMSystem(const Config &config, const std::string &output_dir,
+                       std::function<void(uint64_t)> read_callback,
+                       std::function<void(uint64_t)> write_callback);
+    ~AnalyticDRAMSystem();
+    bool WillAcceptTransaction(uint64_t hex_addr, bool is_write) const override;
+    using BaseDRAMSystem::AddTransaction;
+    bool AddTransaction(uint64_t hex_addr, bool is_write, uint64_t id,
+                        int requester) override;
+    void ClockTick() override;
+    void ClockTicks(uint64_t cycles,
+                    std::vector<DoneTransaction> &done) override;
+    uint64_t NextEventCycle() const override;
+    void PrintEpochStats() override;
+    void PrintStats() override;
+    void ResetStats() override;
+
+    // uncorrected latency the model gave the last added read, 0 if it was
+    // served from a pending write; used for calibration
+    uint64_t LastReadModelLatency() const { return last_read_latency_; }
+
+   private:
+    enum class EventType { READ_DONE, WRITE_DONE, READ_ISSUED, WRITE_ISSUED };
+
+    struct Event {
+        uint64_t cycle;
+        uint64_t seq;  // keeps same cycle events in arrival order
+        uint64_t addr;
+        uint64_t id;
+        uint64_t added_cycle;
+        int channel;
+        int requester;
+        EventType type;
+        bool operator>(const Event &other) const {
+            return cycle != other.cycle ? cycle > other.cycle
+                                        : seq > other.seq;
+        }
+    };
+
+    struct BankTiming {
+        int open_row;
+        uint64_t act_ready;
+        uint64_t pre_ready;
+        uint64_t col_ready;
+    };
+
+    struct Burst {
+        uint64_t end;
+        bool is_write;
+    };
+
+    struct ChannelTiming {
+        // data bursts booked on the bus by start cycle, a burst goes into
+        // the first gap that fits so a request waiting for a busy bank
+        // does not hold up the ones behind it
+        std::map<uint64_t, Burst> bus;
+        uint64_t bus_free;  // end of the last booked burst
+        int queued_reads;
+        int queued_writes;
+        std::vector<uint64_t> write_buffer;  // not scheduled yet
+    };
+
+    struct RankTiming {
+        uint64_t next_refresh;
+        int open_banks;
+        std::multiset<uint64_t> acts;  // booked ACTs, for tRRD and tFAW
+    };
+
+    struct StatHandles {
+        StatId num_cycles, epoch_num, num_reads_done, num_writes_done;
+        StatId num_write_buf_hits, num_write_coalesced;
+        StatId num_read_cmds, num_read_row_hits, num_write_cmds,
+            num_write_row_hits, num_act_cmds, num_pre_cmds, num_ref_cmds;
+        StatId all_bank_idle_cycles, rank_active_cycles;
+        StatId read_latency, interarrival_latency;
+        // per-requester, only with num_requesters > 0
+        StatId req_reads_done, req_writes_done, req_read_row_hits;
+        std::vector<StatId> req_read_latency;
+    };
+
+    // place the commands of an access arriving at clk_, returns the cycle
+    // of its column command and the end of its data burst; row hits of
+    // reads are also counted for |requester| if it is one
+    std::pair<uint64_t, uint64_t> ScheduleAccess(const Address &addr,
+                                                 bool is_write, int requester);
+    // book the earliest ACT of a rank not before |cycle| and return it
+    uint64_t ScheduleAct(int channel, int rank, uint64_t cycle);
+    // book the earliest data burst not before |cycle|, returns its start
+    uint64_t ReserveBus(int channel, uint64_t cycle, bool is_write);
+    // idle data bus cycles needed between two bursts
+    uint64_t BusGap(bool first_write, bool second_write) const;
+    void MaybeDrainWrites(int channel);
+    void RefreshRank(int channel, int rank, uint64_t until);
+    void SetOpenRow(int channel, int rank, BankTiming &bank, int row);
+    void PushEvent(uint64_t cycle, const Transaction &trans, int channel,
+                   EventType type);
+    bool HasRequester(int requester) const {
+        return requester >= 0 && requester < config_.num_requesters;
+    }
+    // handle an event, returns true if it completes a transaction
+    bool HandleEvent(const Event &event);
+    void AdvanceStats(uint64_t cycles);
+    BankTiming &Bank(const Address &addr);
+
+    int banks_per_rank_;
+    bool close_page_;
+    double latency_scale_;
+    double latency_offset_;
+    uint64_t refresh_interval_;
+    uint64_t seq_;
+    uint64_t last_read_latency_;
+    std::vector<uint64_t> last_trans_clk_;
+
+    std::vector<BankTiming> banks_;
+    std::vector<RankTiming> ranks_;
+    std::vector<ChannelTiming> channels_;
+    // writes that have not reached the DRAM yet, reads to them are
+    // answered from the write buffer like the JEDEC controller does. Only a
+    // line still waiting in the write buffer takes merges, a line picked for
+    // a drain is buffered anew by the next write to it
+    struct PendingWrite {
+        bool buffered = false;
+        int draining = 0;
+    };
+    std::unordered_map<uint64_t, PendingWrite> pending_writes_;
+    std::priority_queue<Event, std::vector<Event>, std::greater<Event>>
+        events_;
+
+    std::vector<SimpleStats> stats_;
+    StatHandles stat_;
+};
+
+}  // namespace dramsim3
+#endif  // __ANALYTIC_SYSTEM_H
@@ -11,31 +11,32 @@ class BankState {
     BankState();
 
     enum class State { OPEN, CLOSED, SREF, PD, SIZE };
-    Command GetReadyCommand(const Command& cmd, uint64_t clk) const;
+    // The command this bank needs next to make progress on |cmd|; whether it
+    // can issue yet depends on the timing constraints kept by ChannelState
+    CommandType RequiredCommand(const Command& cmd) const;
 
     // Update the state of the bank resulting after the execution of the command
     void UpdateState(const Command& cmd);
 
-    // Update the existing timing constraints for the command
-    void UpdateTiming(const CommandType cmd_type, uint64_t time);
-
+    State GetState() const { return state_; }
     bool IsRowOpen() const { return state_ == State::OPEN; }
     int OpenRow() const { return open_row_; }
     int RowHitCount() const { return row_hit_count_; }
+    uint64_t StateVersion() const { return state_version_; }
 
    private:
     // Current state of the Bank
     // Apriori or instantaneously transitions on a command.
     State state_;
 
-    // Earliest time when the particular Command can be executed in this bank
-    std::vector<uint64_t> cmd_timing_;
-
     // Currently open row
     int open_row_;
 
     // consecutive accesses to one row
     int row_hit_count_;
+
+    // incremented on every UpdateState()
+    uint64_t state_version_;
 };
 
 }  // namespace dramsim3
@@ -0,0 +1,219 @@
+#include "binary_trace.h"
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+namespace dramsim3 {
+
+namespace {
+
+const size_t kHeaderBytes = sizeof(kBinaryTraceMagic) + sizeof(uint64_t);
+const size_t kWriteBufferBytes = 1 << 20;
+// how far ahead of the cursor the mapping is prefetched
+const size_t kPrefetchBytes = 16 << 20;
+
+inline uint64_t ZigZag(uint64_t delta) {
+    return (delta << 1) ^ (0 - (delta >> 63));
+}
+
+inline uint64_t UnZigZag(uint64_t value) {
+    return (value >> 1) ^ (0 - (value & 1));
+}
+
+void PutVarint(std::string& buffer, uint64_t value) {
+    while (value >= 0x80) {
+        buffer.push_back(static_cast<char>((value & 0x7f) | 0x80));
+        value >>= 7;
+    }
+    buffer.push_back(static_cast<char>(value));
+}
+
+void PutUint64(char* dst, uint64_t value) {
+    for (int i = 0; i < 8; i++) {
+        dst[i] = static_cast<char>((value >> (8 * i)) & 0xff);
+    }
+}
+
+uint64_t GetUint64(const uint8_t* src) {
+    uint64_t value = 0;
+    for (int i = 0; i < 8; i++) {
+        value |= static_cast<uint64_t>(src[i]) << (8 * i);
+    }
+    return value;
+}
+
+}  // namespace
+
+BinaryTraceWriter::BinaryTraceWriter(const std::string& file_name)
+    : file_(file_name, std::ofstream::out | std::ofstream::binary),
+      num_records_(0),
+      last_addr_(0),
+      last_cycle_(0),
+      closed_(false) {
+    if (!file_) {
+        std::cerr << "Cannot open binary trace " << file_name << std::endl;
+        AbruptExit(__FILE__, __LINE__);
+    }
+    // the record count is patched in by Close()
+    char header[kHeaderBytes];
+    std::memcpy(header, kBinaryTraceMagic, sizeof(kBinaryTraceMagic));
+    PutUint64(header + sizeof(kBinaryTraceMagic), 0);
+    file_.write(header, kHeaderBytes);
+    buffer_.reserve(kWriteBufferBytes + 32);
+}
+
+BinaryTraceWriter::~BinaryTraceWriter() { Close(); }
+
+void BinaryTraceWriter::Append(uint64_t addr, bool is_write, uint64_t cycle) {
+    PutVarint(buffer_, ZigZag(addr - last_addr_));
+    PutVarint(buffer_, ZigZag(cycle - last_cycle_) << 1 | (is_write ? 1 : 0));
+    last_addr_ = addr;
+    last_cycle_ = cycle;
+    num_records_++;
+    if (buffer_.size() >= kWriteBufferBytes) {
+        FlushBuffer();
+    }
+}
+
+void BinaryTraceWriter::FlushBuffer() {
+    file_.write(buffer_.data(), buffer_.size());
+    buffer_.clear();
+}
+
+void BinaryTraceWriter::Close() {
+    if (closed_) {
+        return;
+    }
+    closed_ = true;
+    FlushBuffer();
+    char count[sizeof(uint64_t)];
+    PutUint64(count, num_records_);
+    file_.seekp(sizeof(kBinaryTraceMagic));
+    file_.write(count, sizeof(count));
+    file_.close();
+}
+
+BinaryTraceReader::BinaryTraceReader(const std::string& file_name)
+    : data_(nullptr),
+      size_(0),
+      pos_(kHeaderBytes),
+      prefetched_(0),
+      num_records_(0),
+      records_read_(0),
+      last_addr_(0),
+      last_cycle_(0),
+      file_name_(file_name) {
+    int fd = open(file_name.c_str(), O_RDONLY);
+    struct stat info;
+    if (fd < 0 || fstat(fd, &info) != 0) {
+        std::cerr << "Cannot open binary trace " << file_name << std::endl;
+        AbruptExit(__FILE__, __LINE__);
+    }
+    size_ = static_cast<size_t>(info.st_size);
+    if (size_ < kHeaderBytes) {
+        std::cerr << file_name << " is not a binary trace" << std::endl;
+        AbruptExit(__FILE__, __LINE__);
+    }
+    void* addr = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+    // the mapping stays valid after the descriptor is gone
+    close(fd);
+    if (addr == MAP_FAILED) {
+        std::cerr << "Cannot map binary trace " << file_name << std::endl;
+        AbruptExit(__FILE__, __LINE__);
+    }
+    data_ = static_cast<const uint8_t*>(addr);
+    madvise(addr, size_, MADV_SEQUENTIAL);
+    if (std::memcmp(data_, kBinaryTraceMagic, sizeof(kBinaryTraceMagic))) {
+        std::cerr << file_name << " is not a binary trace" << std::endl;
+        AbruptExit(__FILE__, __LINE__);
+    }
+    num_records_ = GetUint64(data_ + sizeof(kBinaryTraceMagic));
+    Prefetch();
+}
+
+BinaryTraceReader::~BinaryTraceReader() {
+    if (data_) {
+        munmap(const_cast<uint8_t*>(data_), size_);
+    }
+}
+
+bool BinaryTraceReader::IsBinaryTrace(const std::string& file_name) {
+    std::ifstream file(file_name, std::ifstream::binary);
+    char magic[sizeof(kBinaryTraceMagic)];
+    file.read(magic, sizeof(magic));
+    return file.gcount() == sizeof(magic) &&
+           std::memcmp(magic, kBinaryTraceMagic, sizeof(magic)) == 0;
+}
+
+void BinaryTraceReader::Prefetch() {
+    // ask for the next window once the cursor is half way through this one
+    if (pos_ + kPrefetchBytes / 2 < prefetched_ || prefetched_ >= size_) {
+        return;
+    }
+    long page = sysconf(_SC_PAGESIZE);
+    size_t begin = pos_ & ~(static_cast<size_t>(page) - 1);
+    size_t end = std::min(size_, pos_ + kPrefetchBytes);
+    madvise(const_cast<uint8_t*>(data_) + begin, end - begin, MADV_WILLNEED);
+    prefetched_ = end;
+}
+
+uint64_t BinaryTraceReader::ReadVarint() {
+    uint64_t value = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        if (pos_ >= size_) {
+            std::cerr << "Truncated binary trace " << file_name_ << std::endl;
+            AbruptExit(__FILE__, __LINE__);
+        }
+        uint8_t byte = data_[pos_++];
+        value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+        if (byte < 0x80) {
+            break;
+        }
+    }
+    return value;
+}
+
+bool BinaryTraceReader::Next(Transaction& trans) {
+    if (records_read_ == num_records_) {
+        return false;
+    }
+    Prefetch();
+    last_addr_ += UnZigZag(ReadVarint());
+    uint64_t cycle_and_op = ReadVarint();
+    last_cycle_ += UnZigZag(cycle_and_op >> 1);
+    trans.addr = last_addr_;
+    trans.id = last_addr_;
+    trans.requester = -1;
+    trans.added_cycle = last_cycle_;
+    trans.is_write = (cycle_and_op & 1) != 0;
+    records_read_++;
+    return true;
+}
+
+std::vector<Transaction> LoadTrace(const std::string& file_name,
+                                   uint64_t cycles) {
+    std::vector<Transaction> trace;
+    Transaction trans;
+    if (BinaryTraceReader::IsBinaryTrace(file_name)) {
+        BinaryTraceReader reader(file_name);
+        while (reader.Next(trans) && trans.added_cycle < cycles) {
+            trace.push_back(trans);
+        }
+    } else {
+        std::ifstream in(file_name);
+        if (!in) {
+            std::cerr << "cannot open " << file_name << std::endl;
+            AbruptExit(__FILE__, __LINE__);
+        }
+        while (in >> trans && trans.added_cycle < cycles) {
+            trace.push_back(trans);
+        }
+    }
+    return trace;
+}
+
+}  // namespace dramsim3
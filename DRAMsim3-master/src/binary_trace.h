@@ -0,0 +1,81 @@
+#ifndef __BINARY_TRACE_H
+#define __BINARY_TRACE_H
+
+#include <stdint.h>
+#include <fstream>
+#include <string>
+#include <vector>
+#include "common.h"
+
+namespace dramsim3 {
+
+// Compact binary form of the "addr READ|WRITE cycle" text traces.
+// Layout: a 16-byte header (8-byte magic, uint64 record count, both little
+// endian), then per transaction two LEB128 varints:
+//   zigzag(addr - previous addr)
+//   zigzag(cycle - previous cycle) << 1 | is_write
+// Consecutive requests tend to be close in both address and time, so most
+// records take 3 to 5 bytes instead of ~25 characters of text, and decoding
+// is a handful of shifts per field.
+static const char kBinaryTraceMagic[8] = {'D', 'S', '3', 'T',
+                                          'R', 'C', 'E', '1'};
+
+class BinaryTraceWriter {
+   public:
+    explicit BinaryTraceWriter(const std::string& file_name);
+    ~BinaryTraceWriter();
+    void Append(uint64_t addr, bool is_write, uint64_t cycle);
+    // Write the record count into the header and close the file
+    void Close();
+    uint64_t NumRecords() const { return num_records_; }
+
+   private:
+    void FlushBuffer();
+
+    std::ofstream file_;
+    std::string buffer_;
+    uint64_t num_records_;
+    uint64_t last_addr_;
+    uint64_t last_cycle_;
+    bool closed_;
+};
+
+// Reads a binary trace through a read-only memory mapping. The kernel is
+// told the access is sequential and the window ahead of the cursor is
+// prefetched, so replay is not bound by read() calls or text parsing.
+class BinaryTraceReader {
+   public:
+    explicit BinaryTraceReader(const std::string& file_name);
+    ~BinaryTraceReader();
+    BinaryTraceReader(const BinaryTraceReader&) = delete;
+    BinaryTraceReader& operator=(const BinaryTraceReader&) = delete;
+
+    // Decode the next transaction into addr, is_write and added_cycle of
+    // |trans|; returns false at the end of the trace
+    bool Next(Transaction& trans);
+    uint64_t NumRecords() const { return num_records_; }
+
+    // true if the file starts with kBinaryTraceMagic
+    static bool IsBinaryTrace(const std::string& file_name);
+
+   private:
+    uint64_t ReadVarint();
+    void Prefetch();
+
+    const uint8_t* data_;
+    size_t size_;
+    size_t pos_;
+    size_t prefetched_;
+    uint64_t num_records_;
+    uint64_t records_read_;
+    uint64_t last_addr_;
+    uint64_t last_cycle_;
+    std::string file_name_;
+};
+
+// every transaction of a text or binary trace added before |cycles|
+std::vector<Transaction> LoadTrace(const std::string& file_name,
+                                   uint64_t cycles);
+
+}  // namespace dramsim3
+#endif  // __BINARY_TRACE_H
@@ -1,4 +1,5 @@
 #include "channel_state.h"
+#include <algorithm>
 
 namespace dramsim3 {
 ChannelState::ChannelState(const Config& config, const Timing& timing)
@@ -6,27 +7,18 @@ ChannelState::ChannelState(const Config& config, const Timing& timing)
       config_(config),
       timing_(timing),
       rank_is_sref_(config.ranks, false),
+      rank_state_version_(config.ranks, 0),
+      bank_states_(config_.ranks * config_.banks),
+      cmd_timing_(static_cast<int>(CommandType::SIZE),
+                  std::vector<uint64_t>(config_.ranks * config_.banks, 0)),
       four_aw_(config_.ranks, std::vector<uint64_t>()),
-      thirty_two_aw_(config_.ranks, std::vector<uint64_t>()) {
-    bank_states_.reserve(config_.ranks);
-    for (auto i = 0; i < config_.ranks; i++) {
-        auto rank_states = std::vector<std::vector<BankState>>();
-        rank_states.reserve(config_.bankgroups);
-        for (auto j = 0; j < config_.bankgroups; j++) {
-            auto bg_states =
-                std::vector<BankState>(config_.banks_per_group, BankState());
-            rank_states.push_back(bg_states);
-        }
-        bank_states_.push_back(rank_states);
-    }
-}
+      thirty_two_aw_(config_.ranks, std::vector<uint64_t>()) {}
 
 bool ChannelState::IsAllBankIdleInRank(int rank) const {
-    for (int j = 0; j < config_.bankgroups; j++) {
-        for (int k = 0; k < config_.banks_per_group; k++) {
-            if (bank_states_[rank][j][k].IsRowOpen()) {
-                return false;
-            }
+    int begin = BankIndex(rank, 0, 0);
+    for (int i = begin; i < begin + config_.banks; i++) {
+        if (bank_states_[i].IsRowOpen()) {
+            return false;
         }
     }
     return true;
@@ -38,7 +30,7 @@ bool ChannelState::IsRWPendingOnRef(const Command& cmd) const {
     int bank = cmd.Bank();
     return (IsRowOpen(rank, bankgroup, bank) &&
             RowHitCount(rank, bankgroup, bank) == 0 &&
-            bank_states_[rank][bankgroup][bank].OpenRow() == cmd.Row());
+            OpenRow(rank, bankgroup, bank) == cmd.Row());
 }
 
 void ChannelState::BankNeedRefresh(int rank, int bankgroup, int bank,
@@ -79,8 +71,8 @@ Command ChannelState::GetReadyCommand(const Command& cmd, uint64_t clk) const {
         int num_ready = 0;
         for (auto j = 0; j < config_.bankgroups; j++) {
             for (auto k = 0; k < config_.banks_per_group; k++) {
-                ready_cmd =
-                    bank_states_[cmd.Rank()][j][k].GetReadyCommand(cmd, clk);
+                ready_cmd = GetBankReadyCommand(
+                    cmd, BankIndex(cmd.Rank(), j, k), clk);
                 if (!ready_cmd.IsValid()) {  // Not ready
                     continue;
                 }
@@ -100,8 +92,8 @@ Command ChannelState::GetReadyCommand(const Command& cmd, uint64_t clk) const {
             return Command();
         }
     } else {
-        ready_cmd = bank_states_[cmd.Rank()][cmd.Bankgroup()][cmd.Bank()]
-                        .GetReadyCommand(cmd, clk);
+        ready_cmd = GetBankReadyCommand(
+            cmd, BankIndex(cmd.Rank(), cmd.Bankgroup(), cmd.Bank()), clk);
         if (!ready_cmd.IsValid()) {
             return Command();
         }
@@ -114,12 +106,45 @@ Command ChannelState::GetReadyCommand(const Command& cmd, uint64_t clk) const {
     }
 }
 
+Command ChannelState::GetBankReadyCommand(const Command& cmd, int bank_idx,
+                                          uint64_t clk) const {
+    auto required_type = bank_states_[bank_idx].RequiredCommand(cmd);
+    if (required_type != CommandType::SIZE &&
+        clk >= cmd_timing_[static_cast<int>(required_type)][bank_idx]) {
+        return Command(required_type, cmd.addr, cmd.hex_addr);
+    }
+    return Command();
+}
+
+uint64_t ChannelState::BankEarliestReady(int rank, int bankgroup,
+                                         int bank) const {
+    int idx = BankIndex(rank, bankgroup, bank);
+    auto timing = [this, idx](CommandType type) {
+        return cmd_timing_[static_cast<int>(type)][idx];
+    };
+    switch (bank_states_[idx].GetState()) {
+        case BankState::State::CLOSED:
+            return timing(CommandType::ACTIVATE);
+        case BankState::State::OPEN:
+            return std::min(
+                std::min(timing(CommandType::READ),
+                         timing(CommandType::READ_PRECHARGE)),
+                std::min(std::min(timing(CommandType::WRITE),
+                                  timing(CommandType::WRITE_PRECHARGE)),
+                         timing(CommandType::PRECHARGE)));
+        case BankState::State::SREF:
+            return timing(CommandType::SREF_EXIT);
+        default:
+            return 0;
+    }
+}
+
 void ChannelState::UpdateState(const Command& cmd) {
+    rank_state_version_[cmd.Rank()]++;
     if (cmd.IsRankCMD()) {
-        for (auto j = 0; j < config_.bankgroups; j++) {
-            for (auto k = 0; k < config_.banks_per_group; k++) {
-                bank_states_[cmd.Rank()][j][k].UpdateState(cmd);
-            }
+        int begin = BankIndex(cmd.Rank(), 0, 0);
+        for (int i = begin; i < begin + config_.banks; i++) {
+            bank_states_[i].UpdateState(cmd);
         }
         if (cmd.IsRefresh()) {
             RankNeedRefresh(cmd.Rank(), false);
@@ -129,7 +154,8 @@ void ChannelState::UpdateState(const Command& cmd) {
             rank_is_sref_[cmd.Rank()] = false;
         }
     } else {
-        bank_states_[cmd.Rank()][cmd.Bankgroup()][cmd.Bank()].UpdateState(cmd);
+        bank_states_[BankIndex(cmd.Rank(), cmd.Bankgroup(), cmd.Bank())]
+            .UpdateState(cmd);
         if (cmd.IsRefresh()) {
             BankNeedRefresh(cmd.Rank(), cmd.Bankgroup(), cmd.Bank(), false);
         }
@@ -138,6 +164,10 @@ void ChannelState::UpdateState(const Command& cmd) {
 }
 
 void ChannelState::UpdateTiming(const Command& cmd, uint64_t clk) {
+    int type = static_cast<int>(cmd.cmd_type);
+    // [rank_begin, rank_end) holds [bg_begin, bg_end) holds bank
+    int rank_begin = BankIndex(cmd.Rank(), 0, 0);
+    int rank_end = rank_begin + config_.banks;
     switch (cmd.cmd_type) {
         case CommandType::ACTIVATE:
             UpdateActivationTimes(cmd.Rank(), clk);
@@ -146,38 +176,38 @@ void ChannelState::UpdateTiming(const Command& cmd, uint64_t clk) {
         case CommandType::WRITE:
         case CommandType::WRITE_PRECHARGE:
         case CommandType::PRECHARGE:
-        case CommandType::REFRESH_BANK:
-            // TODO - simulator speed? - Speciazlize which of the below
-            // functions to call depending on the command type  Same Bank
-            UpdateSameBankTiming(
-                cmd.addr, timing_.same_bank[static_cast<int>(cmd.cmd_type)],
-                clk);
+        case CommandType::REFRESH_BANK: {
+            int bg_begin = BankIndex(cmd.Rank(), cmd.Bankgroup(), 0);
+            int bg_end = bg_begin + config_.banks_per_group;
+            int bank = BankIndex(cmd.Rank(), cmd.Bankgroup(), cmd.Bank());
+            // Same Bank
+            UpdateBankRangeTiming(timing_.same_bank[type], bank, bank + 1,
+                                  clk);
 
             // Same Bankgroup other banks
-            UpdateOtherBanksSameBankgroupTiming(
-                cmd.addr,
-                timing_
-                    .other_banks_same_bankgroup[static_cast<int>(cmd.cmd_type)],
-                clk);
+            UpdateBankRangeTiming(timing_.other_banks_same_bankgroup[type],
+                                  bg_begin, bank, clk);
+            UpdateBankRangeTiming(timing_.other_banks_same_bankgroup[type],
+                                  bank + 1, bg_end, clk);
 
             // Other bankgroups
-            UpdateOtherBankgroupsSameRankTiming(
-                cmd.addr,
-                timing_
-                    .other_bankgroups_same_rank[static_cast<int>(cmd.cmd_type)],
-                clk);
+            UpdateBankRangeTiming(timing_.other_bankgroups_same_rank[type],
+                                  rank_begin, bg_begin, clk);
+            UpdateBankRangeTiming(timing_.other_bankgroups_same_rank[type],
+                                  bg_end, rank_end, clk);
 
             // Other ranks
-            UpdateOtherRanksTiming(
-                cmd.addr, timing_.other_ranks[static_cast<int>(cmd.cmd_type)],
-                clk);
+            UpdateBankRangeTiming(timing_.other_ranks[type], 0, rank_begin,
+                                  clk);
+            UpdateBankRangeTiming(timing_.other_ranks[type], rank_end,
+                                  static_cast<int>(bank_states_.size()), clk);
             break;
+        }
         case CommandType::REFRESH:
         case CommandType::SREF_ENTER:
         case CommandType::SREF_EXIT:
-            UpdateSameRankTiming(
-                cmd.addr, timing_.same_rank[static_cast<int>(cmd.cmd_type)],
-                clk);
+            UpdateBankRangeTiming(timing_.same_rank[type], rank_begin,
+                                  rank_end, clk);
             break;
         default:
             AbruptExit(__FILE__, __LINE__);
@@ -185,78 +215,16 @@ void ChannelState::UpdateTiming(const Command& cmd, uint64_t clk) {
     return;
 }
 
-void ChannelState::UpdateSameBankTiming(
-    const Address& addr,
-    const std::vector<std::pair<CommandType, int>>& cmd_timing_list,
-    uint64_t clk) {
-    for (auto cmd_timing : cmd_timing_list) {
-        bank_states_[addr.rank][addr.bankgroup][addr.bank].UpdateTiming(
-            cmd_timing.first, clk + cmd_timing.second);
-    }
-    return;
-}
-
-void ChannelState::UpdateOtherBanksSameBankgroupTiming(
-    const Address& addr,
-    const std::vector<std::pair<CommandType, int>>& cmd_timing_list,
-    uint64_t clk) {
-    for (auto k = 0; k < config_.banks_per_group; k++) {
-        if (k != addr.bank) {
-            for (auto cmd_timing : cmd_timing_list) {
-                bank_states_[addr.rank][addr.bankgroup][k].UpdateTiming(
-                    cmd_timing.first, clk + cmd_timing.second);
-            }
-        }
-    }
-    return;
-}
-
-void ChannelState::UpdateOtherBankgroupsSameRankTiming(
-    const Address& addr,
-    const std::vector<std::pair<CommandType, int>>& cmd_timing_list,
-    uint64_t clk) {
-    for (auto j = 0; j < config_.bankgroups; j++) {
-        if (j != addr.bankgroup) {
-            for (auto k = 0; k < config_.banks_per_group; k++) {
-                for (auto cmd_timing : cmd_timing_list) {
-                    bank_states_[addr.rank][j][k].UpdateTiming(
-                        cmd_timing.first, clk + cmd_timing.second);
-                }
-            }
-        }
-    }
-    return;
-}
-
-void ChannelState::UpdateOtherRanksTiming(
-    const Address& addr,
-    const std::vector<std::pair<CommandType, int>>& cmd_timing_list,
-    uint64_t clk) {
-    for (auto i = 0; i < config_.ranks; i++) {
-        if (i != addr.rank) {
-            for (auto j = 0; j < config_.bankgroups; j++) {
-                for (auto k = 0; k < config_.banks_per_group; k++) {
-                    for (auto cmd_timing : cmd_timing_list) {
-                        bank_states_[i][j][k].UpdateTiming(
-                            cmd_timing.first, clk + cmd_timing.second);
-                    }
-                }
-            }
-        }
-    }
-    return;
-}
-
-void ChannelState::UpdateSameRankTiming(
-    const Address& addr,
-    const std::vector<std::pair<CommandType, int>>& cmd_timing_list,
-    uint64_t clk) {
-    for (auto j = 0; j < config_.bankgroups; j++) {
-        for (auto k = 0; k < config_.banks_per_group; k++) {
-            for (auto cmd_timing : cmd_timing_list) {
-                bank_states_[addr.rank][j][k].UpdateTiming(
-                    cmd_timing.first, clk + cmd_timing.second);
-            }
+void ChannelState::UpdateBankRangeTiming(
+    const std::vector<std::pair<CommandType, int>>& cmd_timing_list, int begin,
+    int end, uint64_t clk) {
+    for (const auto& cmd_timing : cmd_timing_list) {
+        uint64_t time = clk + cmd_timing.second;
+        uint64_t* timing =
+            cmd_timing_[static_cast<int>(cmd_timing.first)].data();
+        // plain contiguous max-update so the compiler can vectorise it
+        for (int i = begin; i < end; i++) {
+            timing[i] = timing[i] < time ? time : timing[i];
         }
     }
     return;
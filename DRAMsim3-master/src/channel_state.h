@@ -19,7 +19,7 @@ class ChannelState {
     bool ActivationWindowOk(int rank, uint64_t curr_time) const;
     void UpdateActivationTimes(int rank, uint64_t curr_time);
     bool IsRowOpen(int rank, int bankgroup, int bank) const {
-        return bank_states_[rank][bankgroup][bank].IsRowOpen();
+        return bank_states_[BankIndex(rank, bankgroup, bank)].IsRowOpen();
     }
     bool IsAllBankIdleInRank(int rank) const;
     bool IsRankSelfRefreshing(int rank) const { return rank_is_sref_[rank]; }
@@ -29,11 +29,23 @@ class ChannelState {
     void BankNeedRefresh(int rank, int bankgroup, int bank, bool need);
     void RankNeedRefresh(int rank, bool need);
     int OpenRow(int rank, int bankgroup, int bank) const {
-        return bank_states_[rank][bankgroup][bank].OpenRow();
+        return bank_states_[BankIndex(rank, bankgroup, bank)].OpenRow();
     }
     int RowHitCount(int rank, int bankgroup, int bank) const {
-        return bank_states_[rank][bankgroup][bank].RowHitCount();
+        return bank_states_[BankIndex(rank, bankgroup, bank)].RowHitCount();
     };
+    // Earliest cycle at which any read/write to this bank can get a command
+    // out, given the current state. Timing constraints only ever move
+    // forward, so this stays a valid lower bound until the state changes,
+    // which bumps BankStateVersion().
+    uint64_t BankEarliestReady(int rank, int bankgroup, int bank) const;
+    uint64_t BankStateVersion(int rank, int bankgroup, int bank) const {
+        return bank_states_[BankIndex(rank, bankgroup, bank)].StateVersion();
+    }
+    // bumped whenever any bank in the rank changes state
+    uint64_t RankStateVersion(int rank) const {
+        return rank_state_version_[rank];
+    }
 
     std::vector<int> rank_idle_cycles;
 
@@ -42,43 +54,30 @@ class ChannelState {
     const Timing& timing_;
 
     std::vector<bool> rank_is_sref_;
-    std::vector<std::vector<std::vector<BankState> > > bank_states_;
+    std::vector<uint64_t> rank_state_version_;
+
+    // Banks are numbered rank-major, so a rank, and a bankgroup within it,
+    // is a contiguous index range
+    int BankIndex(int rank, int bankgroup, int bank) const {
+        return rank * config_.banks + bankgroup * config_.banks_per_group +
+               bank;
+    }
+    std::vector<BankState> bank_states_;
+    // Earliest cycle each command type can issue, [command type][bank]
+    std::vector<std::vector<uint64_t> > cmd_timing_;
     std::vector<Command> refresh_q_;
 
     std::vector<std::vector<uint64_t> > four_aw_;
     std::vector<std::vector<uint64_t> > thirty_two_aw_;
     bool IsFAWReady(int rank, uint64_t curr_time) const;
     bool Is32AWReady(int rank, uint64_t curr_time) const;
-    // Update timing of the bank the command corresponds to
-    void UpdateSameBankTiming(
-        const Address& addr,
-        const std::vector<std::pair<CommandType, int> >& cmd_timing_list,
-        uint64_t clk);
-
-    // Update timing of the other banks in the same bankgroup as the command
-    void UpdateOtherBanksSameBankgroupTiming(
-        const Address& addr,
-        const std::vector<std::pair<CommandType, int> >& cmd_timing_list,
-        uint64_t clk);
-
-    // Update timing of banks in the same rank but different bankgroup as the
-    // command
-    void UpdateOtherBankgroupsSameRankTiming(
-        const Address& addr,
-        const std::vector<std::pair<CommandType, int> >& cmd_timing_list,
-        uint64_t clk);
-
-    // Update timing of banks in a different rank as the command
-    void UpdateOtherRanksTiming(
-        const Address& addr,
-        const std::vector<std::pair<CommandType, int> >& cmd_timing_list,
-        uint64_t clk);
-
-    // Update timing of the entire rank (for rank level commands)
-    void UpdateSameRankTiming(
-        const Address& addr,
+    Command GetBankReadyCommand(const Command& cmd, int bank_idx,
+                                uint64_t clk) const;
+    // Raise the timing constraints in |cmd_timing_list| to at least |clk|
+    // plus their delay for banks [begin, end)
+    void UpdateBankRangeTiming(
         const std::vector<std::pair<CommandType, int> >& cmd_timing_list,
-        uint64_t clk);
+        int begin, int end, uint64_t clk);
 };
 
 }  // namespace dramsim3
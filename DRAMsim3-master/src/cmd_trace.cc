@@ -0,0 +1,140 @@
+#include "cmd_trace.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+
+namespace dramsim3 {
+
+CommandTracer::CommandTracer(const std::string& file_name, int channels,
+                             size_t ring_records, uint64_t start,
+                             uint64_t end)
+    : file_(file_name, std::ofstream::out | std::ofstream::binary),
+      start_(start),
+      end_(end),
+      closed_(false),
+      wake_(false),
+      stop_(false) {
+    if (!file_) {
+        std::cerr << "Cannot open command trace file " << file_name
+                  << std::endl;
+        AbruptExit(__FILE__, __LINE__);
+    }
+    // power of two, so the ring index is a mask of the running count
+    size_t size = 2;
+    while (size < ring_records) {
+        size <<= 1;
+    }
+    mask_ = size - 1;
+    for (int i = 0; i < channels; i++) {
+        rings_.emplace_back(new Ring(size));
+    }
+    file_.write(kCmdTraceMagic, sizeof(kCmdTraceMagic));
+    std::cout << "Command trace write to " << file_name << std::endl;
+    writer_ = std::thread(&CommandTracer::DrainLoop, this);
+}
+
+CommandTracer::~CommandTracer() { Close(); }
+
+void CommandTracer::AddCommand(int channel, uint64_t clk,
+                               const Command& cmd) {
+    TraceRecord record;
+    std::memset(&record, 0, sizeof(record));
+    record.clk = clk;
+    record.hex_addr = cmd.hex_addr;
+    record.row = static_cast<uint32_t>(cmd.Row());
+    record.column = static_cast<uint16_t>(cmd.Column());
+    record.channel = static_cast<uint16_t>(channel);
+    record.type = static_cast<uint8_t>(cmd.cmd_type);
+    record.rank = static_cast<uint8_t>(cmd.Rank());
+    record.bankgroup = static_cast<uint8_t>(cmd.Bankgroup());
+    record.bank = static_cast<uint8_t>(cmd.Bank());
+    Push(channel, record);
+}
+
+void CommandTracer::AddTransaction(int channel, uint64_t clk,
+                                   uint64_t hex_addr, bool is_write) {
+    TraceRecord record;
+    std::memset(&record, 0, sizeof(record));
+    record.clk = clk;
+    record.hex_addr = hex_addr;
+    record.channel = static_cast<uint16_t>(channel);
+    record.type = is_write ? kTraceWrite : kTraceRead;
+    Push(channel, record);
+}
+
+void CommandTracer::Push(int channel, const TraceRecord& record) {
+    Ring& ring = *rings_[channel];
+    uint64_t head = ring.head.load(std::memory_order_relaxed);
+    while (head - ring.tail.load(std::memory_order_acquire) > mask_) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            wake_ = true;
+        }
+        cv_.notify_one();
+        std::this_thread::yield();
+    }
+    ring.records[head & mask_] = record;
+    ring.head.store(head + 1, std::memory_order_release);
+    // don't let the writer sleep through a filling ring
+    if (((head + 1) & (mask_ >> 1)) == 0) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            wake_ = true;
+        }
+        cv_.notify_one();
+    }
+}
+
+size_t CommandTracer::Drain() {
+    size_t drained = 0;
+    for (auto& ring : rings_) {
+        uint64_t tail = ring->tail.load(std::memory_order_relaxed);
+        uint64_t head = ring->head.load(std::memory_order_acquire);
+        while (tail != head) {
+            // up to the end of the ring in one write
+            size_t begin = tail & mask_;
+            size_t count =
+                std::min<uint64_t>(head - tail, mask_ + 1 - begin);
+            file_.write(reinterpret_cast<const char*>(&ring->records[begin]),
+                        count * sizeof(TraceRecord));
+            tail += count;
+            drained += count;
+        }
+        ring->tail.store(tail, std::memory_order_release);
+    }
+    return drained;
+}
+
+void CommandTracer::DrainLoop() {
+    while (true) {
+        if (Drain() > 0) {
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(mutex_);
+        if (stop_) {
+            break;
+        }
+        cv_.wait_for(lock, std::chrono::milliseconds(1),
+                     [this] { return wake_ || stop_; });
+        wake_ = false;
+    }
+    // the channels are done once stop_ is set
+    Drain();
+}
+
+void CommandTracer::Close() {
+    if (closed_) {
+        return;
+    }
+    closed_ = true;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+    cv_.notify_all();
+    writer_.join();
+    file_.close();
+}
+
+}  // namespace dramsim3
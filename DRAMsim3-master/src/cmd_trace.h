@@ -0,0 +1,93 @@
+#ifndef __CMD_TRACE_H
+#define __CMD_TRACE_H
+
+#include <stdint.h>
+#include <atomic>
+#include <condition_variable>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "common.h"
+
+namespace dramsim3 {
+
+// Magic bytes opening a binary command trace file
+static const char kCmdTraceMagic[8] = {'D', 'S', '3', 'C',
+                                       'M', 'D', 'T', '1'};
+
+// |type| of the transactions added to a channel, commands use their
+// CommandType
+static const uint8_t kTraceRead = 0x80;
+static const uint8_t kTraceWrite = 0x81;
+
+// One fixed-size record, in host byte order, per issued command or added
+// transaction. Transactions only fill |clk|, |hex_addr|, |channel| and
+// |type|.
+struct TraceRecord {
+    uint64_t clk;
+    uint64_t hex_addr;
+    uint32_t row;
+    uint16_t column;
+    uint16_t channel;
+    uint8_t type;
+    uint8_t rank;
+    uint8_t bankgroup;
+    uint8_t bank;
+    uint32_t reserved;
+};
+static_assert(sizeof(TraceRecord) == 32, "trace records are 32 bytes");
+
+// Records the commands and the transactions of every channel between
+// cycles |start| (inclusive) and |end| (exclusive) into one binary file:
+// kCmdTraceMagic, then TraceRecords. Each channel writes into its own
+// single producer ring buffer, so the controllers can run on the tick pool,
+// and a background thread drains the rings to the file. A full ring stalls
+// its channel until the writer catches up, nothing is dropped. Records of
+// one channel stay in order, the channels are interleaved in drain order;
+// the cmdtracedecode tool sorts them by cycle and prints the text formats.
+class CommandTracer {
+   public:
+    CommandTracer(const std::string& file_name, int channels,
+                  size_t ring_records, uint64_t start, uint64_t end);
+    ~CommandTracer();
+    CommandTracer(const CommandTracer&) = delete;
+    CommandTracer& operator=(const CommandTracer&) = delete;
+
+    bool InWindow(uint64_t clk) const { return clk >= start_ && clk < end_; }
+    void AddCommand(int channel, uint64_t clk, const Command& cmd);
+    void AddTransaction(int channel, uint64_t clk, uint64_t hex_addr,
+                        bool is_write);
+    // Drain the rings and close the file
+    void Close();
+
+   private:
+    struct Ring {
+        explicit Ring(size_t size) : records(size), head(0), tail(0) {}
+        std::vector<TraceRecord> records;
+        std::atomic<uint64_t> head;  // advanced by the channel
+        std::atomic<uint64_t> tail;  // advanced by the writer
+    };
+
+    void Push(int channel, const TraceRecord& record);
+    size_t Drain();
+    void DrainLoop();
+
+    std::ofstream file_;
+    uint64_t start_;
+    uint64_t end_;
+    size_t mask_;
+    std::vector<std::unique_ptr<Ring>> rings_;
+    bool closed_;
+
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    bool wake_;
+    bool stop_;
+    std::thread writer_;
+};
+
+}  // namespace dramsim3
+#endif  // __CMD_TRACE_H
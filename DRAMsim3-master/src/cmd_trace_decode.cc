@@ -0,0 +1,127 @@
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+#include "./../ext/headers/args.hxx"
+#include "cmd_trace.h"
+
+// this will not be used in a library file so it's ok to do this
+using namespace dramsim3;
+
+namespace {
+
+bool IsTransaction(const TraceRecord &record) {
+    return record.type == kTraceRead || record.type == kTraceWrite;
+}
+
+// the text formats the CMD_TRACE / ADDR_TRACE builds used to write, the
+// command one is what scripts/validation.py reads and the transaction one
+// is a trace dramsim3main can replay
+void PrintRecord(std::ostream &os, const TraceRecord &record) {
+    if (IsTransaction(record)) {
+        os << std::hex << record.hex_addr << std::dec << " "
+           << (record.type == kTraceWrite ? "WRITE " : "READ ") << record.clk
+           << std::endl;
+        return;
+    }
+    Address addr(record.channel, record.rank, record.bankgroup, record.bank,
+                 record.row, record.column);
+    Command cmd(static_cast<CommandType>(record.type), addr, record.hex_addr);
+    os << std::left << std::setw(18) << record.clk << " " << cmd << std::endl;
+}
+
+}  // namespace
+
+// Turn the binary trace of cmd_trace / addr_trace back into text, sorted
+// by cycle
+int main(int argc, const char **argv) {
+    args::ArgumentParser parser(
+        "Decode a DRAMsim3 binary command and transaction trace.",
+        "Examples: \n"
+        "./build/cmdtracedecode dramsim3trace.bin -c 0 --commands\n"
+        "./build/cmdtracedecode dramsim3trace.bin -o decoded_\n"
+        "With -o every channel gets a <prefix>ch_<n>cmd.trace file and the "
+        "transactions go to <prefix>addr.trace.");
+    args::HelpFlag help(parser, "help", "Display the help menu", {'h', "help"});
+    args::ValueFlag<int> channel_arg(parser, "channel",
+                                     "Only this channel, -1 = all",
+                                     {'c', "channel"}, -1);
+    args::Flag commands_arg(parser, "commands", "Only the commands",
+                            {"commands"});
+    args::Flag transactions_arg(parser, "transactions",
+                                "Only the transactions", {"transactions"});
+    args::ValueFlag<std::string> prefix_arg(
+        parser, "output_prefix", "Write files instead of to stdout",
+        {'o', "output-prefix"});
+    args::Positional<std::string> input_arg(
+        parser, "input", "binary trace file (mandatory)");
+
+    try {
+        parser.ParseCLI(argc, argv);
+    } catch (args::Help) {
+        std::cout << parser;
+        return 0;
+    } catch (args::ParseError e) {
+        std::cerr << e.what() << std::endl;
+        std::cerr << parser;
+        return 1;
+    }
+
+    std::string input_name = args::get(input_arg);
+    if (input_name.empty()) {
+        std::cerr << parser;
+        return 1;
+    }
+    std::ifstream in(input_name, std::ifstream::binary);
+    char magic[sizeof(kCmdTraceMagic)];
+    if (!in.read(magic, sizeof(magic)) ||
+        std::memcmp(magic, kCmdTraceMagic, sizeof(magic)) != 0) {
+        std::cerr << input_name << " is not a command trace" << std::endl;
+        return 1;
+    }
+
+    int channel = args::get(channel_arg);
+    bool commands = !transactions_arg;
+    bool transactions = !commands_arg;
+    std::vector<TraceRecord> records;
+    TraceRecord record;
+    while (in.read(reinterpret_cast<char *>(&record), sizeof(record))) {
+        if ((channel >= 0 && record.channel != channel) ||
+            (IsTransaction(record) ? !transactions : !commands)) {
+            continue;
+        }
+        records.push_back(record);
+    }
+    // each channel wrote in order, only the channels interleave
+    std::stable_sort(records.begin(), records.end(),
+                     [](const TraceRecord &a, const TraceRecord &b) {
+                         return a.clk < b.clk;
+                     });
+
+    if (!prefix_arg) {
+        for (const auto &r : records) {
+            PrintRecord(std::cout, r);
+        }
+        return 0;
+    }
+    std::string prefix = args::get(prefix_arg);
+    std::map<std::string, std::unique_ptr<std::ofstream>> files;
+    for (const auto &r : records) {
+        std::string name =
+            IsTransaction(r)
+                ? prefix + "addr.trace"
+                : prefix + "ch_" + std::to_string(r.channel) + "cmd.trace";
+        auto &file = files[name];
+        if (!file) {
+            file.reset(new std::ofstream(name));
+            std::cout << "writing " << name << std::endl;
+        }
+        PrintRecord(*file, r);
+    }
+    return 0;
+}
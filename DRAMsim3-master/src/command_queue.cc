@@ -1,4 +1,6 @@
 #include "command_queue.h"
+#include <algorithm>
+#include <limits>
 
 namespace dramsim3 {
 
@@ -9,6 +11,11 @@ CommandQueue::CommandQueue(int channel_id, const Config& config,
       config_(config),
       channel_state_(channel_state),
       simple_stats_(simple_stats),
+      num_ondemand_pres_(simple_stats.GetStatId("num_ondemand_pres")),
+      num_row_hit_cap_pres_(simple_stats.GetStatId("num_row_hit_cap_pres")),
+      scheduler_(MakeScheduler(config, simple_stats)),
+      ranked_(scheduler_->Ranks()),
+      row_hit_cap_(scheduler_->RowHitCap()),
       is_in_ref_(false),
       queue_size_(static_cast<size_t>(config_.cmd_queue_size)),
       queue_idx_(0),
@@ -25,6 +32,8 @@ CommandQueue::CommandQueue(int channel_id, const Config& config,
         AbruptExit(__FILE__, __LINE__);
     }
 
+    ready_at_.assign(num_queues_, 0);
+    ready_version_.assign(num_queues_, 0);
     queues_.reserve(num_queues_);
     for (int i = 0; i < num_queues_; i++) {
         auto cmd_queue = std::vector<Command>();
@@ -34,25 +43,92 @@ CommandQueue::CommandQueue(int channel_id, const Config& config,
 }
 
 Command CommandQueue::GetCommandToIssue() {
+    if (ranked_) {
+        return GetRankedCommandToIssue();
+    }
     for (int i = 0; i < num_queues_; i++) {
         auto& queue = GetNextQueue();
-        // if we're refresing, skip the command queues that are involved
-        if (is_in_ref_) {
-            if (ref_q_indices_.find(queue_idx_) != ref_q_indices_.end()) {
-                continue;
-            }
+        if (QueueSkipped(queue_idx_)) {
+            continue;
         }
-        auto cmd = GetFirstReadyInQueue(queue);
+        size_t cmd_idx;
+        uint64_t ready_at;
+        auto cmd = GetFirstReadyInQueue(queue, cmd_idx, ready_at);
         if (cmd.IsValid()) {
-            if (cmd.IsReadWrite()) {
-                EraseRWCommand(cmd);
+            ready_at_[queue_idx_] = 0;
+            if (cmd.cmd_type == CommandType::PRECHARGE) {
+                CountPrecharge(queue.begin() + cmd_idx, queue);
+            } else if (cmd.IsReadWrite()) {
+                queue.erase(queue.begin() + cmd_idx);
             }
             return cmd;
         }
+        ready_at_[queue_idx_] = ready_at;
+        ready_version_[queue_idx_] = QueueStateVersion(queue_idx_);
     }
     return Command();
 }
 
+Command CommandQueue::GetRankedCommandToIssue() {
+    scheduler_->Update(queues_, clk_);
+    int best_q = -1;
+    size_t best_idx = 0;
+    Command best;
+    for (int q_idx = 0; q_idx < num_queues_; q_idx++) {
+        if (QueueSkipped(q_idx)) {
+            continue;
+        }
+        auto& queue = queues_[q_idx];
+        uint64_t ready_at = std::numeric_limits<uint64_t>::max();
+        bool found = false;
+        for (auto cmd_it = queue.begin(); cmd_it != queue.end(); cmd_it++) {
+            Command cmd = GetReadyCommand(cmd_it, queue, ready_at);
+            if (!cmd.IsValid()) {
+                continue;
+            }
+            found = true;
+            if (best_q >= 0 &&
+                !Outranks(*cmd_it, cmd, queues_[best_q][best_idx], best)) {
+                continue;
+            }
+            best_q = q_idx;
+            best_idx = cmd_it - queue.begin();
+            best = cmd;
+        }
+        if (!found) {
+            ready_at_[q_idx] = ready_at;
+            ready_version_[q_idx] = QueueStateVersion(q_idx);
+        }
+    }
+    if (best_q < 0) {
+        return Command();
+    }
+    ready_at_[best_q] = 0;
+    auto& queue = queues_[best_q];
+    if (best.cmd_type == CommandType::PRECHARGE) {
+        CountPrecharge(queue.begin() + best_idx, queue);
+    } else if (best.IsReadWrite()) {
+        scheduler_->Served(queue[best_idx], clk_);
+        queue.erase(queue.begin() + best_idx);
+    }
+    return best;
+}
+
+bool CommandQueue::Outranks(const Command& queued, const Command& ready,
+                            const Command& other_queued,
+                            const Command& other_ready) const {
+    // higher priority, then row hits, then older
+    int priority = scheduler_->Priority(queued, clk_);
+    int other_priority = scheduler_->Priority(other_queued, clk_);
+    if (priority != other_priority) {
+        return priority < other_priority;
+    }
+    if (ready.IsReadWrite() != other_ready.IsReadWrite()) {
+        return ready.IsReadWrite();
+    }
+    return queued.added_cycle < other_queued.added_cycle;
+}
+
 Command CommandQueue::FinishRefresh() {
     // we can do something fancy here like clearing the R/Ws
     // that already had ACT on the way but by doing that we
@@ -86,27 +162,35 @@ bool CommandQueue::ArbitratePrecharge(const CMDIterator& cmd_it,
         }
     }
 
-    bool pending_row_hits_exist = false;
-    int open_row =
-        channel_state_.OpenRow(cmd.Rank(), cmd.Bankgroup(), cmd.Bank());
+    if (!PendingRowHits(cmd_it, queue)) {
+        return true;
+    }
+    return row_hit_cap_ > 0 &&
+           channel_state_.RowHitCount(cmd.Rank(), cmd.Bankgroup(),
+                                      cmd.Bank()) >= row_hit_cap_;
+}
+
+bool CommandQueue::PendingRowHits(const CMDIterator& cmd_it,
+                                  const CMDQueue& queue) const {
+    int open_row = channel_state_.OpenRow(cmd_it->Rank(), cmd_it->Bankgroup(),
+                                          cmd_it->Bank());
     for (auto pending_itr = cmd_it; pending_itr != queue.end(); pending_itr++) {
         if (pending_itr->Row() == open_row &&
-            pending_itr->Bank() == cmd.Bank() &&
-            pending_itr->Bankgroup() == cmd.Bankgroup() &&
-            pending_itr->Rank() == cmd.Rank()) {
-            pending_row_hits_exist = true;
-            break;
+            pending_itr->Bank() == cmd_it->Bank() &&
+            pending_itr->Bankgroup() == cmd_it->Bankgroup() &&
+            pending_itr->Rank() == cmd_it->Rank()) {
+            return true;
         }
     }
+    return false;
+}
 
-    bool rowhit_limit_reached =
-        channel_state_.RowHitCount(cmd.Rank(), cmd.Bankgroup(), cmd.Bank()) >=
-        4;
-    if (!pending_row_hits_exist || rowhit_limit_reached) {
-        simple_stats_.Increment("num_ondemand_pres");
-        return true;
+void CommandQueue::CountPrecharge(const CMDIterator& cmd_it,
+                                  const CMDQueue& queue) {
+    simple_stats_.Increment(num_ondemand_pres_);
+    if (PendingRowHits(cmd_it, queue)) {
+        simple_stats_.Increment(num_row_hit_cap_pres_);
     }
-    return false;
 }
 
 bool CommandQueue::WillAcceptCommand(int rank, int bankgroup, int bank) const {
@@ -115,7 +199,7 @@ bool CommandQueue::WillAcceptCommand(int rank, int bankgroup, int bank) const {
 }
 
 bool CommandQueue::QueueEmpty() const {
-    for (const auto q : queues_) {
+    for (const auto& q : queues_) {
         if (!q.empty()) {
             return false;
         }
@@ -125,9 +209,11 @@ bool CommandQueue::QueueEmpty() const {
 
 
 bool CommandQueue::AddCommand(Command cmd) {
-    auto& queue = GetQueue(cmd.Rank(), cmd.Bankgroup(), cmd.Bank());
+    int q_idx = GetQueueIndex(cmd.Rank(), cmd.Bankgroup(), cmd.Bank());
+    auto& queue = queues_[q_idx];
     if (queue.size() < queue_size_) {
         queue.push_back(cmd);
+        ready_at_[q_idx] = 0;
         rank_q_empty[cmd.Rank()] = false;
         return true;
     } else {
@@ -175,36 +261,62 @@ CMDQueue& CommandQueue::GetQueue(int rank, int bankgroup, int bank) {
     return queues_[index];
 }
 
-Command CommandQueue::GetFirstReadyInQueue(CMDQueue& queue) const {
-    for (auto cmd_it = queue.begin(); cmd_it != queue.end(); cmd_it++) {
-        Command cmd = channel_state_.GetReadyCommand(*cmd_it, clk_);
-        if (!cmd.IsValid()) {
-            continue;
+bool CommandQueue::QueueSkipped(int q_idx) const {
+    // if we're refresing, skip the command queues that are involved
+    if (is_in_ref_ && ref_q_indices_.find(q_idx) != ref_q_indices_.end()) {
+        return true;
+    }
+    // nothing in this queue can be ready yet
+    return clk_ < ready_at_[q_idx] &&
+           ready_version_[q_idx] == QueueStateVersion(q_idx);
+}
+
+Command CommandQueue::GetReadyCommand(const CMDIterator& cmd_it,
+                                      const CMDQueue& queue,
+                                      uint64_t& ready_at) const {
+    Command cmd = channel_state_.GetReadyCommand(*cmd_it, clk_);
+    if (!cmd.IsValid()) {
+        ready_at = std::min(
+            ready_at, channel_state_.BankEarliestReady(
+                          cmd_it->Rank(), cmd_it->Bankgroup(), cmd_it->Bank()));
+        return cmd;
+    }
+    // held back by arbitration rather than timing, look again next cycle
+    if (cmd.cmd_type == CommandType::PRECHARGE) {
+        if (!ArbitratePrecharge(cmd_it, queue)) {
+            ready_at = clk_;
+            return Command();
         }
-        if (cmd.cmd_type == CommandType::PRECHARGE) {
-            if (!ArbitratePrecharge(cmd_it, queue)) {
-                continue;
-            }
-        } else if (cmd.IsWrite()) {
-            if (HasRWDependency(cmd_it, queue)) {
-                continue;
-            }
+    } else if (cmd.IsWrite()) {
+        if (HasRWDependency(cmd_it, queue)) {
+            ready_at = clk_;
+            return Command();
         }
-        return cmd;
     }
-    return Command();
+    return cmd;
 }
 
-void CommandQueue::EraseRWCommand(const Command& cmd) {
-    auto& queue = GetQueue(cmd.Rank(), cmd.Bankgroup(), cmd.Bank());
+Command CommandQueue::GetFirstReadyInQueue(CMDQueue& queue, size_t& cmd_idx,
+                                           uint64_t& ready_at) const {
+    ready_at = std::numeric_limits<uint64_t>::max();
     for (auto cmd_it = queue.begin(); cmd_it != queue.end(); cmd_it++) {
-        if (cmd.hex_addr == cmd_it->hex_addr && cmd.cmd_type == cmd_it->cmd_type) {
-            queue.erase(cmd_it);
-            return;
+        Command cmd = GetReadyCommand(cmd_it, queue, ready_at);
+        if (cmd.IsValid()) {
+            cmd_idx = cmd_it - queue.begin();
+            return cmd;
         }
     }
-    std::cerr << "cannot find cmd!" << std::endl;
-    exit(1);
+    return Command();
+}
+
+uint64_t CommandQueue::QueueStateVersion(int q_idx) const {
+    if (queue_structure_ == QueueStructure::PER_RANK) {
+        return channel_state_.RankStateVersion(q_idx);
+    }
+    int bank_idx = q_idx % config_.banks;
+    return channel_state_.BankStateVersion(q_idx / config_.banks,
+                                           bank_idx / config_.banks_per_group,
+                                           bank_idx % config_.banks_per_group);
 }
 
 int CommandQueue::QueueUsage() const {
@@ -1,17 +1,17 @@
 #ifndef __COMMAND_QUEUE_H
 #define __COMMAND_QUEUE_H
 
+#include <memory>
 #include <unordered_set>
 #include <vector>
 #include "channel_state.h"
 #include "common.h"
 #include "configuration.h"
+#include "scheduler.h"
 #include "simple_stats.h"
 
 namespace dramsim3 {
 
-using CMDIterator = std::vector<Command>::iterator;
-using CMDQueue = std::vector<Command>;
 enum class QueueStructure { PER_RANK, PER_BANK, SIZE };
 
 class CommandQueue {
@@ -21,6 +21,7 @@ class CommandQueue {
     Command GetCommandToIssue();
     Command FinishRefresh();
     void ClockTick() { clk_ += 1; };
+    void ClockTickUntil(uint64_t clk) { clk_ = clk; }
     bool WillAcceptCommand(int rank, int bankgroup, int bank) const;
     bool AddCommand(Command cmd);
     bool QueueEmpty() const;
@@ -30,23 +31,53 @@ class CommandQueue {
    private:
     bool ArbitratePrecharge(const CMDIterator& cmd_it,
                             const CMDQueue& queue) const;
+    // a command behind |cmd_it| hits the row open in its bank
+    bool PendingRowHits(const CMDIterator& cmd_it, const CMDQueue& queue) const;
+    void CountPrecharge(const CMDIterator& cmd_it, const CMDQueue& queue);
     bool HasRWDependency(const CMDIterator& cmd_it,
                          const CMDQueue& queue) const;
-    Command GetFirstReadyInQueue(CMDQueue& queue) const;
+    // The command |cmd_it| needs next if it can issue now, otherwise an
+    // invalid one and |ready_at| is lowered to when it might
+    Command GetReadyCommand(const CMDIterator& cmd_it, const CMDQueue& queue,
+                            uint64_t& ready_at) const;
+    // On success |cmd_idx| is the position of the queued command; otherwise
+    // |ready_at| is a lower bound on the cycle anything in |queue| can issue
+    Command GetFirstReadyInQueue(CMDQueue& queue, size_t& cmd_idx,
+                                 uint64_t& ready_at) const;
+    // the best ready command of all the queues by the scheduler's ranking
+    Command GetRankedCommandToIssue();
+    // whether |queued|, whose next command is |ready|, goes before the other
+    bool Outranks(const Command& queued, const Command& ready,
+                  const Command& other_queued,
+                  const Command& other_ready) const;
+    bool QueueSkipped(int q_idx) const;
     int GetQueueIndex(int rank, int bankgroup, int bank) const;
     CMDQueue& GetQueue(int rank, int bankgroup, int bank);
     CMDQueue& GetNextQueue();
     void GetRefQIndices(const Command& ref);
-    void EraseRWCommand(const Command& cmd);
+    uint64_t QueueStateVersion(int q_idx) const;
     Command PrepRefCmd(const CMDIterator& it, const Command& ref) const;
 
     QueueStructure queue_structure_;
     const Config& config_;
     const ChannelState& channel_state_;
     SimpleStats& simple_stats_;
+    StatId num_ondemand_pres_;
+    StatId num_row_hit_cap_pres_;
+
+    std::unique_ptr<Scheduler> scheduler_;
+    bool ranked_;
+    int row_hit_cap_;
 
     std::vector<CMDQueue> queues_;
 
+    // Per queue, the earliest cycle any of its commands can be ready, as of
+    // the bank state version it was computed under. Timing constraints only
+    // move forward, so a queue is skipped while clk_ is short of it and
+    // neither its banks changed state nor a command was added.
+    std::vector<uint64_t> ready_at_;
+    std::vector<uint64_t> ready_version_;
+
     // Refresh related data structures
     std::unordered_set<int> ref_q_indices_;
     bool is_in_ref_;
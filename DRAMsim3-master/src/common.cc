@@ -38,6 +38,8 @@ std::istream& operator>>(std::istream& is, Transaction& trans) {
     std::string mem_op;
     is >> std::hex >> trans.addr >> mem_op >> std::dec >> trans.added_cycle;
     trans.is_write = write_types.count(mem_op) == 1;
+    trans.id = trans.addr;
+    trans.requester = -1;
     return is;
 }
 
@@ -66,9 +66,19 @@ enum class CommandType {
 };
 
 struct Command {
-    Command() : cmd_type(CommandType::SIZE), hex_addr(0) {}
+    Command()
+        : cmd_type(CommandType::SIZE),
+          hex_addr(0),
+          requester(-1),
+          added_cycle(0),
+          marked(false) {}
     Command(CommandType cmd_type, const Address& addr, uint64_t hex_addr)
-        : cmd_type(cmd_type), addr(addr), hex_addr(hex_addr) {}
+        : cmd_type(cmd_type),
+          addr(addr),
+          hex_addr(hex_addr),
+          requester(-1),
+          added_cycle(0),
+          marked(false) {}
     // Command(const Command& cmd) {}
 
     bool IsValid() const { return cmd_type != CommandType::SIZE; }
@@ -93,6 +103,10 @@ struct Command {
     CommandType cmd_type;
     Address addr;
     uint64_t hex_addr;
+    // of the transaction a queued R/W command serves, for the schedulers
+    int requester;
+    uint64_t added_cycle;
+    bool marked;  // in the current batch of the BATCH scheduler
 
     int Channel() const { return addr.channel; }
     int Rank() const { return addr.rank; }
@@ -108,15 +122,30 @@ struct Transaction {
     Transaction() {}
     Transaction(uint64_t addr, bool is_write)
         : addr(addr),
+          id(addr),
+          requester(-1),
+          added_cycle(0),
+          complete_cycle(0),
+          is_write(is_write) {}
+    Transaction(uint64_t addr, bool is_write, uint64_t id)
+        : addr(addr),
+          id(id),
+          requester(-1),
           added_cycle(0),
           complete_cycle(0),
           is_write(is_write) {}
     Transaction(const Transaction& tran)
         : addr(tran.addr),
+          id(tran.id),
+          requester(tran.requester),
           added_cycle(tran.added_cycle),
           complete_cycle(tran.complete_cycle),
           is_write(tran.is_write) {}
     uint64_t addr;
+    // handed back on completion, the address unless the caller gave one
+    uint64_t id;
+    // index into the per-requester stats, -1 if not attributed
+    int requester;
     uint64_t added_cycle;
     uint64_t complete_cycle;
     bool is_write;
@@ -1,13 +1,114 @@
 #include "configuration.h"
 
+#include <unistd.h>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <type_traits>
 #include <vector>
 
+#include "epoch_writer.h"
+
 #ifdef THERMAL
 #include <math.h>
 #endif  // THERMAL
 
 namespace dramsim3 {
 
+namespace {
+
+// Magic bytes opening a serialized Config
+const char kConfigBlobMagic[8] = {'D', 'S', '3', 'C', 'F', 'G', '0', '1'};
+
+// Part of the cache key. Bump it whenever VisitFields, a default value or a
+// derived field changes, so a newer build never reads an old blob; the size
+// and the field count of Config only catch layout changes
+const uint32_t kConfigBlobVersion = 1;
+
+// PODs are stored in host layout, strings with a uint32 length in front
+class BlobWriter {
+   public:
+    explicit BlobWriter(std::string& blob) : blob_(blob) {}
+    template <typename T>
+    void operator()(const T& value) {
+        static_assert(std::is_trivially_copyable<T>::value, "POD fields only");
+        blob_.append(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+    void operator()(const std::string& value) {
+        (*this)(static_cast<uint32_t>(value.size()));
+        blob_.append(value);
+    }
+
+   private:
+    std::string& blob_;
+};
+
+// Counts the fields VisitFields serializes
+class FieldCounter {
+   public:
+    template <typename T>
+    void operator()(const T&) {
+        ++count;
+    }
+    size_t count = 0;
+};
+
+class BlobReader {
+   public:
+    BlobReader(const std::string& blob, size_t pos)
+        : blob_(blob), pos_(pos), ok_(true) {}
+    template <typename T>
+    void operator()(T& value) {
+        static_assert(std::is_trivially_copyable<T>::value, "POD fields only");
+        if (Take(sizeof(T))) {
+            std::memcpy(&value, blob_.data() + pos_ - sizeof(T), sizeof(T));
+        }
+    }
+    void operator()(std::string& value) {
+        uint32_t len = 0;
+        (*this)(len);
+        if (Take(len)) {
+            value.assign(blob_.data() + pos_ - len, len);
+        }
+    }
+    // everything read and nothing left over
+    bool Done() const { return ok_ && pos_ == blob_.size(); }
+
+   private:
+    bool Take(size_t len) {
+        ok_ = ok_ && blob_.size() - pos_ >= len;
+        if (ok_) {
+            pos_ += len;
+        }
+        return ok_;
+    }
+
+    const std::string& blob_;
+    size_t pos_;
+    bool ok_;
+};
+
+// FNV-1a over the INI text and the blob layout; 0 if the file can't be read
+uint64_t HashConfigFile(const std::string& file_name, size_t num_fields) {
+    std::ifstream in(file_name, std::ifstream::binary);
+    if (!in) {
+        return 0;
+    }
+    std::stringstream text;
+    text << in.rdbuf() << '\0' << kConfigBlobVersion << ' ' << sizeof(Config)
+         << ' ' << num_fields;
+    uint64_t hash = 14695981039346656037ull;
+    for (char c : text.str()) {
+        hash = (hash ^ static_cast<unsigned char>(c)) * 1099511628211ull;
+    }
+    return hash;
+}
+
+}  // namespace
+
 Config::Config(std::string config_file, std::string out_dir)
     : output_dir(out_dir), reader_(new INIReader(config_file)) {
     if (reader_->ParseError() < 0) {
@@ -160,6 +261,40 @@ void Config::InitOtherParams() {
     // 1: default value, adds epoch CSV output on level 0
     // 2: adds histogram outputs in a different CSV format
     output_level = reader.GetInteger("other", "output_level", 1);
+    // channel controllers share no state, so they can be ticked on a
+    // worker pool; callbacks are still issued from the calling thread
+    tick_threads = GetInteger("other", "tick_threads", 1);
+    if (tick_threads < 1) {
+        tick_threads = 1;
+    }
+    output_name_ = reader.Get("other", "output_prefix", "dramsim3");
+    // epoch stats can also be streamed as NDJSON or length-prefixed
+    // MessagePack, which epochconvert turns back into the JSON array
+    epoch_format = reader.Get("other", "epoch_format", "json");
+    EpochWriter::ParseFormat(epoch_format);
+    // binary command and transaction traces within [trace_start,
+    // trace_end), turned into text by cmdtracedecode
+    cmd_trace = reader.GetBoolean("other", "cmd_trace", false);
+    addr_trace = reader.GetBoolean("other", "addr_trace", false);
+    long start_cycle = reader.GetInteger("other", "trace_start", 0);
+    long end_cycle = reader.GetInteger("other", "trace_end", -1);
+    trace_ring_records =
+        GetInteger("other", "trace_ring_records", 1 << 16);
+    if (start_cycle < 0 || (end_cycle >= 0 && end_cycle <= start_cycle) ||
+        trace_ring_records < 1) {
+        std::cerr << "Invalid trace window [" << start_cycle << ", "
+                  << end_cycle << ") or trace_ring_records "
+                  << trace_ring_records << std::endl;
+        AbruptExit(__FILE__, __LINE__);
+    }
+    trace_start = start_cycle;
+    trace_end = end_cycle < 0 ? std::numeric_limits<uint64_t>::max()
+                              : end_cycle;
+    InitOutputNames();
+    return;
+}
+
+void Config::InitOutputNames() {
     // Other Parameters
     // give a prefix instead of specify the output name one by one...
     // this would allow outputing to a directory and you can always override
@@ -172,12 +307,13 @@ void Config::InitOtherParams() {
     } else {
         output_dir = output_dir + "/";
     }
-    output_prefix =
-        output_dir + reader.Get("other", "output_prefix", "dramsim3");
+    output_prefix = output_dir + output_name_;
     json_stats_name = output_prefix + ".json";
-    json_epoch_name = output_prefix + "epoch.json";
+    json_epoch_name =
+        output_prefix +
+        EpochWriter::FileSuffix(EpochWriter::ParseFormat(epoch_format));
     txt_stats_name = output_prefix + ".txt";
-    return;
+    trace_file_name = output_prefix + "trace.bin";
 }
 
 void Config::InitPowerParams() {
@@ -226,6 +362,18 @@ void Config::InitSystemParams() {
     trans_queue_size = GetInteger("system", "trans_queue_size", 32);
     unified_queue = reader.GetBoolean("system", "unified_queue", false);
     write_buf_size = GetInteger("system", "write_buf_size", 16);
+    write_high_watermark =
+        GetInteger("system", "write_high_watermark", trans_queue_size);
+    write_low_watermark = GetInteger("system", "write_low_watermark", 0);
+    write_idle_drain = GetInteger("system", "write_idle_drain", 8);
+    if (write_high_watermark < 1 || write_high_watermark > trans_queue_size ||
+        write_low_watermark < 0 ||
+        write_low_watermark >= write_high_watermark || write_idle_drain < 0) {
+        std::cerr << "write watermarks must satisfy 0 <= low < high <= "
+                     "trans_queue_size"
+                  << std::endl;
+        AbruptExit(__FILE__, __LINE__);
+    }
     std::string ref_policy =
         reader.Get("system", "refresh_policy", "RANK_LEVEL_STAGGERED");
     if (ref_policy == "RANK_LEVEL_SIMULTANEOUS") {
@@ -238,6 +386,61 @@ void Config::InitSystemParams() {
         AbruptExit(__FILE__, __LINE__);
     }
 
+    refresh_postpone = GetInteger("system", "refresh_postpone", 0);
+    if (refresh_postpone < 0 || refresh_postpone > 8) {
+        std::cerr << "refresh_postpone must be between 0 and 8" << std::endl;
+        AbruptExit(__FILE__, __LINE__);
+    }
+
+    num_requesters = GetInteger("system", "num_requesters", 0);
+    if (num_requesters < 0) {
+        std::cerr << "num_requesters must not be negative" << std::endl;
+        AbruptExit(__FILE__, __LINE__);
+    }
+
+    std::string sched = reader.Get("system", "scheduler", "FRFCFS");
+    if (sched == "FRFCFS") {
+        scheduler = SchedulerPolicy::FRFCFS;
+    } else if (sched == "FRFCFS_CAP") {
+        scheduler = SchedulerPolicy::FRFCFS_CAP;
+    } else if (sched == "BLISS") {
+        scheduler = SchedulerPolicy::BLISS;
+    } else if (sched == "ATLAS") {
+        scheduler = SchedulerPolicy::ATLAS;
+    } else if (sched == "BATCH") {
+        scheduler = SchedulerPolicy::BATCH;
+    } else {
+        std::cerr << "Unknown scheduler " << sched << std::endl;
+        AbruptExit(__FILE__, __LINE__);
+    }
+    row_hit_cap = GetInteger("system", "row_hit_cap", 4);
+    bliss_threshold = GetInteger("system", "bliss_threshold", 4);
+    bliss_clear_interval = GetInteger("system", "bliss_clear_interval", 10000);
+    atlas_quantum = GetInteger("system", "atlas_quantum", 10000);
+    atlas_starvation = GetInteger("system", "atlas_starvation", 100000);
+    batch_cap = GetInteger("system", "batch_cap", 5);
+    if (row_hit_cap < 0 || bliss_threshold < 1 || bliss_clear_interval < 1 ||
+        atlas_quantum < 1 || atlas_starvation < 1 || batch_cap < 1) {
+        std::cerr << "Invalid scheduler parameters" << std::endl;
+        AbruptExit(__FILE__, __LINE__);
+    }
+
+    std::string model = reader.Get("system", "memory_model", "JEDEC");
+    if (model == "JEDEC") {
+        memory_model = MemoryModel::JEDEC;
+    } else if (model == "IDEAL") {
+        memory_model = MemoryModel::IDEAL;
+    } else if (model == "ANALYTIC") {
+        memory_model = MemoryModel::ANALYTIC;
+    } else {
+        std::cerr << "Unknown memory_model " << model << std::endl;
+        AbruptExit(__FILE__, __LINE__);
+    }
+    analytic_latency_scale =
+        reader.GetReal("system", "analytic_latency_scale", 1.0);
+    analytic_latency_offset =
+        reader.GetReal("system", "analytic_latency_offset", 0.0);
+
     enable_self_refresh =
         reader.GetBoolean("system", "enable_self_refresh", false);
     sref_threshold = GetInteger("system", "sref_threshold", 1000);
@@ -416,4 +619,245 @@ void Config::SetAddressMapping() {
    // std::cout<<"co_mask"<<std::hex << co_mask<<std::endl;
 }
 
+template <typename Visitor>
+void Config::VisitFields(Visitor& visit) {
+    visit(protocol);
+    visit(channel_size);
+    visit(channels);
+    visit(ranks);
+    visit(banks);
+    visit(bankgroups);
+    visit(banks_per_group);
+    visit(rows);
+    visit(columns);
+    visit(device_width);
+    visit(bus_width);
+    visit(devices_per_rank);
+    visit(BL);
+
+    visit(shift_bits);
+    visit(ch_pos);
+    visit(ra_pos);
+    visit(bg_pos);
+    visit(ba_pos);
+    visit(ro_pos);
+    visit(co_pos);
+    visit(ch_mask);
+    visit(ra_mask);
+    visit(bg_mask);
+    visit(ba_mask);
+    visit(ro_mask);
+    visit(co_mask);
+
+    visit(tCK);
+    visit(burst_cycle);
+    visit(AL);
+    visit(CL);
+    visit(CWL);
+    visit(RL);
+    visit(WL);
+    visit(tCCD_L);
+    visit(tCCD_S);
+    visit(tRTRS);
+    visit(tRTP);
+    visit(tWTR_L);
+    visit(tWTR_S);
+    visit(tWR);
+    visit(tRP);
+    visit(tRRD_L);
+    visit(tRRD_S);
+    visit(tRAS);
+    visit(tRCD);
+    visit(tRFC);
+    visit(tRC);
+    visit(tCKE);
+    visit(tCKESR);
+    visit(tXS);
+    visit(tXP);
+    visit(tRFCb);
+    visit(tREFI);
+    visit(tREFIb);
+    visit(tFAW);
+    visit(tRPRE);
+    visit(tWPRE);
+    visit(read_delay);
+    visit(write_delay);
+    visit(tPPD);
+    visit(t32AW);
+    visit(tRCDRD);
+    visit(tRCDWR);
+
+    // pre_energy_inc and num_vaults are never set
+    visit(act_energy_inc);
+    visit(read_energy_inc);
+    visit(write_energy_inc);
+    visit(ref_energy_inc);
+    visit(refb_energy_inc);
+    visit(act_stb_energy_inc);
+    visit(pre_stb_energy_inc);
+    visit(pre_pd_energy_inc);
+    visit(sref_energy_inc);
+
+    visit(num_links);
+    visit(num_dies);
+    visit(link_width);
+    visit(link_speed);
+    visit(block_size);
+    visit(xbar_queue_depth);
+
+    visit(address_mapping);
+    visit(queue_structure);
+    visit(row_buf_policy);
+    visit(refresh_policy);
+    visit(refresh_postpone);
+    visit(num_requesters);
+    visit(scheduler);
+    visit(row_hit_cap);
+    visit(bliss_threshold);
+    visit(bliss_clear_interval);
+    visit(atlas_quantum);
+    visit(atlas_starvation);
+    visit(batch_cap);
+    visit(memory_model);
+    visit(analytic_latency_scale);
+    visit(analytic_latency_offset);
+    visit(cmd_queue_size);
+    visit(unified_queue);
+    visit(trans_queue_size);
+    visit(write_buf_size);
+    visit(write_high_watermark);
+    visit(write_low_watermark);
+    visit(write_idle_drain);
+    visit(enable_self_refresh);
+    visit(sref_threshold);
+    visit(aggressive_precharging_enabled);
+    visit(enable_hbm_dual_cmd);
+
+    // the output paths are derived from output_dir by InitOutputNames()
+    visit(epoch_period);
+    visit(output_level);
+    visit(tick_threads);
+    visit(output_name_);
+    visit(epoch_format);
+    visit(cmd_trace);
+    visit(addr_trace);
+    visit(trace_start);
+    visit(trace_end);
+    visit(trace_ring_records);
+
+    visit(request_size_bytes);
+    visit(ideal_memory_latency);
+
+#ifdef THERMAL
+    visit(loc_mapping);
+    visit(num_row_refresh);
+    visit(amb_temp);
+    visit(const_logic_power);
+    visit(chip_dim_x);
+    visit(chip_dim_y);
+    visit(num_x_grids);
+    visit(num_y_grids);
+    visit(mat_dim_x);
+    visit(mat_dim_y);
+    visit(bank_order);
+    visit(bank_layer_order);
+    visit(row_tile);
+    visit(tile_row_num);
+    visit(bank_asr);
+#endif  // THERMAL
+}
+
+std::string Config::Serialize() const {
+    std::string blob(kConfigBlobMagic, sizeof(kConfigBlobMagic));
+    BlobWriter writer(blob);
+    // the fields are only read
+    const_cast<Config*>(this)->VisitFields(writer);
+    return blob;
+}
+
+bool Config::Deserialize(const std::string& blob) {
+    if (blob.compare(0, sizeof(kConfigBlobMagic), kConfigBlobMagic,
+                     sizeof(kConfigBlobMagic)) != 0) {
+        return false;
+    }
+    BlobReader reader(blob, sizeof(kConfigBlobMagic));
+    VisitFields(reader);
+    return reader.Done();
+}
+
+std::unique_ptr<Config> Config::Load(const std::string& config_file,
+                                     const std::string& out_dir,
+                                     const std::string& cache_dir) {
+    return Load(config_file, out_dir, cache_dir,
+                HashConfigFile(config_file, NumBlobFields()));
+}
+
+size_t Config::NumBlobFields() {
+    static const size_t count = [] {
+        Config config;
+        FieldCounter counter;
+        config.VisitFields(counter);
+        return counter.count;
+    }();
+    return count;
+}
+
+std::unique_ptr<Config> Config::Load(const std::string& config_file,
+                                     const std::string& out_dir,
+                                     const std::string& cache_dir,
+                                     uint64_t hash) {
+    if (cache_dir.empty() || hash == 0) {
+        return std::unique_ptr<Config>(new Config(config_file, out_dir));
+    }
+    std::stringstream name;
+    name << cache_dir << "/" << std::hex << hash << ".cfg";
+    std::string blob_name = name.str();
+
+    std::ifstream in(blob_name, std::ifstream::binary);
+    if (in) {
+        std::stringstream blob;
+        blob << in.rdbuf();
+        std::unique_ptr<Config> config(new Config());
+        if (config->Deserialize(blob.str())) {
+            config->output_dir = out_dir;
+            config->InitOutputNames();
+            return config;
+        }
+    }
+
+    // written under a private name and renamed into place, so concurrent
+    // sweep processes never read a partial blob
+    std::unique_ptr<Config> config(new Config(config_file, out_dir));
+    std::string tmp_name = blob_name + "." + std::to_string(getpid());
+    std::ofstream out(tmp_name, std::ofstream::binary);
+    std::string blob = config->Serialize();
+    if (out.write(blob.data(), blob.size())) {
+        out.close();
+        std::rename(tmp_name.c_str(), blob_name.c_str());
+    } else {
+        std::cerr << "WARNING: Cannot write config cache " << tmp_name
+                  << std::endl;
+        std::remove(tmp_name.c_str());
+    }
+    return config;
+}
+
+std::shared_ptr<const Config> Config::Shared(const std::string& config_file,
+                                             const std::string& out_dir,
+                                             const std::string& cache_dir) {
+    static std::mutex mutex;
+    static std::map<std::pair<uint64_t, std::string>,
+                    std::weak_ptr<const Config>>
+        configs;
+    uint64_t hash = HashConfigFile(config_file, NumBlobFields());
+    std::lock_guard<std::mutex> lock(mutex);
+    std::weak_ptr<const Config>& entry = configs[{hash, out_dir}];
+    std::shared_ptr<const Config> config = entry.lock();
+    if (!config || hash == 0) {
+        config = Load(config_file, out_dir, cache_dir, hash);
+        entry = config;
+    }
+    return config;
+}
+
 }  // namespace dramsim3
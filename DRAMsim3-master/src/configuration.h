@@ -2,6 +2,7 @@
 #define __CONFIG_H
 
 #include <fstream>
+#include <memory>
 #include <string>
 #include "common.h"
 
@@ -24,6 +25,14 @@ enum class DRAMProtocol {
     SIZE
 };
 
+// Which model serves the transactions: the cycle accurate JEDEC controllers,
+// a fixed latency with unlimited bandwidth, or the event driven queueing
+// model of AnalyticDRAMSystem for fast design-space sweeps
+enum class MemoryModel { JEDEC, IDEAL, ANALYTIC, SIZE };
+
+// Request scheduling of the command queues, see scheduler.h
+enum class SchedulerPolicy { FRFCFS, FRFCFS_CAP, BLISS, ATLAS, BATCH, SIZE };
+
 enum class RefreshPolicy {
     RANK_LEVEL_SIMULTANEOUS,  // impractical due to high power requirement
     RANK_LEVEL_STAGGERED,
@@ -34,7 +43,27 @@ enum class RefreshPolicy {
 class Config {
    public:
     Config(std::string config_file, std::string out_dir);
+    // Same as the constructor, but a config whose INI text was seen before
+    // is read from the binary blob <hash>.cfg in |cache_dir| instead of
+    // being parsed; a parsed one is saved there. Empty |cache_dir| = parse.
+    static std::unique_ptr<Config> Load(const std::string& config_file,
+                                        const std::string& out_dir,
+                                        const std::string& cache_dir);
+    // One immutable config per INI text and output directory for the whole
+    // process, loaded on first use and shared by the MemorySystems built
+    // from it while any of them is alive
+    static std::shared_ptr<const Config> Shared(
+        const std::string& config_file, const std::string& out_dir,
+        const std::string& cache_dir = "");
+    // All fields but the output paths, which depend on output_dir
+    std::string Serialize() const;
+    // false if |blob| is not from Serialize() of this build
+    bool Deserialize(const std::string& blob);
     Address AddressMapping(uint64_t hex_addr) const;
+    // first byte of the burst |hex_addr| falls in
+    uint64_t LineAddress(uint64_t hex_addr) const {
+        return hex_addr >> shift_bits << shift_bits;
+    }
     // DRAM physical structure
     DRAMProtocol protocol;
     int channel_size;
@@ -125,10 +154,35 @@ class Config {
     std::string queue_structure;
     std::string row_buf_policy;
     RefreshPolicy refresh_policy;
+    // refreshes that may be postponed while reads wait, or pulled in while
+    // idle; 0 refreshes strictly every interval, JEDEC allows up to 8
+    int refresh_postpone;
+    // number of requesters (e.g. upstream ports) to keep per-requester
+    // latency, bandwidth and row-hit stats for, 0 disables them
+    int num_requesters;
+    SchedulerPolicy scheduler;
+    // row hits served before a pending miss may close the row, 0 = no cap;
+    // FRFCFS always caps at 4
+    int row_hit_cap;
+    int bliss_threshold;       // consecutive requests before blacklisting
+    int bliss_clear_interval;  // cycles between blacklist clears
+    int atlas_quantum;         // cycles between attained service rankings
+    int atlas_starvation;      // request age served ahead of any ranking
+    int batch_cap;             // requests marked per requester and bank
+    MemoryModel memory_model;
+    // analytic model read latency = scale * modelled latency + offset,
+    // fitted against the JEDEC model by analyticcalib
+    double analytic_latency_scale;
+    double analytic_latency_offset;
     int cmd_queue_size;
     bool unified_queue;
     int trans_queue_size;
     int write_buf_size;
+    // buffered writes that force a drain, that a drain stops at, and above
+    // which writes drain while the command queues are idle
+    int write_high_watermark;
+    int write_low_watermark;
+    int write_idle_drain;
     bool enable_self_refresh;
     int sref_threshold;
     bool aggressive_precharging_enabled;
@@ -137,11 +191,19 @@ class Config {
 
     int epoch_period;
     int output_level;
+    int tick_threads;  // threads ticking channel controllers, 1 = serial
     std::string output_dir;
     std::string output_prefix;
     std::string json_stats_name;
     std::string json_epoch_name;
+    std::string epoch_format;  // json, ndjson or binary
     std::string txt_stats_name;
+    bool cmd_trace;
+    bool addr_trace;
+    uint64_t trace_start;
+    uint64_t trace_end;  // exclusive
+    int trace_ring_records;  // per channel
+    std::string trace_file_name;
 
     // Computed parameters
     int request_size_bytes;
@@ -183,13 +245,24 @@ class Config {
 #endif  // THERMAL
 
    private:
+    Config() : reader_(nullptr) {}
+    static std::unique_ptr<Config> Load(const std::string& config_file,
+                                        const std::string& out_dir,
+                                        const std::string& cache_dir,
+                                        uint64_t hash);
+    template <typename Visitor>
+    void VisitFields(Visitor& visit);
+    static size_t NumBlobFields();
+
     INIReader* reader_;
+    std::string output_name_;  // output_prefix of the INI
     void CalculateSize();
     DRAMProtocol GetDRAMProtocol(std::string protocol_str);
     int GetInteger(const std::string& sec, const std::string& opt,
                    int default_val) const;
     void InitDRAMParams();
     void InitOtherParams();
+    void InitOutputNames();
     void InitPowerParams();
     void InitSystemParams();
 #ifdef THERMAL
@@ -1,5 +1,5 @@
 #include "controller.h"
-#include <iomanip>
+#include <algorithm>
 #include <iostream>
 #include <limits>
 
@@ -22,50 +22,101 @@ Controller::Controller(int channel, const Config &config, const Timing &timing)
       thermal_calc_(thermal_calc),
 #endif  // THERMAL
       is_unified_queue_(config.unified_queue),
+      pending_rd_q_(config.trans_queue_size),
+      pending_wr_q_(config.trans_queue_size),
+      return_seq_(0),
       row_buf_policy_(config.row_buf_policy == "CLOSE_PAGE"
                           ? RowBufPolicy::CLOSE_PAGE
                           : RowBufPolicy::OPEN_PAGE),
+      cmd_tracer_(nullptr),
       last_trans_clk_(0),
       write_draining_(0) {
+    stat_.num_cycles = simple_stats_.GetStatId("num_cycles");
+    stat_.epoch_num = simple_stats_.GetStatId("epoch_num");
+    stat_.num_reads_done = simple_stats_.GetStatId("num_reads_done");
+    stat_.num_writes_done = simple_stats_.GetStatId("num_writes_done");
+    stat_.num_write_buf_hits = simple_stats_.GetStatId("num_write_buf_hits");
+    stat_.num_write_coalesced =
+        simple_stats_.GetStatId("num_write_coalesced");
+    stat_.hbm_dual_cmds = simple_stats_.GetStatId("hbm_dual_cmds");
+    stat_.num_read_cmds = simple_stats_.GetStatId("num_read_cmds");
+    stat_.num_read_row_hits = simple_stats_.GetStatId("num_read_row_hits");
+    stat_.num_write_cmds = simple_stats_.GetStatId("num_write_cmds");
+    stat_.num_write_row_hits = simple_stats_.GetStatId("num_write_row_hits");
+    stat_.num_act_cmds = simple_stats_.GetStatId("num_act_cmds");
+    stat_.num_pre_cmds = simple_stats_.GetStatId("num_pre_cmds");
+    stat_.num_ref_cmds = simple_stats_.GetStatId("num_ref_cmds");
+    stat_.num_refb_cmds = simple_stats_.GetStatId("num_refb_cmds");
+    stat_.num_srefe_cmds = simple_stats_.GetStatId("num_srefe_cmds");
+    stat_.num_srefx_cmds = simple_stats_.GetStatId("num_srefx_cmds");
+    stat_.sref_cycles = simple_stats_.GetStatId("sref_cycles");
+    stat_.all_bank_idle_cycles =
+        simple_stats_.GetStatId("all_bank_idle_cycles");
+    stat_.rank_active_cycles = simple_stats_.GetStatId("rank_active_cycles");
+    stat_.read_latency = simple_stats_.GetStatId("read_latency");
+    stat_.write_latency = simple_stats_.GetStatId("write_latency");
+    stat_.interarrival_latency =
+        simple_stats_.GetStatId("interarrival_latency");
+    if (config_.num_requesters > 0) {
+        stat_.req_reads_done = simple_stats_.GetStatId("requester_reads_done");
+        stat_.req_writes_done =
+            simple_stats_.GetStatId("requester_writes_done");
+        stat_.req_read_row_hits =
+            simple_stats_.GetStatId("requester_read_row_hits");
+        for (int i = 0; i < config_.num_requesters; i++) {
+            stat_.req_read_latency.push_back(simple_stats_.GetStatId(
+                "requester_read_latency." + std::to_string(i)));
+        }
+    }
+    return_queue_.reserve(config_.trans_queue_size);
     if (is_unified_queue_) {
         unified_queue_.reserve(config_.trans_queue_size);
     } else {
         read_queue_.reserve(config_.trans_queue_size);
         write_buffer_.reserve(config_.trans_queue_size);
     }
-
-#ifdef CMD_TRACE
-    std::string trace_file_name = config_.output_prefix + "ch_" +
-                                  std::to_string(channel_id_) + "cmd.trace";
-    std::cout << "Command Trace write to " << trace_file_name << std::endl;
-    cmd_trace_.open(trace_file_name, std::ofstream::out);
-#endif  // CMD_TRACE
 }
 
-std::pair<uint64_t, int> Controller::ReturnDoneTrans(uint64_t clk) {
-    
-    auto it = return_queue_.begin();
-    while (it != return_queue_.end()) {
-        if (clk >= it->complete_cycle) {
-            if (it->is_write) {
-                simple_stats_.Increment("num_writes_done");
-            } else {
-                simple_stats_.Increment("num_reads_done");
-                simple_stats_.AddValue("read_latency", clk_ - it->added_cycle);
-            }
-            auto pair = std::make_pair(it->addr, it->is_write);
-            it = return_queue_.erase(it);
-            return pair;
+bool Controller::ReturnDoneTrans(uint64_t clk, Transaction &trans) {
+    if (return_queue_.empty() ||
+        clk < return_queue_.front().trans.complete_cycle) {
+        return false;
+    }
+    std::pop_heap(return_queue_.begin(), return_queue_.end(), ReturnLater());
+    trans = return_queue_.back().trans;
+    if (trans.is_write) {
+        simple_stats_.Increment(stat_.num_writes_done);
+    } else {
+        simple_stats_.Increment(stat_.num_reads_done);
+        simple_stats_.AddValue(stat_.read_latency, clk_ - trans.added_cycle);
+    }
+    if (HasRequester(trans)) {
+        if (trans.is_write) {
+            simple_stats_.IncrementVec(stat_.req_writes_done, trans.requester);
         } else {
-            ++it;
+            simple_stats_.IncrementVec(stat_.req_reads_done, trans.requester);
+            simple_stats_.AddValue(stat_.req_read_latency[trans.requester],
+                                   clk_ - trans.added_cycle);
         }
     }
-    return std::make_pair(-1, -1);
+    return_queue_.pop_back();
+    return true;
+}
+
+void Controller::PushReturn(const Transaction &trans) {
+    return_queue_.push_back({return_seq_++, trans});
+    std::push_heap(return_queue_.begin(), return_queue_.end(), ReturnLater());
 }
 
 void Controller::ClockTick() {
-    // update refresh counter
-    refresh_.ClockTick();
+    // update refresh counter, postponing it needs to know about demand
+    if (config_.refresh_postpone > 0) {
+        bool reads_pending = is_unified_queue_ ? !unified_queue_.empty()
+                                               : !read_queue_.empty();
+        refresh_.ClockTick(reads_pending, IsIdle());
+    } else {
+        refresh_.ClockTick();
+    }
 
     bool cmd_issued = false;
     Command cmd;
@@ -87,7 +138,7 @@ void Controller::ClockTick() {
             if (second_cmd.IsValid()) {
                 if (second_cmd.IsReadWrite() != cmd.IsReadWrite()) {
                     IssueCommand(second_cmd);
-                    simple_stats_.Increment("hbm_dual_cmds");
+                    simple_stats_.Increment(stat_.hbm_dual_cmds);
                 }
             }
         }
@@ -96,14 +147,14 @@ void Controller::ClockTick() {
     // power updates pt 1
     for (int i = 0; i < config_.ranks; i++) {
         if (channel_state_.IsRankSelfRefreshing(i)) {
-            simple_stats_.IncrementVec("sref_cycles", i);
+            simple_stats_.IncrementVec(stat_.sref_cycles, i);
         } else {
             bool all_idle = channel_state_.IsAllBankIdleInRank(i);
             if (all_idle) {
-                simple_stats_.IncrementVec("all_bank_idle_cycles", i);
+                simple_stats_.IncrementVec(stat_.all_bank_idle_cycles, i);
                 channel_state_.rank_idle_cycles[i] += 1;
             } else {
-                simple_stats_.IncrementVec("rank_active_cycles", i);
+                simple_stats_.IncrementVec(stat_.rank_active_cycles, i);
                 // reset
                 channel_state_.rank_idle_cycles[i] = 0;
             }
@@ -145,10 +196,73 @@ void Controller::ClockTick() {
     ScheduleTransaction();
     clk_++;
     cmd_queue_.ClockTick();
-    simple_stats_.Increment("num_cycles");
+    simple_stats_.Increment(stat_.num_cycles);
     return;
 }
 
+bool Controller::IsIdle() const {
+    if (is_unified_queue_) {
+        if (!unified_queue_.empty()) {
+            return false;
+        }
+    } else if (!read_queue_.empty() || !write_buffer_.empty()) {
+        return false;
+    }
+    return !channel_state_.IsRefreshWaiting() && cmd_queue_.QueueEmpty();
+}
+
+uint64_t Controller::NextEventCycle() const {
+    if (!IsIdle()) {
+        return clk_;
+    }
+    uint64_t next = refresh_.NextRefreshCycle();
+    if (!return_queue_.empty()) {
+        next = std::min(
+            next, std::max(return_queue_.front().trans.complete_cycle, clk_));
+    }
+    if (config_.enable_self_refresh) {
+        // ClockTick() bumps rank_idle_cycles before checking the threshold
+        for (int i = 0; i < config_.ranks; i++) {
+            if (channel_state_.IsRankSelfRefreshing(i) ||
+                !channel_state_.IsAllBankIdleInRank(i)) {
+                continue;
+            }
+            int remaining =
+                config_.sref_threshold - channel_state_.rank_idle_cycles[i] - 1;
+            next = std::min(next, clk_ + std::max(remaining, 0));
+        }
+    }
+    return next;
+}
+
+uint64_t Controller::ClockTickUntil(uint64_t clk) {
+    uint64_t next = std::min(clk, NextEventCycle());
+    if (next <= clk_) {
+        return clk_;
+    }
+    uint64_t cycles = next - clk_;
+
+    // nothing is issued while idle, so every skipped cycle lands in the
+    // same power state bucket as the first one
+    for (int i = 0; i < config_.ranks; i++) {
+        if (channel_state_.IsRankSelfRefreshing(i)) {
+            simple_stats_.IncrementVecBy(stat_.sref_cycles, i, cycles);
+        } else if (channel_state_.IsAllBankIdleInRank(i)) {
+            simple_stats_.IncrementVecBy(stat_.all_bank_idle_cycles, i, cycles);
+            channel_state_.rank_idle_cycles[i] += static_cast<int>(cycles);
+        } else {
+            simple_stats_.IncrementVecBy(stat_.rank_active_cycles, i, cycles);
+            channel_state_.rank_idle_cycles[i] = 0;
+        }
+    }
+    simple_stats_.IncrementBy(stat_.num_cycles, cycles);
+
+    refresh_.ClockTickUntil(next);
+    cmd_queue_.ClockTickUntil(next);
+    clk_ = next;
+    return clk_;
+}
+
 bool Controller::WillAcceptTransaction(uint64_t hex_addr, bool is_write) const {
     //std::cout<<"hex_addr:"<<hex_addr<<std::endl;
     if (is_unified_queue_) {
@@ -167,40 +281,51 @@ bool Controller::WillAcceptTransaction(uint64_t hex_addr, bool is_write) const {
         // if(channel_id_==7){
         // std::cout<<"write.size"<<write_buffer_.size()<<std::endl;
         // }
-        return write_buffer_.size() < write_buffer_.capacity();
+        // a write to a buffered line merges into it and takes no space
+        return write_buffer_.size() < write_buffer_.capacity() ||
+               pending_wr_q_.Count(config_.LineAddress(hex_addr)) > 0;
     }
 }
 
 bool Controller::AddTransaction(Transaction trans) {
     trans.added_cycle = clk_;
-    simple_stats_.AddValue("interarrival_latency", clk_ - last_trans_clk_);
+    simple_stats_.AddValue(stat_.interarrival_latency, clk_ - last_trans_clk_);
     last_trans_clk_ = clk_;
    
+    // DRAM is accessed a burst at a time, so the queues hold one transaction
+    // per line and the pending ones are indexed by line; what is returned
+    // keeps the address it came with
+    Transaction line_trans = trans;
+    line_trans.addr = config_.LineAddress(trans.addr);
     if (trans.is_write) {
-        if (pending_wr_q_.count(trans.addr) == 0) {  // can not merge writes
-            pending_wr_q_.insert(std::make_pair(trans.addr, trans));
+        if (pending_wr_q_.Count(line_trans.addr) == 0) {
+            pending_wr_q_.Insert(line_trans);
             if (is_unified_queue_) {
-                unified_queue_.push_back(trans);
+                unified_queue_.push_back(line_trans);
             } else {
-                write_buffer_.push_back(trans);
+                write_buffer_.push_back(line_trans);
             }
+        } else {
+            // coalesced into the write of its line that is not issued yet
+            simple_stats_.Increment(stat_.num_write_coalesced);
         }
         trans.complete_cycle = clk_ + 1;
-        return_queue_.push_back(trans);
+        PushReturn(trans);
         return true;
     } else {  // read
         // if in write buffer, use the write buffer value
-        if (pending_wr_q_.count(trans.addr) > 0) {
+        if (pending_wr_q_.Count(line_trans.addr) > 0) {
+            simple_stats_.Increment(stat_.num_write_buf_hits);
             trans.complete_cycle = clk_ + 1;
-            return_queue_.push_back(trans);
+            PushReturn(trans);
             return true;
         }
-        pending_rd_q_.insert(std::make_pair(trans.addr, trans));
-        if (pending_rd_q_.count(trans.addr) == 1) {
+        pending_rd_q_.Insert(line_trans.addr, trans);
+        if (pending_rd_q_.Count(line_trans.addr) == 1) {
             if (is_unified_queue_) {
-                unified_queue_.push_back(trans);
+                unified_queue_.push_back(line_trans);
             } else {
-                read_queue_.push_back(trans);
+                read_queue_.push_back(line_trans);
                 //std::cout<<"read_queue_"<<&read_queue_[0]<<std::endl;//RHY add
                 //std::cout<<"read_queue_size"<<read_queue_.size()<<std::endl;//RHY add
                 //std::cout<<"push_back"<<std::endl;//RHY add
@@ -213,10 +338,14 @@ bool Controller::AddTransaction(Transaction trans) {
 void Controller::ScheduleTransaction() {
     // determine whether to schedule read or write
     if (write_draining_ == 0 && !is_unified_queue_) {
-        // we basically have a upper and lower threshold for write buffer
-        if ((write_buffer_.size() >= write_buffer_.capacity()) ||
-            (write_buffer_.size() > 8 && cmd_queue_.QueueEmpty())) {
-            write_draining_ = write_buffer_.size();
+        // drain down to the low watermark once the high one is reached, or
+        // early while the command queues have nothing else to do
+        int buffered = static_cast<int>(write_buffer_.size());
+        if (buffered > config_.write_low_watermark &&
+            (buffered >= config_.write_high_watermark ||
+             (buffered > config_.write_idle_drain &&
+              cmd_queue_.QueueEmpty()))) {
+            write_draining_ = buffered - config_.write_low_watermark;
         }
     }
 
@@ -229,7 +358,7 @@ void Controller::ScheduleTransaction() {
                                          cmd.Bank())) {
             if (!is_unified_queue_ && cmd.IsWrite()) {
                 // Enforce R->W dependency
-                if (pending_rd_q_.count(it->addr) > 0) {
+                if (pending_rd_q_.Count(it->addr) > 0) {
                     write_draining_ = 0;
         // if(channel_id_==7 && it->is_write){
         //    std::cout<<"R_W dep"<<",addr:"<<it->addr<<std::endl;
@@ -254,39 +383,43 @@ void Controller::ScheduleTransaction() {
 }
 
 void Controller::IssueCommand(const Command &cmd) {
-#ifdef CMD_TRACE
-    cmd_trace_ << std::left << std::setw(18) << clk_ << " " << cmd << std::endl;
-#endif  // CMD_TRACE
+    if (cmd_tracer_ && cmd_tracer_->InWindow(clk_)) {
+        cmd_tracer_->AddCommand(channel_id_, clk_, cmd);
+    }
 #ifdef THERMAL
     // add channel in, only needed by thermal module
     thermal_calc_.UpdateCMDPower(channel_id_, cmd, clk_);
 #endif  // THERMAL
     // if read/write, update pending queue and return queue
     if (cmd.IsRead()) {
-        auto num_reads = pending_rd_q_.count(cmd.hex_addr);
-        if (num_reads == 0) {
+        auto trans = pending_rd_q_.Front(cmd.hex_addr);
+        if (trans == nullptr) {
             std::cerr << cmd.hex_addr << " not in read queue! " << std::endl;
             exit(1);
         }
         // if there are multiple reads pending return them all
-        while (num_reads > 0) {
-            auto it = pending_rd_q_.find(cmd.hex_addr);
-            it->second.complete_cycle = clk_ + config_.read_delay;
-           
-            return_queue_.push_back(it->second);
-            pending_rd_q_.erase(it);
-            num_reads -= 1;
+        bool row_hit = channel_state_.RowHitCount(cmd.Rank(), cmd.Bankgroup(),
+                                                  cmd.Bank()) != 0;
+        while (trans != nullptr) {
+            if (row_hit && HasRequester(*trans)) {
+                simple_stats_.IncrementVec(stat_.req_read_row_hits,
+                                           trans->requester);
+            }
+            trans->complete_cycle = clk_ + config_.read_delay;
+            PushReturn(*trans);
+            pending_rd_q_.PopFront(cmd.hex_addr);
+            trans = pending_rd_q_.Front(cmd.hex_addr);
         }
     } else if (cmd.IsWrite()) {
         // there should be only 1 write to the same location at a time
-        auto it = pending_wr_q_.find(cmd.hex_addr);
-        if (it == pending_wr_q_.end()) {
+        auto trans = pending_wr_q_.Front(cmd.hex_addr);
+        if (trans == nullptr) {
             std::cerr << cmd.hex_addr << " not in write queue!" << std::endl;
             exit(1);
         }
-        auto wr_lat = clk_ - it->second.added_cycle + config_.write_delay;
-        simple_stats_.AddValue("write_latency", wr_lat);
-        pending_wr_q_.erase(it);
+        auto wr_lat = clk_ - trans->added_cycle + config_.write_delay;
+        simple_stats_.AddValue(stat_.write_latency, wr_lat);
+        pending_wr_q_.PopFront(cmd.hex_addr);
     }
     // must update stats before states (for row hits)
     UpdateCommandStats(cmd);
@@ -302,14 +435,17 @@ Command Controller::TransToCommand(const Transaction &trans) {
         cmd_type = trans.is_write ? CommandType::WRITE_PRECHARGE
                                   : CommandType::READ_PRECHARGE;
     }
-    return Command(cmd_type, addr, trans.addr);
+    Command cmd(cmd_type, addr, trans.addr);
+    cmd.requester = trans.requester;
+    cmd.added_cycle = trans.added_cycle;
+    return cmd;
 }
 
 int Controller::QueueUsage() const { return cmd_queue_.QueueUsage(); }
 
-void Controller::PrintEpochStats() {
-    simple_stats_.Increment("epoch_num");
-    simple_stats_.PrintEpochStats();
+void Controller::PrintEpochStats(EpochWriter* writer) {
+    simple_stats_.Increment(stat_.epoch_num);
+    simple_stats_.PrintEpochStats(writer);
 #ifdef THERMAL
     for (int r = 0; r < config_.ranks; r++) {
         double bg_energy = simple_stats_.RankBackgroundEnergy(r);
@@ -335,37 +471,37 @@ void Controller::UpdateCommandStats(const Command &cmd) {
     switch (cmd.cmd_type) {
         case CommandType::READ:
         case CommandType::READ_PRECHARGE:
-            simple_stats_.Increment("num_read_cmds");
+            simple_stats_.Increment(stat_.num_read_cmds);
             if (channel_state_.RowHitCount(cmd.Rank(), cmd.Bankgroup(),
                                            cmd.Bank()) != 0) {
-                simple_stats_.Increment("num_read_row_hits");
+                simple_stats_.Increment(stat_.num_read_row_hits);
             }
             break;
         case CommandType::WRITE:
         case CommandType::WRITE_PRECHARGE:
-            simple_stats_.Increment("num_write_cmds");
+            simple_stats_.Increment(stat_.num_write_cmds);
             if (channel_state_.RowHitCount(cmd.Rank(), cmd.Bankgroup(),
                                            cmd.Bank()) != 0) {
-                simple_stats_.Increment("num_write_row_hits");
+                simple_stats_.Increment(stat_.num_write_row_hits);
             }
             break;
         case CommandType::ACTIVATE:
-            simple_stats_.Increment("num_act_cmds");
+            simple_stats_.Increment(stat_.num_act_cmds);
             break;
         case CommandType::PRECHARGE:
-            simple_stats_.Increment("num_pre_cmds");
+            simple_stats_.Increment(stat_.num_pre_cmds);
             break;
         case CommandType::REFRESH:
-            simple_stats_.Increment("num_ref_cmds");
+            simple_stats_.Increment(stat_.num_ref_cmds);
             break;
         case CommandType::REFRESH_BANK:
-            simple_stats_.Increment("num_refb_cmds");
+            simple_stats_.Increment(stat_.num_refb_cmds);
             break;
         case CommandType::SREF_ENTER:
-            simple_stats_.Increment("num_srefe_cmds");
+            simple_stats_.Increment(stat_.num_srefe_cmds);
             break;
         case CommandType::SREF_EXIT:
-            simple_stats_.Increment("num_srefx_cmds");
+            simple_stats_.Increment(stat_.num_srefx_cmds);
             break;
         default:
             AbruptExit(__FILE__, __LINE__);
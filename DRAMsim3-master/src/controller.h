@@ -2,12 +2,13 @@
 #define __CONTROLLER_H
 
 #include <fstream>
-#include <map>
 #include <unordered_set>
 #include <vector>
 #include "channel_state.h"
+#include "cmd_trace.h"
 #include "command_queue.h"
 #include "common.h"
+#include "pending_index.h"
 #include "refresh.h"
 #include "simple_stats.h"
 
@@ -28,14 +29,27 @@ class Controller {
     Controller(int channel, const Config &config, const Timing &timing);
 #endif  // THERMAL
     void ClockTick();
+    // record every command issued from now on into |tracer|
+    void SetCommandTracer(CommandTracer *tracer) { cmd_tracer_ = tracer; }
+    // Earliest cycle >= the current one at which ClockTick() can do more
+    // than count cycles: the current cycle while any work is queued,
+    // otherwise the next refresh, return-queue completion or self-refresh
+    // entry, whichever comes first.
+    uint64_t NextEventCycle() const;
+    // Advance over idle cycles up to |clk| (exclusive) in one step, stopping
+    // early at NextEventCycle(). Cycle-count stats are updated in bulk
+    // exactly as the skipped ClockTick() calls would have. Returns the
+    // cycle reached; callers drain ReturnDoneTrans() and ClockTick() there.
+    uint64_t ClockTickUntil(uint64_t clk);
     bool WillAcceptTransaction(uint64_t hex_addr, bool is_write) const;
     bool AddTransaction(Transaction trans);
     int QueueUsage() const;
     // Stats output
-    void PrintEpochStats();
+    void PrintEpochStats(EpochWriter* writer);
     void PrintFinalStats();
     void ResetStats() { simple_stats_.Reset(); }
-    std::pair<uint64_t, int> ReturnDoneTrans(uint64_t clock);
+    // pop a transaction finished by |clock| into |trans|, false if none
+    bool ReturnDoneTrans(uint64_t clock, Transaction &trans);
 
     int channel_id_;
 
@@ -43,6 +57,19 @@ class Controller {
     uint64_t clk_;
     const Config &config_;
     SimpleStats simple_stats_;
+    // handles of the stats updated on the hot path
+    struct StatHandles {
+        StatId num_cycles, epoch_num, num_reads_done, num_writes_done,
+            num_write_buf_hits, num_write_coalesced, hbm_dual_cmds,
+            num_read_cmds, num_read_row_hits, num_write_cmds,
+            num_write_row_hits, num_act_cmds, num_pre_cmds, num_ref_cmds,
+            num_refb_cmds, num_srefe_cmds, num_srefx_cmds;
+        StatId sref_cycles, all_bank_idle_cycles, rank_active_cycles;
+        StatId read_latency, write_latency, interarrival_latency;
+        // per-requester, only with num_requesters > 0
+        StatId req_reads_done, req_writes_done, req_read_row_hits;
+        std::vector<StatId> req_read_latency;
+    } stat_;
     ChannelState channel_state_;
     CommandQueue cmd_queue_;
     Refresh refresh_;
@@ -57,25 +84,42 @@ class Controller {
     std::vector<Transaction> read_queue_;
     std::vector<Transaction> write_buffer_;
 
-    // transactions that are not completed, use map for convenience
-    std::multimap<uint64_t, Transaction> pending_rd_q_;
-    std::multimap<uint64_t, Transaction> pending_wr_q_;
+    // transactions that are not completed, indexed by address
+    PendingIndex pending_rd_q_;
+    PendingIndex pending_wr_q_;
 
-    // completed transactions
-    std::vector<Transaction> return_queue_;
+    // completed transactions, a min-heap on (complete_cycle, arrival) so
+    // same-cycle completions still come back in the order they were queued
+    struct ReturnEntry {
+        uint64_t seq;
+        Transaction trans;
+    };
+    struct ReturnLater {
+        bool operator()(const ReturnEntry &a, const ReturnEntry &b) const {
+            return a.trans.complete_cycle != b.trans.complete_cycle
+                       ? a.trans.complete_cycle > b.trans.complete_cycle
+                       : a.seq > b.seq;
+        }
+    };
+    std::vector<ReturnEntry> return_queue_;
+    uint64_t return_seq_;
+    void PushReturn(const Transaction &trans);
 
     // row buffer policy
     RowBufPolicy row_buf_policy_;
 
-#ifdef CMD_TRACE
-    std::ofstream cmd_trace_;
-#endif  // CMD_TRACE
+    // records the issued commands if cmd_trace is on
+    CommandTracer *cmd_tracer_;
 
     // used to calculate inter-arrival latency
     uint64_t last_trans_clk_;
 
     // transaction queueing
     int write_draining_;
+    bool IsIdle() const;
+    bool HasRequester(const Transaction &trans) const {
+        return trans.requester >= 0 && trans.requester < config_.num_requesters;
+    }
     void ScheduleTransaction();
     void IssueCommand(const Command &tmp_cmd);
     Command TransToCommand(const Transaction &trans);
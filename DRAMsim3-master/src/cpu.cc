@@ -125,6 +125,10 @@ TraceBasedCPU::TraceBasedCPU(const std::string& config_file,
                              const std::string& output_dir,
                              const std::string& trace_file)
     : CPU(config_file, output_dir,"./trace_out_file.txt") {
+    if (BinaryTraceReader::IsBinaryTrace(trace_file)) {
+        binary_trace_.reset(new BinaryTraceReader(trace_file));
+        return;
+    }
     trace_file_.open(trace_file);
     if (trace_file_.fail()) {
         std::cerr << "Trace file does not exist" << std::endl;
@@ -134,18 +138,25 @@ TraceBasedCPU::TraceBasedCPU(const std::string& config_file,
 
 void TraceBasedCPU::ClockTick() {
     memory_system_.ClockTick();
-    if (!trace_file_.eof()) {
+    if (!trace_done_) {
         if (get_next_) {
             get_next_ = false;
-            trace_file_ >> trans_;
+            if (binary_trace_) {
+                trace_done_ = !binary_trace_->Next(trans_);
+            } else {
+                trace_file_ >> trans_;
+            }
         }
-        if (trans_.added_cycle <= clk_) {
+        if (!trace_done_ && trans_.added_cycle <= clk_) {
             get_next_ = memory_system_.WillAcceptTransaction(trans_.addr,
                                                              trans_.is_write);
             if (get_next_) {
                 memory_system_.AddTransaction(trans_.addr, trans_.is_write);
             }
         }
+        if (!binary_trace_) {
+            trace_done_ = trace_file_.eof();
+        }
     }
     clk_++;
     return;
@@ -3,8 +3,10 @@
 
 #include <fstream>
 #include <functional>
+#include <memory>
 #include <random>
 #include <string>
+#include "binary_trace.h"
 #include "memory_system.h"
 
 namespace dramsim3 {
@@ -81,8 +83,11 @@ class TraceBasedCPU : public CPU {
 
    private:
     std::ifstream trace_file_;
+    // set instead of trace_file_ for traces made by traceconvert
+    std::unique_ptr<BinaryTraceReader> binary_trace_;
     Transaction trans_;
     bool get_next_ = true;
+    bool trace_done_ = false;
 };
 
 }  // namespace dramsim3
@@ -1,6 +1,8 @@
 #include "dram_system.h"
 
 #include <assert.h>
+#include <algorithm>
+#include <limits>
 
 namespace dramsim3 {
 
@@ -8,9 +10,10 @@ namespace dramsim3 {
 // destructive
 int BaseDRAMSystem::total_channels_ = 0;
 
-BaseDRAMSystem::BaseDRAMSystem(Config &config, const std::string &output_dir,
-                               std::function<void(uint64_t)> read_callback,
-                               std::function<void(uint64_t)> write_callback)
+BaseDRAMSystem::BaseDRAMSystem(
+    const Config &config, const std::string &output_dir,
+    std::function<void(uint64_t)> read_callback,
+    std::function<void(uint64_t)> write_callback)
     : read_callback_(read_callback),
       write_callback_(write_callback),
       last_req_clk_(0),
@@ -22,10 +25,12 @@ BaseDRAMSystem::BaseDRAMSystem(Config &config, const std::string &output_dir,
       clk_(0) {
     total_channels_ += config_.channels;
 
-#ifdef ADDR_TRACE
-    std::string addr_trace_name = config_.output_prefix + "addr.trace";
-    address_trace_.open(addr_trace_name);
-#endif
+    if (config_.cmd_trace || config_.addr_trace) {
+        tracer_.reset(new CommandTracer(
+            config_.trace_file_name, config_.channels,
+            config_.trace_ring_records, config_.trace_start,
+            config_.trace_end));
+    }
 }
 
 int BaseDRAMSystem::GetChannel(uint64_t hex_addr) const {
@@ -33,16 +38,20 @@ int BaseDRAMSystem::GetChannel(uint64_t hex_addr) const {
     return (hex_addr >> config_.ch_pos) & config_.ch_mask;
 }
 
-void BaseDRAMSystem::PrintEpochStats() {
-    // first epoch, print bracket
-    if (clk_ - config_.epoch_period == 0) {
-        std::ofstream epoch_out(config_.json_epoch_name, std::ofstream::out);
-        epoch_out << "[";
+EpochWriter *BaseDRAMSystem::EpochStatsWriter() {
+    // the epoch file stays open until PrintStats(), channels append to it
+    if (!epoch_writer_ && config_.output_level >= 1) {
+        epoch_writer_.reset(new EpochWriter(
+            config_.json_epoch_name,
+            EpochWriter::ParseFormat(config_.epoch_format)));
     }
+    return epoch_writer_.get();
+}
+
+void BaseDRAMSystem::PrintEpochStats() {
+    EpochWriter *writer = EpochStatsWriter();
     for (size_t i = 0; i < ctrls_.size(); i++) {
-        ctrls_[i]->PrintEpochStats();
-        std::ofstream epoch_out(config_.json_epoch_name, std::ofstream::app);
-        epoch_out << "," << std::endl;
+        ctrls_[i]->PrintEpochStats(writer);
     }
 #ifdef THERMAL
     thermal_calc_.PrintTransPT(clk_);
@@ -50,14 +59,32 @@ void BaseDRAMSystem::PrintEpochStats() {
     return;
 }
 
+void BaseDRAMSystem::AttachCommandTracer() {
+    if (!config_.cmd_trace) {
+        return;
+    }
+    for (auto ctrl : ctrls_) {
+        ctrl->SetCommandTracer(tracer_.get());
+    }
+}
+
+void BaseDRAMSystem::FinishTrace() {
+    if (tracer_) {
+        tracer_->Close();
+    }
+}
+
+void BaseDRAMSystem::FinishEpochStats() {
+    // this waits for the pending writes
+    if (epoch_writer_) {
+        epoch_writer_->Close();
+        epoch_writer_.reset();
+    }
+}
+
 void BaseDRAMSystem::PrintStats() {
-    // Finish epoch output, remove last comma and append ]
-    std::ofstream epoch_out(config_.json_epoch_name, std::ios_base::in |
-                                                         std::ios_base::out |
-                                                         std::ios_base::ate);
-    epoch_out.seekp(-2, std::ios_base::cur);
-    epoch_out.write("]", 1);
-    epoch_out.close();
+    FinishEpochStats();
+    FinishTrace();
 
     std::ofstream json_out(config_.json_stats_name, std::ofstream::out);
     json_out << "{";
@@ -85,6 +112,27 @@ void BaseDRAMSystem::ResetStats() {
     }
 }
 
+void BaseDRAMSystem::ClockTicks(uint64_t cycles,
+                                std::vector<DoneTransaction> &done) {
+    // generic version: capture the callbacks while ticking one by one
+    auto read_callback = read_id_callback_;
+    auto write_callback = write_id_callback_;
+    uint64_t cycle = 0;
+    read_id_callback_ = [&done, &cycle](uint64_t id, uint64_t addr,
+                                        int channel) {
+        done.push_back({cycle, addr, false, id, channel});
+    };
+    write_id_callback_ = [&done, &cycle](uint64_t id, uint64_t addr,
+                                         int channel) {
+        done.push_back({cycle, addr, true, id, channel});
+    };
+    for (cycle = clk_; cycles > 0; cycles--, cycle++) {
+        ClockTick();
+    }
+    read_id_callback_ = read_callback;
+    write_id_callback_ = write_callback;
+}
+
 void BaseDRAMSystem::RegisterCallbacks(
     std::function<void(uint64_t)> read_callback,
     std::function<void(uint64_t)> write_callback) {
@@ -93,10 +141,54 @@ void BaseDRAMSystem::RegisterCallbacks(
     write_callback_ = write_callback;
 }
 
-JedecDRAMSystem::JedecDRAMSystem(Config &config, const std::string &output_dir,
-                                 std::function<void(uint64_t)> read_callback,
-                                 std::function<void(uint64_t)> write_callback)
-    : BaseDRAMSystem(config, output_dir, read_callback, write_callback) {
+void BaseDRAMSystem::RegisterIdCallbacks(TransactionCallback read_callback,
+                                         TransactionCallback write_callback) {
+    read_id_callback_ = read_callback;
+    write_id_callback_ = write_callback;
+}
+
+size_t BaseDRAMSystem::AddTransactions(TransactionRequest *reqs,
+                                       size_t count) {
+    // generic version: one by one, remembering the channels that refused
+    std::vector<bool> refused(config_.channels, false);
+    size_t accepted = 0;
+    for (size_t i = 0; i < count; i++) {
+        TransactionRequest &req = reqs[i];
+        int channel = GetChannel(req.addr);
+        req.accepted = !refused[channel] &&
+                       WillAcceptTransaction(req.addr, req.is_write) &&
+                       AddTransaction(req.addr, req.is_write, req.id,
+                                      req.requester);
+        refused[channel] = !req.accepted;
+        accepted += req.accepted ? 1 : 0;
+    }
+    return accepted;
+}
+
+void BaseDRAMSystem::ReturnTransaction(const Transaction &trans,
+                                       int channel) {
+    if (trans.is_write) {
+        if (write_id_callback_) {
+            write_id_callback_(trans.id, trans.addr, channel);
+        } else {
+            write_callback_(trans.addr);
+        }
+    } else {
+        if (read_id_callback_) {
+            read_id_callback_(trans.id, trans.addr, channel);
+        } else {
+            read_callback_(trans.addr);
+        }
+    }
+}
+
+JedecDRAMSystem::JedecDRAMSystem(
+    const Config &config, const std::string &output_dir,
+    std::function<void(uint64_t)> read_callback,
+    std::function<void(uint64_t)> write_callback)
+    : BaseDRAMSystem(config, output_dir, read_callback, write_callback),
+      channel_done_(config_.channels),
+      batch_cycles_(1) {
     if (config_.IsHMC()) {
         std::cerr << "Initialized a memory system with an HMC config file!"
                   << std::endl;
@@ -111,6 +203,40 @@ JedecDRAMSystem::JedecDRAMSystem(Config &config, const std::string &output_dir,
         ctrls_.push_back(new Controller(i, config_, timing_));
 #endif  // THERMAL
     }
+    AttachCommandTracer();
+
+    tick_task_ = [this](int i) {
+        // same per-cycle order as the serial loop: drain, then tick;
+        // idle stretches up to the next event are skipped in one step
+        auto &done = channel_done_[i];
+        uint64_t end = clk_ + batch_cycles_;
+        uint64_t c = clk_;
+        while (c < end) {
+            Transaction trans;
+            while (ctrls_[i]->ReturnDoneTrans(c, trans)) {
+                done.push_back({c, trans.addr, trans.is_write, trans.id, i});
+            }
+            uint64_t next = ctrls_[i]->ClockTickUntil(end);
+            if (next > c) {
+                c = next;
+            } else {
+                ctrls_[i]->ClockTick();
+                c++;
+            }
+        }
+    };
+#ifdef THERMAL
+    // the thermal calculator is shared by all controllers
+    if (config_.tick_threads > 1) {
+        std::cerr << "tick_threads ignored, thermal model needs serial ticks"
+                  << std::endl;
+    }
+#else
+    int threads = std::min(config_.tick_threads, config_.channels);
+    if (threads > 1) {
+        tick_pool_.reset(new TickPool(threads));
+    }
+#endif  // THERMAL
 }
 
 JedecDRAMSystem::~JedecDRAMSystem() {
@@ -126,41 +252,90 @@ bool JedecDRAMSystem::WillAcceptTransaction(uint64_t hex_addr,
     return ctrls_[channel]->WillAcceptTransaction(hex_addr, is_write);
 }
 
-bool JedecDRAMSystem::AddTransaction(uint64_t hex_addr, bool is_write) {
-// Record trace - Record address trace for debugging or other purposes
-#ifdef ADDR_TRACE
-    address_trace_ << std::hex << hex_addr << std::dec << " "
-                   << (is_write ? "WRITE " : "READ ") << clk_ << std::endl;
-#endif
-
+bool JedecDRAMSystem::AddTransaction(uint64_t hex_addr, bool is_write,
+                                     uint64_t id, int requester) {
     int channel = GetChannel(hex_addr);
+    TraceTransaction(channel, hex_addr, is_write);
     bool ok = ctrls_[channel]->WillAcceptTransaction(hex_addr, is_write);
 
     assert(ok);
     if (ok) {
-        Transaction trans = Transaction(hex_addr, is_write);
+        Transaction trans = Transaction(hex_addr, is_write, id);
+        trans.requester = requester;
         ctrls_[channel]->AddTransaction(trans);
     }
     last_req_clk_ = clk_;
     return ok;
 }
 
+size_t JedecDRAMSystem::AddTransactions(TransactionRequest *reqs,
+                                        size_t count) {
+    // channel bits of every request in one branch free pass
+    int shift = config_.shift_bits + config_.ch_pos;
+    uint64_t mask = static_cast<uint64_t>(config_.ch_mask);
+    bulk_channel_.resize(count);
+    for (size_t i = 0; i < count; i++) {
+        bulk_channel_[i] = static_cast<int>((reqs[i].addr >> shift) & mask);
+    }
+
+    // stable counting sort by channel; afterwards bulk_start_[c] is where
+    // the requests of channel c end
+    bulk_start_.assign(config_.channels + 1, 0);
+    for (size_t i = 0; i < count; i++) {
+        bulk_start_[bulk_channel_[i] + 1]++;
+    }
+    for (int c = 0; c < config_.channels; c++) {
+        bulk_start_[c + 1] += bulk_start_[c];
+    }
+    bulk_order_.resize(count);
+    for (size_t i = 0; i < count; i++) {
+        bulk_order_[bulk_start_[bulk_channel_[i]]++] = i;
+    }
+
+    size_t accepted = 0;
+    size_t begin = 0;
+    for (int c = 0; c < config_.channels; c++) {
+        Controller *ctrl = ctrls_[c];
+        bool open = true;
+        for (size_t k = begin; k < bulk_start_[c]; k++) {
+            TransactionRequest &req = reqs[bulk_order_[k]];
+            open = open && ctrl->WillAcceptTransaction(req.addr, req.is_write);
+            req.accepted = open;
+            if (!open) {
+                continue;
+            }
+            TraceTransaction(c, req.addr, req.is_write);
+            Transaction trans(req.addr, req.is_write, req.id);
+            trans.requester = req.requester;
+            ctrl->AddTransaction(trans);
+            accepted++;
+        }
+        begin = bulk_start_[c];
+    }
+    last_req_clk_ = clk_;
+    return accepted;
+}
+
 void JedecDRAMSystem::ClockTick() {
     for (size_t i = 0; i < ctrls_.size(); i++) {
         // look ahead and return earlier
-        while (true) {
-            auto pair = ctrls_[i]->ReturnDoneTrans(clk_);
-            if (pair.second == 1) {
-                write_callback_(pair.first);
-            } else if (pair.second == 0) {
-                read_callback_(pair.first);
-            } else {
-                break;
-            }
+        Transaction trans;
+        while (ctrls_[i]->ReturnDoneTrans(clk_, trans)) {
+            ReturnTransaction(trans, static_cast<int>(i));
         }
     }
-    for (size_t i = 0; i < ctrls_.size(); i++) {
-        ctrls_[i]->ClockTick();
+    // an idle controller only needs its cycle counters bumped
+    auto tick = [this](int i) {
+        if (ctrls_[i]->ClockTickUntil(clk_ + 1) == clk_) {
+            ctrls_[i]->ClockTick();
+        }
+    };
+    if (tick_pool_) {
+        tick_pool_->Run(static_cast<int>(ctrls_.size()), tick);
+    } else {
+        for (size_t i = 0; i < ctrls_.size(); i++) {
+            tick(static_cast<int>(i));
+        }
     }
     clk_++;
 
@@ -171,41 +346,92 @@ void JedecDRAMSystem::ClockTick() {
     return;
 }
 
-IdealDRAMSystem::IdealDRAMSystem(Config &config, const std::string &output_dir,
-                                 std::function<void(uint64_t)> read_callback,
-                                 std::function<void(uint64_t)> write_callback)
+void JedecDRAMSystem::ClockTicks(uint64_t cycles,
+                                 std::vector<DoneTransaction> &done) {
+    while (cycles > 0) {
+        // never run past an epoch boundary, epoch stats are printed there
+        uint64_t to_epoch = config_.epoch_period - clk_ % config_.epoch_period;
+        uint64_t batch = std::min(cycles, to_epoch);
+        TickChannels(batch);
+
+        // merge the per-channel buffers in (cycle, channel) order
+        std::vector<size_t> heads(ctrls_.size(), 0);
+        for (uint64_t c = clk_; c < clk_ + batch; c++) {
+            for (size_t i = 0; i < ctrls_.size(); i++) {
+                auto &chan_done = channel_done_[i];
+                while (heads[i] < chan_done.size() &&
+                       chan_done[heads[i]].cycle == c) {
+                    done.push_back(chan_done[heads[i]++]);
+                }
+            }
+        }
+        for (auto &chan_done : channel_done_) {
+            chan_done.clear();
+        }
+
+        clk_ += batch;
+        cycles -= batch;
+        if (clk_ % config_.epoch_period == 0) {
+            PrintEpochStats();
+        }
+    }
+}
+
+uint64_t JedecDRAMSystem::NextEventCycle() const {
+    uint64_t next = std::numeric_limits<uint64_t>::max();
+    for (size_t i = 0; i < ctrls_.size() && next > clk_; i++) {
+        next = std::min(next, ctrls_[i]->NextEventCycle());
+    }
+    return std::max(next, clk_);
+}
+
+void JedecDRAMSystem::TickChannels(uint64_t cycles) {
+    batch_cycles_ = cycles;
+    if (tick_pool_) {
+        tick_pool_->Run(static_cast<int>(ctrls_.size()), tick_task_);
+    } else {
+        for (size_t i = 0; i < ctrls_.size(); i++) {
+            tick_task_(static_cast<int>(i));
+        }
+    }
+}
+
+IdealDRAMSystem::IdealDRAMSystem(
+    const Config &config, const std::string &output_dir,
+    std::function<void(uint64_t)> read_callback,
+    std::function<void(uint64_t)> write_callback)
     : BaseDRAMSystem(config, output_dir, read_callback, write_callback),
       latency_(config_.ideal_memory_latency) {}
 
 IdealDRAMSystem::~IdealDRAMSystem() {}
 
-bool IdealDRAMSystem::AddTransaction(uint64_t hex_addr, bool is_write) {
-    auto trans = Transaction(hex_addr, is_write);
+bool IdealDRAMSystem::AddTransaction(uint64_t hex_addr, bool is_write,
+                                     uint64_t id, int requester) {
+    TraceTransaction(GetChannel(hex_addr), hex_addr, is_write);
+    auto trans = Transaction(hex_addr, is_write, id);
     trans.added_cycle = clk_;
     infinite_buffer_q_.push_back(trans);
     return true;
 }
 
 void IdealDRAMSystem::ClockTick() {
-
-    for (auto trans_it = infinite_buffer_q_.begin();
-         trans_it != infinite_buffer_q_.end();) {
-        if (clk_ - trans_it->added_cycle >= static_cast<uint64_t>(latency_)) {
-            if (trans_it->is_write) {
-                   
-                write_callback_(trans_it->addr);
-            } else {
-                read_callback_(trans_it->addr);
-            }
-            trans_it = infinite_buffer_q_.erase(trans_it++);
-        }
-        if (trans_it != infinite_buffer_q_.end()) {
-            ++trans_it;
-        }
+    while (!infinite_buffer_q_.empty() &&
+           clk_ - infinite_buffer_q_.front().added_cycle >=
+               static_cast<uint64_t>(latency_)) {
+        const Transaction &trans = infinite_buffer_q_.front();
+        ReturnTransaction(trans, GetChannel(trans.addr));
+        infinite_buffer_q_.pop_front();
     }
 
     clk_++;
     return;
 }
 
+uint64_t IdealDRAMSystem::NextEventCycle() const {
+    if (infinite_buffer_q_.empty()) {
+        return std::numeric_limits<uint64_t>::max();
+    }
+    return std::max(clk_, infinite_buffer_q_.front().added_cycle + latency_);
+}
+
 }  // namespace dramsim3
@@ -1,13 +1,18 @@
 #ifndef __DRAM_SYSTEM_H
 #define __DRAM_SYSTEM_H
 
+#include <deque>
 #include <fstream>
+#include <memory>
 #include <string>
 #include <vector>
 
 #include "common.h"
 #include "configuration.h"
+#include "cmd_trace.h"
 #include "controller.h"
+#include "epoch_writer.h"
+#include "tick_pool.h"
 #include "timing.h"
 
 #ifdef THERMAL
@@ -16,31 +21,101 @@
 
 namespace dramsim3 {
 
+// a transaction finished during ClockTicks(), reported instead of a callback
+struct DoneTransaction {
+    uint64_t cycle;
+    uint64_t addr;
+    bool is_write;
+    uint64_t id;  // as given to AddTransaction()
+    int channel;
+};
+
+// one request of a bulk AddTransactions() call
+struct TransactionRequest {
+    uint64_t addr;
+    uint64_t id;
+    int requester;  // -1 if not attributed, see Transaction::requester
+    bool is_write;
+    bool accepted;  // filled in by AddTransactions()
+};
+
+// completion callback carrying the id given to AddTransaction() and the
+// channel that served the transaction, so hosts need not match by address
+using TransactionCallback =
+    std::function<void(uint64_t id, uint64_t addr, int channel)>;
+
 class BaseDRAMSystem {
    public:
-    BaseDRAMSystem(Config &config, const std::string &output_dir,
+    BaseDRAMSystem(const Config &config, const std::string &output_dir,
                    std::function<void(uint64_t)> read_callback,
                    std::function<void(uint64_t)> write_callback);
     virtual ~BaseDRAMSystem() {}
     void RegisterCallbacks(std::function<void(uint64_t)> read_callback,
                            std::function<void(uint64_t)> write_callback);
-    void PrintEpochStats();
-    void PrintStats();
-    void ResetStats();
+    // once registered these replace the address-only callbacks
+    void RegisterIdCallbacks(TransactionCallback read_callback,
+                             TransactionCallback write_callback);
+    virtual void PrintEpochStats();
+    virtual void PrintStats();
+    virtual void ResetStats();
 
     virtual bool WillAcceptTransaction(uint64_t hex_addr,
                                        bool is_write) const = 0;
-    virtual bool AddTransaction(uint64_t hex_addr, bool is_write) = 0;
+    // |id| is handed back to the id callbacks, transactions to the same
+    // address may be merged but each one still completes with its own id.
+    // |requester| selects the per-requester stats, -1 for none.
+    virtual bool AddTransaction(uint64_t hex_addr, bool is_write, uint64_t id,
+                                int requester) = 0;
+    bool AddTransaction(uint64_t hex_addr, bool is_write, uint64_t id) {
+        return AddTransaction(hex_addr, is_write, id, -1);
+    }
+    bool AddTransaction(uint64_t hex_addr, bool is_write) {
+        return AddTransaction(hex_addr, is_write, hex_addr, -1);
+    }
+    // Add |count| requests in one call. A channel takes its requests in
+    // array order until it refuses one; the rest of that channel is refused
+    // too so no two requests to a channel are reordered. Sets |accepted| on
+    // every request and returns the number accepted.
+    virtual size_t AddTransactions(TransactionRequest *reqs, size_t count);
     virtual void ClockTick() = 0;
+    // Advance several cycles in one call. Finished transactions are not
+    // passed to the callbacks but appended to |done| in (cycle, channel)
+    // order, i.e. the order ClockTick() would have called back in, so no
+    // transaction can be added in between.
+    virtual void ClockTicks(uint64_t cycles, std::vector<DoneTransaction> &done);
+    // Earliest cycle at which ClockTick() may call back, so an event driven
+    // host can sleep until then (but still must call ClockTicks() to catch
+    // up before adding transactions). Cycle accurate models need every tick.
+    virtual uint64_t NextEventCycle() const { return clk_; }
+    uint64_t Clk() const { return clk_; }
     int GetChannel(uint64_t hex_addr) const;
 
     std::function<void(uint64_t req_id)> read_callback_, write_callback_;
+    TransactionCallback read_id_callback_, write_id_callback_;
     static int total_channels_;
 
    protected:
+    // hand a finished transaction to the registered callbacks
+    void ReturnTransaction(const Transaction &trans, int channel);
+
+    // the epoch stats file, opened at the first epoch and shared by all
+    // channels of this system; nullptr if epoch stats are disabled
+    EpochWriter *EpochStatsWriter();
+    // write the closing part of the epoch stats file
+    void FinishEpochStats();
+    // hand the tracer to ctrls_ if cmd_trace is on
+    void AttachCommandTracer();
+    void TraceTransaction(int channel, uint64_t hex_addr, bool is_write) {
+        if (config_.addr_trace && tracer_->InWindow(clk_)) {
+            tracer_->AddTransaction(channel, clk_, hex_addr, is_write);
+        }
+    }
+    // drain the trace and close its file
+    void FinishTrace();
+
     uint64_t id_;
     uint64_t last_req_clk_;
-    Config &config_;
+    const Config &config_;
     Timing timing_;
     uint64_t parallel_cycles_;
     uint64_t serial_cycles_;
@@ -51,22 +126,46 @@ class BaseDRAMSystem {
 
     uint64_t clk_;
     std::vector<Controller*> ctrls_;
-
-#ifdef ADDR_TRACE
-    std::ofstream address_trace_;
-#endif  // ADDR_TRACE
+    // opened at the first epoch, shared by all channels of this system
+    std::unique_ptr<EpochWriter> epoch_writer_;
+    // binary command and transaction trace, nullptr if neither is on
+    std::unique_ptr<CommandTracer> tracer_;
 };
 
 // hmmm not sure this is the best naming...
 class JedecDRAMSystem : public BaseDRAMSystem {
    public:
-    JedecDRAMSystem(Config &config, const std::string &output_dir,
+    JedecDRAMSystem(const Config &config, const std::string &output_dir,
                     std::function<void(uint64_t)> read_callback,
                     std::function<void(uint64_t)> write_callback);
     ~JedecDRAMSystem();
     bool WillAcceptTransaction(uint64_t hex_addr, bool is_write) const override;
-    bool AddTransaction(uint64_t hex_addr, bool is_write) override;
+    using BaseDRAMSystem::AddTransaction;
+    bool AddTransaction(uint64_t hex_addr, bool is_write, uint64_t id,
+                        int requester) override;
+    // decodes all channels in one pass and feeds each controller its
+    // requests back to back
+    size_t AddTransactions(TransactionRequest *reqs, size_t count) override;
     void ClockTick() override;
+    void ClockTicks(uint64_t cycles,
+                    std::vector<DoneTransaction> &done) override;
+    // idle controllers only wake up for completions and refreshes
+    uint64_t NextEventCycle() const override;
+
+   private:
+    // controllers of different channels share nothing, so with
+    // tick_threads > 1 they are ticked on a worker pool while callbacks
+    // stay on the calling thread in channel order
+    std::unique_ptr<TickPool> tick_pool_;
+    std::function<void(int)> tick_task_;
+    std::vector<std::vector<DoneTransaction>> channel_done_;
+    uint64_t batch_cycles_;
+    // scratch space of AddTransactions(), kept to avoid allocations
+    std::vector<int> bulk_channel_;
+    std::vector<size_t> bulk_start_;
+    std::vector<size_t> bulk_order_;
+
+    void TickChannels(uint64_t cycles);
 };
 
 // Model a memorysystem with an infinite bandwidth and a fixed latency (possibly
@@ -74,7 +173,7 @@ class JedecDRAMSystem : public BaseDRAMSystem {
 // cannot do for a given application
 class IdealDRAMSystem : public BaseDRAMSystem {
    public:
-    IdealDRAMSystem(Config &config, const std::string &output_dir,
+    IdealDRAMSystem(const Config &config, const std::string &output_dir,
                     std::function<void(uint64_t)> read_callback,
                     std::function<void(uint64_t)> write_callback);
     ~IdealDRAMSystem();
@@ -82,12 +181,16 @@ class IdealDRAMSystem : public BaseDRAMSystem {
                                bool is_write) const override {
         return true;
     };
-    bool AddTransaction(uint64_t hex_addr, bool is_write) override;
+    using BaseDRAMSystem::AddTransaction;
+    bool AddTransaction(uint64_t hex_addr, bool is_write, uint64_t id,
+                        int requester) override;
     void ClockTick() override;
+    uint64_t NextEventCycle() const override;
 
    private:
     int latency_;
-    std::vector<Transaction> infinite_buffer_q_;
+    // the latency is fixed, so transactions complete in arrival order
+    std::deque<Transaction> infinite_buffer_q_;
 };
 
 }  // namespace dramsim3
@@ -2,20 +2,41 @@
 #define __MEMORY_SYSTEM__H
 
 #include <functional>
+#include <memory>
 #include <string>
 
 namespace dramsim3 {
 
+class Config;
+
+// one request of a bulk AddTransactions() call
+struct TransactionRequest {
+    uint64_t addr;
+    uint64_t id;
+    int requester;  // -1 if not attributed
+    bool is_write;
+    bool accepted;  // filled in by AddTransactions()
+};
+
 // This should be the interface class that deals with CPU
 class MemorySystem {
    public:
     MemorySystem(const std::string &config_file, const std::string &output_dir,
                  std::function<void(uint64_t)> read_callback,
                  std::function<void(uint64_t)> write_callback);
+    // one parsed config for many memory systems, from Config::Shared() in
+    // configuration.h, which can also cache it on disk across runs
+    MemorySystem(std::shared_ptr<const Config> config,
+                 std::function<void(uint64_t)> read_callback,
+                 std::function<void(uint64_t)> write_callback);
     ~MemorySystem();
     void ClockTick();
     void RegisterCallbacks(std::function<void(uint64_t)> read_callback,
                            std::function<void(uint64_t)> write_callback);
+    // call back with (id, addr, channel) instead, see AddTransaction()
+    void RegisterIdCallbacks(
+        std::function<void(uint64_t, uint64_t, int)> read_callback,
+        std::function<void(uint64_t, uint64_t, int)> write_callback);
     double GetTCK() const;
     int GetBusBits() const;
     int GetBurstLength() const;
@@ -25,6 +46,17 @@ class MemorySystem {
 
     bool WillAcceptTransaction(uint64_t hex_addr, bool is_write) const;
     bool AddTransaction(uint64_t hex_addr, bool is_write);
+    // |id| comes back to the id callbacks, so completions can be matched
+    // exactly even when reads to the same address are merged
+    bool AddTransaction(uint64_t hex_addr, bool is_write, uint64_t id);
+    // also attribute it to |requester| in the per-requester stats, see
+    // [system] num_requesters
+    bool AddTransaction(uint64_t hex_addr, bool is_write, uint64_t id,
+                        int requester);
+    // Add |count| requests at once. Each channel takes its requests in
+    // order until it refuses one, the rest of that channel are refused too.
+    // Sets |accepted| on every request and returns the number accepted.
+    size_t AddTransactions(TransactionRequest *reqs, size_t count);
 };
 
 MemorySystem* GetMemorySystem(const std::string &config_file, const std::string &output_dir,
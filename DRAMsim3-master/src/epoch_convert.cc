@@ -0,0 +1,89 @@
+#include <stdint.h>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "./../ext/headers/args.hxx"
+#include "epoch_writer.h"
+
+// this will not be used in a library file so it's ok to do this
+using namespace dramsim3;
+
+// Turn an NDJSON or binary epoch stats file into the JSON array layout that
+// scripts/plot_stats expects
+int main(int argc, const char **argv) {
+    args::ArgumentParser parser(
+        "Convert DRAMsim3 epoch stats to a JSON array.",
+        "Examples: \n"
+        "./build/epochconvert dramsim3epoch.bin dramsim3epoch.json\n"
+        "./build/epochconvert dramsim3epoch.ndjson dramsim3epoch.json");
+    args::HelpFlag help(parser, "help", "Display the help menu", {'h', "help"});
+    args::Positional<std::string> input_arg(
+        parser, "input", "epoch.ndjson or epoch.bin file (mandatory)");
+    args::Positional<std::string> output_arg(
+        parser, "output", "JSON file to write (mandatory)");
+
+    try {
+        parser.ParseCLI(argc, argv);
+    } catch (args::Help) {
+        std::cout << parser;
+        return 0;
+    } catch (args::ParseError e) {
+        std::cerr << e.what() << std::endl;
+        std::cerr << parser;
+        return 1;
+    }
+
+    std::string input_name = args::get(input_arg);
+    std::string output_name = args::get(output_arg);
+    if (input_name.empty() || output_name.empty()) {
+        std::cerr << parser;
+        return 1;
+    }
+
+    std::ifstream in(input_name, std::ifstream::binary);
+    if (!in) {
+        std::cerr << "cannot open " << input_name << std::endl;
+        return 1;
+    }
+    // the writer produces the same bytes as the simulator's JSON format
+    EpochWriter out(output_name, EpochWriter::Format::JSON);
+    uint64_t num_records = 0;
+
+    char magic[sizeof(kEpochBinaryMagic)] = {0};
+    in.read(magic, sizeof(magic));
+    if (in.gcount() == sizeof(magic) &&
+        std::memcmp(magic, kEpochBinaryMagic, sizeof(magic)) == 0) {
+        std::vector<uint8_t> bytes;
+        unsigned char len_bytes[4];
+        while (in.read(reinterpret_cast<char *>(len_bytes), 4)) {
+            uint32_t len = len_bytes[0] | (len_bytes[1] << 8) |
+                           (len_bytes[2] << 16) |
+                           (static_cast<uint32_t>(len_bytes[3]) << 24);
+            bytes.resize(len);
+            if (!in.read(reinterpret_cast<char *>(bytes.data()), len)) {
+                std::cerr << "truncated record " << num_records << " in "
+                          << input_name << std::endl;
+                return 1;
+            }
+            out.Write(nlohmann::json::from_msgpack(bytes));
+            num_records++;
+        }
+    } else {
+        in.clear();
+        in.seekg(0);
+        std::string line;
+        while (std::getline(in, line)) {
+            if (line.empty()) {
+                continue;
+            }
+            out.Write(nlohmann::json::parse(line));
+            num_records++;
+        }
+    }
+    out.Close();
+    std::cout << num_records << " epoch records written to " << output_name
+              << std::endl;
+    return 0;
+}
@@ -0,0 +1,139 @@
+#include "epoch_writer.h"
+#include <iostream>
+#include "common.h"
+
+namespace dramsim3 {
+
+EpochWriter::EpochWriter(const std::string& file_name, Format format,
+                         size_t flush_bytes)
+    : file_(file_name, std::ofstream::out | std::ofstream::binary),
+      format_(format),
+      flush_bytes_(flush_bytes),
+      first_record_(true),
+      closed_(false),
+      back_pending_(false),
+      stop_(false) {
+    if (!file_) {
+        std::cerr << "Cannot open epoch stats file " << file_name
+                  << std::endl;
+        AbruptExit(__FILE__, __LINE__);
+    }
+    front_.reserve(flush_bytes_);
+    back_.reserve(flush_bytes_);
+    if (format_ == Format::JSON) {
+        front_ += "[";
+    } else if (format_ == Format::BINARY) {
+        Append(kEpochBinaryMagic, sizeof(kEpochBinaryMagic));
+    }
+    flusher_ = std::thread(&EpochWriter::FlushLoop, this);
+}
+
+EpochWriter::~EpochWriter() { Close(); }
+
+EpochWriter::Format EpochWriter::ParseFormat(const std::string& name) {
+    if (name == "json") {
+        return Format::JSON;
+    } else if (name == "ndjson") {
+        return Format::NDJSON;
+    } else if (name == "binary") {
+        return Format::BINARY;
+    }
+    std::cerr << "Unknown epoch_format " << name
+              << ", expecting json, ndjson or binary" << std::endl;
+    AbruptExit(__FILE__, __LINE__);
+    return Format::JSON;
+}
+
+std::string EpochWriter::FileSuffix(Format format) {
+    switch (format) {
+        case Format::NDJSON:
+            return "epoch.ndjson";
+        case Format::BINARY:
+            return "epoch.bin";
+        default:
+            return "epoch.json";
+    }
+}
+
+void EpochWriter::Append(const char* data, size_t len) {
+    front_.append(data, len);
+}
+
+void EpochWriter::Write(const nlohmann::json& record) {
+    switch (format_) {
+        case Format::JSON:
+            // separators go in front so the array closes without patching
+            if (!first_record_) {
+                front_ += ",\n";
+            }
+            front_ += record.dump();
+            break;
+        case Format::NDJSON:
+            front_ += record.dump();
+            front_ += "\n";
+            break;
+        case Format::BINARY: {
+            std::vector<uint8_t> bytes = nlohmann::json::to_msgpack(record);
+            uint32_t len = static_cast<uint32_t>(bytes.size());
+            char len_bytes[4] = {static_cast<char>(len & 0xff),
+                                 static_cast<char>((len >> 8) & 0xff),
+                                 static_cast<char>((len >> 16) & 0xff),
+                                 static_cast<char>((len >> 24) & 0xff)};
+            Append(len_bytes, sizeof(len_bytes));
+            Append(reinterpret_cast<const char*>(bytes.data()), bytes.size());
+            break;
+        }
+    }
+    first_record_ = false;
+    if (front_.size() >= flush_bytes_) {
+        HandOff();
+    }
+}
+
+void EpochWriter::HandOff() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    // only block if the flusher is still busy with the previous buffer
+    cv_.wait(lock, [this] { return !back_pending_; });
+    front_.swap(back_);
+    back_pending_ = true;
+    lock.unlock();
+    cv_.notify_all();
+}
+
+void EpochWriter::FlushLoop() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+        cv_.wait(lock, [this] { return back_pending_ || stop_; });
+        if (back_pending_) {
+            // the simulation thread leaves back_ alone until it is released
+            lock.unlock();
+            file_.write(back_.data(), back_.size());
+            back_.clear();
+            lock.lock();
+            back_pending_ = false;
+            cv_.notify_all();
+        } else {
+            return;
+        }
+    }
+}
+
+void EpochWriter::Close() {
+    if (closed_) {
+        return;
+    }
+    closed_ = true;
+    if (format_ == Format::JSON) {
+        front_ += "]\n";
+    }
+    HandOff();
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+    cv_.notify_all();
+    flusher_.join();
+    file_.close();
+}
+
+}  // namespace dramsim3
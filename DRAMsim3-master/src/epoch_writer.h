@@ -0,0 +1,68 @@
+#ifndef __EPOCH_WRITER_H
+#define __EPOCH_WRITER_H
+
+#include <stdint.h>
+#include <condition_variable>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "json.hpp"
+
+namespace dramsim3 {
+
+// Magic bytes opening a binary epoch stats file
+static const char kEpochBinaryMagic[8] = {'D', 'S', '3', 'E',
+                                          'P', 'O', 'C', '1'};
+
+// Streams per-channel epoch stats records to one file that stays open for
+// the whole run. Records are serialized into a memory buffer; once it
+// grows past |flush_bytes| it is handed to a background thread that writes
+// it out while the simulation keeps going. Formats:
+//   JSON   - a single JSON array, the historic dramsim3epoch.json layout
+//   NDJSON - one JSON object per line
+//   BINARY - kEpochBinaryMagic, then per record a little-endian uint32
+//            length followed by that many bytes of MessagePack
+// NDJSON and BINARY files can be turned back into the JSON layout with the
+// epochconvert tool.
+class EpochWriter {
+   public:
+    enum class Format { JSON, NDJSON, BINARY };
+
+    EpochWriter(const std::string& file_name, Format format,
+                size_t flush_bytes = 1 << 20);
+    ~EpochWriter();
+    EpochWriter(const EpochWriter&) = delete;
+    EpochWriter& operator=(const EpochWriter&) = delete;
+
+    void Write(const nlohmann::json& record);
+    // Terminate the file and wait for everything to hit the disk
+    void Close();
+
+    static Format ParseFormat(const std::string& name);
+    static std::string FileSuffix(Format format);
+
+   private:
+    void Append(const char* data, size_t len);
+    void HandOff();
+    void FlushLoop();
+
+    std::ofstream file_;
+    Format format_;
+    size_t flush_bytes_;
+    bool first_record_;
+    bool closed_;
+
+    // filled by the simulation thread, swapped with back_ on hand off
+    std::string front_;
+    std::string back_;
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    bool back_pending_;
+    bool stop_;
+    std::thread flusher_;
+};
+
+}  // namespace dramsim3
+#endif  // __EPOCH_WRITER_H
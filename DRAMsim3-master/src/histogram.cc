@@ -0,0 +1,94 @@
+#include "histogram.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace dramsim3 {
+
+LogLinearHistogram::LogLinearHistogram(int sub_bucket_bits, int max_value_bits)
+    : sub_bucket_bits_(sub_bucket_bits),
+      sub_bucket_count_(1ull << sub_bucket_bits),
+      sub_bucket_half_(1ull << (sub_bucket_bits - 1)),
+      counts_(sub_bucket_count_ +
+                  (max_value_bits - sub_bucket_bits) * sub_bucket_half_,
+              0),
+      total_count_(0),
+      sum_(0),
+      min_(std::numeric_limits<uint64_t>::max()),
+      max_(0) {}
+
+size_t LogLinearHistogram::BucketIndex(uint64_t value) const {
+    if (value < sub_bucket_count_) {
+        return static_cast<size_t>(value);
+    }
+    int msb = 63 - __builtin_clzll(value);
+    int shift = msb - (sub_bucket_bits_ - 1);
+    size_t index = sub_bucket_count_ +
+                   (msb - sub_bucket_bits_) * sub_bucket_half_ +
+                   ((value >> shift) - sub_bucket_half_);
+    return std::min(index, counts_.size() - 1);
+}
+
+uint64_t LogLinearHistogram::BucketLow(size_t index) const {
+    if (index < sub_bucket_count_) {
+        return index;
+    }
+    uint64_t offset = index - sub_bucket_count_;
+    int shift = static_cast<int>(offset / sub_bucket_half_) + 1;
+    return (sub_bucket_half_ + offset % sub_bucket_half_) << shift;
+}
+
+uint64_t LogLinearHistogram::BucketHigh(size_t index) const {
+    if (index < sub_bucket_count_) {
+        return index;
+    }
+    uint64_t offset = index - sub_bucket_count_;
+    int shift = static_cast<int>(offset / sub_bucket_half_) + 1;
+    return ((sub_bucket_half_ + offset % sub_bucket_half_ + 1) << shift) - 1;
+}
+
+void LogLinearHistogram::Merge(const LogLinearHistogram& other) {
+    for (size_t i = 0; i < counts_.size(); i++) {
+        counts_[i] += other.counts_[i];
+    }
+    total_count_ += other.total_count_;
+    sum_ += other.sum_;
+    min_ = std::min(min_, other.min_);
+    max_ = std::max(max_, other.max_);
+}
+
+void LogLinearHistogram::Clear() {
+    std::fill(counts_.begin(), counts_.end(), 0);
+    total_count_ = 0;
+    sum_ = 0;
+    min_ = std::numeric_limits<uint64_t>::max();
+    max_ = 0;
+}
+
+double LogLinearHistogram::Mean() const {
+    return total_count_ == 0 ? 0.0
+                             : static_cast<double>(sum_) /
+                                   static_cast<double>(total_count_);
+}
+
+uint64_t LogLinearHistogram::ValueAtQuantile(double quantile) const {
+    if (total_count_ == 0) {
+        return 0;
+    }
+    uint64_t target = static_cast<uint64_t>(
+        std::ceil(quantile * static_cast<double>(total_count_)));
+    target = std::max<uint64_t>(1, std::min(target, total_count_));
+    uint64_t seen = 0;
+    for (size_t i = 0; i < counts_.size(); i++) {
+        seen += counts_[i];
+        if (seen >= target) {
+            // the bucket bound can overshoot what was actually recorded, and
+            // the last bucket also holds everything past the tracked range
+            return i + 1 == counts_.size() ? max_
+                                           : std::min(BucketHigh(i), max_);
+        }
+    }
+    return max_;
+}
+
+}  // namespace dramsim3
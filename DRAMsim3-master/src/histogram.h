@@ -0,0 +1,68 @@
+#ifndef __HISTOGRAM_H
+#define __HISTOGRAM_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+namespace dramsim3 {
+
+// Log-linear (HDR-style) histogram of non-negative integer samples.
+// Values below 2^sub_bucket_bits get a bucket each and are kept exactly;
+// above that every power-of-two range is split into 2^(sub_bucket_bits - 1)
+// equal buckets, so a recorded value is off by at most 2^-(sub_bucket_bits-1)
+// of itself. Values of 2^max_value_bits and above land in the last bucket.
+// Recording is a couple of bit operations; merging and percentile queries
+// are one pass over the fixed bucket array. Count, sum, min and max are
+// tracked exactly.
+class LogLinearHistogram {
+   public:
+    explicit LogLinearHistogram(int sub_bucket_bits = 10,
+                                int max_value_bits = 24);
+
+    void Record(uint64_t value) {
+        counts_[BucketIndex(value)]++;
+        total_count_++;
+        sum_ += value;
+        min_ = value < min_ ? value : min_;
+        max_ = value > max_ ? value : max_;
+    }
+    void Merge(const LogLinearHistogram& other);
+    void Clear();
+
+    uint64_t Count() const { return total_count_; }
+    uint64_t Sum() const { return sum_; }
+    uint64_t Min() const { return total_count_ == 0 ? 0 : min_; }
+    uint64_t Max() const { return max_; }
+    double Mean() const;
+    // Smallest recorded value v (to bucket precision, rounded up) such that
+    // at least |quantile| of the samples are <= v
+    uint64_t ValueAtQuantile(double quantile) const;
+
+    // Visit the non-empty buckets in value order as (lowest value, count)
+    template <typename Func>
+    void ForEachBucket(Func func) const {
+        for (size_t i = 0; i < counts_.size(); i++) {
+            if (counts_[i] != 0) {
+                func(BucketLow(i), counts_[i]);
+            }
+        }
+    }
+
+   private:
+    int sub_bucket_bits_;
+    uint64_t sub_bucket_count_;
+    uint64_t sub_bucket_half_;
+    std::vector<uint64_t> counts_;
+    uint64_t total_count_;
+    uint64_t sum_;
+    uint64_t min_;
+    uint64_t max_;
+
+    size_t BucketIndex(uint64_t value) const;
+    uint64_t BucketLow(size_t index) const;
+    uint64_t BucketHigh(size_t index) const;
+};
+
+}  // namespace dramsim3
+#endif  // __HISTOGRAM_H
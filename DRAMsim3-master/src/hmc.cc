@@ -3,7 +3,11 @@
 namespace dramsim3 {
 
 HMCRequest::HMCRequest(HMCReqType req_type, uint64_t hex_addr, int vault)
-    : type(req_type), mem_operand(hex_addr), vault(vault) {
+    : type(req_type),
+      mem_operand(hex_addr),
+      trans_id(hex_addr),
+      requester(-1),
+      vault(vault) {
     is_write = type >= HMCReqType::WR0 && type <= HMCReqType::P_WR256;
     // given that vaults could be 16 (Gen1) or 32(Gen2), using % 4
     // to partition vaults to quads
@@ -111,7 +115,7 @@ HMCRequest::HMCRequest(HMCReqType req_type, uint64_t hex_addr, int vault)
 
 HMCResponse::HMCResponse(uint64_t id, HMCReqType req_type, int dest_link,
                          int src_quad)
-    : resp_id(id), link(dest_link), quad(src_quad) {
+    : resp_id(id), trans_id(id), link(dest_link), quad(src_quad) {
     switch (req_type) {
         case HMCReqType::RD0:
             type = HMCRespType::RD_RS;
@@ -240,9 +244,10 @@ HMCResponse::HMCResponse(uint64_t id, HMCReqType req_type, int dest_link,
     return;
 }
 
-HMCMemorySystem::HMCMemorySystem(Config &config, const std::string &output_dir,
-                                 std::function<void(uint64_t)> read_callback,
-                                 std::function<void(uint64_t)> write_callback)
+HMCMemorySystem::HMCMemorySystem(
+    const Config &config, const std::string &output_dir,
+    std::function<void(uint64_t)> read_callback,
+    std::function<void(uint64_t)> write_callback)
     : BaseDRAMSystem(config, output_dir, read_callback, write_callback),
       logic_clk_(0),
       logic_ps_(0),
@@ -266,6 +271,7 @@ HMCMemorySystem::HMCMemorySystem(Config &config, const std::string &output_dir,
         ctrls_.push_back(new Controller(i, config_, timing_));
 #endif  // THERMAL
     }
+    AttachCommandTracer();
     // initialize vaults and crossbar
     // the first layer of xbar will be num_links * 4 (4 for quadrants)
     // the second layer will be a 1:8 xbar
@@ -340,7 +346,8 @@ bool HMCMemorySystem::WillAcceptTransaction(uint64_t hex_addr,
     return insertable;
 }
 
-bool HMCMemorySystem::AddTransaction(uint64_t hex_addr, bool is_write) {
+bool HMCMemorySystem::AddTransaction(uint64_t hex_addr, bool is_write,
+                                     uint64_t id, int requester) {
     // to be compatible with other protocol we have this interface
     // when using this intreface the size of each transaction will be block_size
     HMCReqType req_type;
@@ -391,6 +398,8 @@ bool HMCMemorySystem::AddTransaction(uint64_t hex_addr, bool is_write) {
     }
     int vault = GetChannel(hex_addr);
     HMCRequest *req = new HMCRequest(req_type, hex_addr, vault);
+    req->trans_id = id;
+    req->requester = requester;
     return InsertHMCReq(req);
 }
 
@@ -405,8 +414,9 @@ bool HMCMemorySystem::InsertReqToLink(HMCRequest *req, int link) {
         link_req_queues_[link].push_back(req);
         HMCResponse *resp =
             new HMCResponse(req->mem_operand, req->type, link, req->quad);
+        resp->trans_id = req->trans_id;
         resp_lookup_table_.insert(
-            std::pair<uint64_t, HMCResponse *>(resp->resp_id, resp));
+            std::pair<uint64_t, HMCResponse *>(resp->trans_id, resp));
         link_age_counter_[link] = 1;
         // stats_.interarrival_latency.AddValue(clk_ - last_req_clk_);
         last_req_clk_ = clk_;
@@ -497,11 +507,10 @@ void HMCMemorySystem::DrainResponses() {
         if (!link_resp_queues_[i].empty()) {
             HMCResponse *resp = link_resp_queues_[i].front();
             if (resp->exit_time <= logic_clk_) {
-                if (resp->type == HMCRespType::RD_RS) {
-                    read_callback_(resp->resp_id);
-                } else {
-                    write_callback_(resp->resp_id);
-                }
+                Transaction trans(resp->resp_id,
+                                  resp->type != HMCRespType::RD_RS,
+                                  resp->trans_id);
+                ReturnTransaction(trans, GetChannel(resp->resp_id));
                 delete (resp);
                 link_resp_queues_[i].erase(link_resp_queues_[i].begin());
             }
@@ -544,15 +553,9 @@ void HMCMemorySystem::DrainResponses() {
 void HMCMemorySystem::DRAMClockTick() {
     for (size_t i = 0; i < ctrls_.size(); i++) {
         // look ahead and return earlier
-        while (true) {
-            auto pair = ctrls_[i]->ReturnDoneTrans(clk_);
-            if (pair.second == 1) {  // write
-                VaultCallback(pair.first);
-            } else if (pair.second == 0) {  // read
-                VaultCallback(pair.first);
-            } else {
-                break;
-            }
+        Transaction trans;
+        while (ctrls_[i]->ReturnDoneTrans(clk_, trans)) {
+            VaultCallback(trans.id);
         }
     }
     for (size_t i = 0; i < ctrls_.size(); i++) {
@@ -613,18 +616,20 @@ std::vector<int> HMCMemorySystem::BuildAgeQueue(std::vector<int> &age_counter) {
 }
 
 void HMCMemorySystem::InsertReqToDRAM(HMCRequest *req) {
-    Transaction trans(req->mem_operand, req->is_write);
+    Transaction trans(req->mem_operand, req->is_write, req->trans_id);
+    trans.requester = req->requester;
+    TraceTransaction(req->vault, trans.addr, trans.is_write);
     ctrls_[req->vault]->AddTransaction(trans);
     return;
 }
 
-void HMCMemorySystem::VaultCallback(uint64_t req_id) {
-    // we will use hex addr as the req_id and use a multimap to lookup the
+void HMCMemorySystem::VaultCallback(uint64_t trans_id) {
+    // we will use the transaction id and a multimap to lookup the
     // requests the vaults cannot directly talk to the CPU so this callback will
     // be passed to the vaults and is responsible to put the responses back to
     // response queues
 
-    auto it = resp_lookup_table_.find(req_id);
+    auto it = resp_lookup_table_.find(trans_id);
     HMCResponse *resp = it->second;
     // all data from dram received, put packet in xbar and return
     resp_lookup_table_.erase(it);
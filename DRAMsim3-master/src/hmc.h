@@ -81,6 +81,9 @@ class HMCRequest {
     HMCRequest(HMCReqType req_type, uint64_t hex_addr, int vault);
     HMCReqType type;
     uint64_t mem_operand;
+    // handed back on completion, the address unless set otherwise
+    uint64_t trans_id;
+    int requester;  // for the per-requester stats of the vault
     int link;
     int quad;
     int vault;
@@ -94,6 +97,7 @@ class HMCResponse {
    public:
     HMCResponse(uint64_t id, HMCReqType reqtype, int dest_link, int src_quad);
     uint64_t resp_id;
+    uint64_t trans_id;
     HMCRespType type;
     int link;
     int quad;
@@ -104,7 +108,7 @@ class HMCResponse {
 
 class HMCMemorySystem : public BaseDRAMSystem {
    public:
-    HMCMemorySystem(Config& config, const std::string& output_dir,
+    HMCMemorySystem(const Config& config, const std::string& output_dir,
                     std::function<void(uint64_t)> read_callback,
                     std::function<void(uint64_t)> write_callback);
     ~HMCMemorySystem();
@@ -115,7 +119,9 @@ class HMCMemorySystem : public BaseDRAMSystem {
 
     // had to have 3 insert interfaces cuz HMC is so different...
     bool WillAcceptTransaction(uint64_t hex_addr, bool is_write) const override;
-    bool AddTransaction(uint64_t hex_addr, bool is_write) override;
+    using BaseDRAMSystem::AddTransaction;
+    bool AddTransaction(uint64_t hex_addr, bool is_write, uint64_t id,
+                        int requester) override;
     bool InsertReqToLink(HMCRequest* req, int link);
     bool InsertHMCReq(HMCRequest* req);
 
@@ -127,7 +133,7 @@ class HMCMemorySystem : public BaseDRAMSystem {
     void DrainRequests();
     void DrainResponses();
     void InsertReqToDRAM(HMCRequest* req);
-    void VaultCallback(uint64_t req_id);
+    void VaultCallback(uint64_t trans_id);
     std::vector<int> BuildAgeQueue(std::vector<int>& age_counter);
     void XbarArbitrate();
     inline void IterateNextLink();
@@ -139,8 +145,8 @@ class HMCMemorySystem : public BaseDRAMSystem {
     // number of flits xbar can process per logic cycle
     const int xbar_bandwidth_ = 2;
 
-    // had to use a multimap because the controller callback return hex addr
-    // instead of unique id
+    // keyed by transaction id, a multimap because ids default to the hex
+    // addr and need not be unique
     std::multimap<uint64_t, HMCResponse*> resp_lookup_table_;
     // these are essentially input/output buffers for xbars
     std::vector<std::vector<HMCRequest*>> link_req_queues_;
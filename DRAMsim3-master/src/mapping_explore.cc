@@ -0,0 +1,351 @@
+#include <algorithm>
+#include <atomic>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "./../ext/headers/args.hxx"
+#include "binary_trace.h"
+#include "configuration.h"
+
+// this will not be used in a library file so it's ok to do this
+using namespace dramsim3;
+
+namespace {
+
+enum Field { CH, RA, BG, BA, RO, CO, NUM_FIELDS };
+const char *kFieldNames[NUM_FIELDS] = {"ch", "ra", "bg", "ba", "ro", "co"};
+
+// the XOR_HASH interleaving of the GNN AddrMapper on top of the mapping:
+// the channel, and optionally the bank group and bank, XORed with their
+// source bits (see XorSources()) folded to their width
+enum class Hash { NONE, CHANNEL, CHANNEL_BANK };
+
+struct Candidate {
+    std::string mapping;  // as in the INI, most significant field first
+    Hash hash;
+    int pos[NUM_FIELDS];
+};
+
+struct Result {
+    double row_hit_rate;
+    double conflict_rate;    // accesses that close another open row
+    double channel_balance;  // mean over max requests per channel
+    double score;
+};
+
+std::string HashName(Hash hash) {
+    switch (hash) {
+        case Hash::CHANNEL:
+            return "XOR_HASH";
+        case Hash::CHANNEL_BANK:
+            return "XOR_HASH+bank";
+        default:
+            return "BIT_SLICE";
+    }
+}
+
+uint64_t FoldXor(uint64_t value, int width) {
+    if (width <= 0) {
+        return 0;
+    }
+    uint64_t mask = (1ull << width) - 1;
+    uint64_t result = 0;
+    while (value) {
+        result ^= value & mask;
+        value >>= width;
+    }
+    return result;
+}
+
+uint64_t GatherBits(uint64_t value, uint64_t mask) {
+    uint64_t result = 0;
+    int out = 0;
+    for (; mask; mask &= mask - 1) {
+        int bit = __builtin_ctzll(mask);
+        result |= ((value >> bit) & 1) << out++;
+    }
+    return result;
+}
+
+uint64_t FieldMask(const Candidate &cand, const int *width, Field f) {
+    return ((1ull << width[f]) - 1) << cand.pos[f];
+}
+
+// The line bits AddrMapper folds into each hashed field: the row by
+// default; after setAddressRange(), the row and column bits inside the
+// range for the channel, and those plus the channel bits for the bank
+// group and bank. |range_bits| < 0 means no range was set.
+void XorSources(const Candidate &cand, const int *width, int range_bits,
+                uint64_t *src) {
+    uint64_t row = FieldMask(cand, width, RO);
+    src[CH] = src[BG] = src[BA] = row;
+    if (range_bits < 0) {
+        return;
+    }
+    uint64_t in_range = range_bits >= 64 ? ~0ull : (1ull << range_bits) - 1;
+    uint64_t row_col = (row | FieldMask(cand, width, CO)) & in_range;
+    src[CH] = row_col;
+    src[BG] = src[BA] = (row_col | FieldMask(cand, width, CH)) & in_range;
+}
+
+// Every permutation of the six fields under every hash. Positions are
+// assigned from the least significant field up like
+// Config::SetAddressMapping() does.
+std::vector<Candidate> MakeCandidates(const int *width) {
+    std::vector<Candidate> candidates;
+    int order[NUM_FIELDS] = {CH, RA, BG, BA, RO, CO};
+    do {
+        Candidate cand;
+        int pos = 0;
+        for (int i = NUM_FIELDS - 1; i >= 0; i--) {
+            cand.pos[order[i]] = pos;
+            pos += width[order[i]];
+        }
+        for (int i = 0; i < NUM_FIELDS; i++) {
+            cand.mapping += kFieldNames[order[i]];
+        }
+        for (Hash hash : {Hash::NONE, Hash::CHANNEL, Hash::CHANNEL_BANK}) {
+            cand.hash = hash;
+            candidates.push_back(cand);
+        }
+    } while (std::next_permutation(order, order + NUM_FIELDS));
+    return candidates;
+}
+
+// Replay the |lines| (addresses without the burst offset) in order against
+// one open row per bank, without timing: an access to the open row hits,
+// any other opens its own row.
+Result Evaluate(const Candidate &cand, const std::vector<uint64_t> &lines,
+                const int *width, int range_bits, double balance_weight,
+                std::vector<int64_t> &open_rows,
+                std::vector<uint64_t> &per_channel) {
+    uint64_t mask[NUM_FIELDS];
+    for (int f = 0; f < NUM_FIELDS; f++) {
+        mask[f] = (1ull << width[f]) - 1;
+    }
+    uint64_t src[NUM_FIELDS];
+    XorSources(cand, width, range_bits, src);
+    // hashed in this order on the line hashed so far, like AddrMapper::remap
+    std::vector<Field> hashed;
+    if (cand.hash != Hash::NONE) {
+        hashed.push_back(CH);
+    }
+    if (cand.hash == Hash::CHANNEL_BANK) {
+        hashed.push_back(BG);
+        hashed.push_back(BA);
+    }
+    std::fill(open_rows.begin(), open_rows.end(), -1);
+    std::fill(per_channel.begin(), per_channel.end(), 0);
+    uint64_t hits = 0, conflicts = 0;
+    for (uint64_t line : lines) {
+        for (Field f : hashed) {
+            if (width[f] > 0) {
+                line ^= FoldXor(GatherBits(line, src[f]), width[f])
+                        << cand.pos[f];
+            }
+        }
+        uint64_t field[NUM_FIELDS];
+        for (int f = 0; f < NUM_FIELDS; f++) {
+            field[f] = (line >> cand.pos[f]) & mask[f];
+        }
+        uint64_t bank = (((field[CH] << width[RA] | field[RA]) << width[BG] |
+                          field[BG])
+                         << width[BA]) |
+                        field[BA];
+        int64_t row = static_cast<int64_t>(field[RO]);
+        if (open_rows[bank] == row) {
+            hits++;
+        } else {
+            conflicts += open_rows[bank] >= 0;
+            open_rows[bank] = row;
+        }
+        per_channel[field[CH]]++;
+    }
+
+    Result result;
+    double n = lines.empty() ? 1.0 : static_cast<double>(lines.size());
+    uint64_t busiest =
+        *std::max_element(per_channel.begin(), per_channel.end());
+    result.row_hit_rate = hits / n;
+    result.conflict_rate = conflicts / n;
+    result.channel_balance =
+        busiest == 0 ? 1.0 : n / per_channel.size() / busiest;
+    result.score =
+        result.row_hit_rate + balance_weight * result.channel_balance;
+    return result;
+}
+
+}  // namespace
+
+// Rank address mappings for a recorded trace with a row buffer model that
+// is cheap enough to try every field order, with and without the XOR
+// hashing of the GNN AddrMapper.
+int main(int argc, const char **argv) {
+    args::ArgumentParser parser(
+        "Explore address mappings over a recorded trace.",
+        "Examples: \n"
+        "./build/mappingexplore configs/HBM2_4Gb_x128.ini -t "
+        "sample_trace.txt\n"
+        "Mappings are ranked by row hit rate + weight * channel balance.");
+    args::HelpFlag help(parser, "help", "Display the help menu", {'h', "help"});
+    args::ValueFlag<std::string> trace_file_arg(
+        parser, "trace", "Trace file (text or binary, mandatory)",
+        {'t', "trace"});
+    args::ValueFlag<uint64_t> num_cycles_arg(
+        parser, "num_cycles", "Only use requests added before this cycle",
+        {'c', "cycles"}, UINT64_MAX);
+    args::ValueFlag<int> threads_arg(parser, "threads",
+                                     "Worker threads, 0 = one per core",
+                                     {'j', "threads"}, 0);
+    args::ValueFlag<int> top_arg(parser, "top", "Number of mappings to list",
+                                 {'n', "top"}, 10);
+    args::ValueFlag<double> weight_arg(parser, "weight",
+                                       "Weight of the channel balance",
+                                       {'w', "weight"}, 1.0);
+    args::ValueFlag<uint64_t> range_arg(
+        parser, "range",
+        "Bytes passed to AddrMapper::setAddressRange(), 0 = not set",
+        {'r', "range"}, 0);
+    args::Positional<std::string> config_arg(
+        parser, "config", "The config file name (mandatory)");
+
+    try {
+        parser.ParseCLI(argc, argv);
+    } catch (args::Help) {
+        std::cout << parser;
+        return 0;
+    } catch (args::ParseError e) {
+        std::cerr << e.what() << std::endl;
+        std::cerr << parser;
+        return 1;
+    }
+
+    std::string config_file = args::get(config_arg);
+    std::string trace_file = args::get(trace_file_arg);
+    if (config_file.empty() || trace_file.empty()) {
+        std::cerr << parser;
+        return 1;
+    }
+    Config config(config_file, ".");
+    if (config.IsHMC()) {
+        std::cerr << "HMC configs are not supported" << std::endl;
+        return 1;
+    }
+
+    int width[NUM_FIELDS];
+    width[CH] = LogBase2(config.channels);
+    width[RA] = LogBase2(config.ranks);
+    width[BG] = LogBase2(config.bankgroups);
+    width[BA] = LogBase2(config.banks_per_group);
+    width[RO] = LogBase2(config.rows);
+    width[CO] = LogBase2(config.columns) - LogBase2(config.BL);
+
+    // AddrMapper::setAddressRange() on the line address
+    uint64_t range = args::get(range_arg);
+    int range_bits = -1;
+    if (range > 0) {
+        range_bits = 0;
+        while (range_bits < 64 && (1ull << range_bits) < range) {
+            range_bits++;
+        }
+        range_bits = std::max(range_bits - config.shift_bits, 0);
+    }
+
+    std::vector<Transaction> trace =
+        LoadTrace(trace_file, args::get(num_cycles_arg));
+    std::vector<uint64_t> lines;
+    for (const auto &trans : trace) {
+        lines.push_back(trans.addr >> config.shift_bits);
+    }
+    if (lines.empty()) {
+        std::cerr << "no requests in " << trace_file << std::endl;
+        return 1;
+    }
+
+    std::vector<Candidate> candidates = MakeCandidates(width);
+    std::vector<Result> results(candidates.size());
+    int num_threads = args::get(threads_arg);
+    if (num_threads <= 0) {
+        num_threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    double weight = args::get(weight_arg);
+    std::atomic<size_t> next(0);
+    auto worker = [&]() {
+        int bank_bits = width[CH] + width[RA] + width[BG] + width[BA];
+        std::vector<int64_t> open_rows(1ull << bank_bits);
+        std::vector<uint64_t> per_channel(config.channels);
+        for (size_t i = next++; i < candidates.size(); i = next++) {
+            results[i] = Evaluate(candidates[i], lines, width, range_bits,
+                                  weight, open_rows, per_channel);
+        }
+    };
+    std::vector<std::thread> threads;
+    for (int i = 0; i < num_threads; i++) {
+        threads.emplace_back(worker);
+    }
+    for (auto &thread : threads) {
+        thread.join();
+    }
+
+    // best score first, fewer conflicts and then the name break ties
+    std::vector<size_t> order(candidates.size());
+    for (size_t i = 0; i < order.size(); i++) {
+        order[i] = i;
+    }
+    std::sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+        if (results[a].score != results[b].score) {
+            return results[a].score > results[b].score;
+        }
+        if (results[a].conflict_rate != results[b].conflict_rate) {
+            return results[a].conflict_rate < results[b].conflict_rate;
+        }
+        return a < b;
+    });
+
+    std::cout << lines.size() << " requests, " << candidates.size()
+              << " mappings, " << num_threads << " threads" << std::endl;
+    std::cout << std::left << std::setw(6) << "rank" << std::setw(14)
+              << "mapping" << std::setw(15) << "interleave" << std::right
+              << std::setw(9) << "row_hit" << std::setw(10) << "conflict"
+              << std::setw(12) << "ch_balance" << std::setw(9) << "score"
+              << std::endl;
+    int top = std::min<int>(args::get(top_arg), order.size());
+    auto print = [&](size_t rank, size_t i) {
+        const Result &r = results[i];
+        std::cout << std::left << std::setw(6) << rank << std::setw(14)
+                  << candidates[i].mapping << std::setw(15)
+                  << HashName(candidates[i].hash) << std::right
+                  << std::fixed << std::setprecision(4) << std::setw(9)
+                  << r.row_hit_rate << std::setw(10) << r.conflict_rate
+                  << std::setw(12) << r.channel_balance << std::setw(9)
+                  << r.score << std::endl;
+    };
+    for (int rank = 0; rank < top; rank++) {
+        print(rank + 1, order[rank]);
+    }
+    for (size_t rank = 0; rank < order.size(); rank++) {
+        const Candidate &cand = candidates[order[rank]];
+        if (cand.mapping == config.address_mapping &&
+            cand.hash == Hash::NONE) {
+            std::cout << "current:" << std::endl;
+            print(rank + 1, order[rank]);
+        }
+    }
+
+    const Candidate &best = candidates[order[0]];
+    std::cout << std::endl << "[system]" << std::endl;
+    std::cout << "address_mapping = " << best.mapping << std::endl;
+    if (best.hash != Hash::NONE) {
+        std::cout << "; GNN AddrMapper: InterleaveMode::XOR_HASH, "
+                  << "setHashBank("
+                  << (best.hash == Hash::CHANNEL_BANK ? "true" : "false")
+                  << ")";
+        if (range > 0) {
+            std::cout << ", setAddressRange(" << range << ")";
+        }
+        std::cout << std::endl;
+    }
+    return 0;
+}
@@ -5,24 +5,44 @@ MemorySystem::MemorySystem(const std::string &config_file,
                            const std::string &output_dir,
                            std::function<void(uint64_t)> read_callback,
                            std::function<void(uint64_t)> write_callback)
-    : config_(new Config(config_file, output_dir)) {
-    // TODO: ideal memory type?
+    : MemorySystem(std::make_shared<const Config>(config_file, output_dir),
+                   read_callback, write_callback) {}
+
+MemorySystem::MemorySystem(std::shared_ptr<const Config> config,
+                           std::function<void(uint64_t)> read_callback,
+                           std::function<void(uint64_t)> write_callback)
+    : config_(config) {
+    const std::string &output_dir = config_->output_dir;
     if (config_->IsHMC()) {
         dram_system_ = new HMCMemorySystem(*config_, output_dir, read_callback,
                                            write_callback);
+    } else if (config_->memory_model == MemoryModel::IDEAL) {
+        dram_system_ = new IdealDRAMSystem(*config_, output_dir, read_callback,
+                                           write_callback);
+    } else if (config_->memory_model == MemoryModel::ANALYTIC) {
+        dram_system_ = new AnalyticDRAMSystem(*config_, output_dir,
+                                              read_callback, write_callback);
     } else {
         dram_system_ = new JedecDRAMSystem(*config_, output_dir, read_callback,
                                            write_callback);
     }
 }
 
-MemorySystem::~MemorySystem() {
-    delete (dram_system_);
-    delete (config_);
-}
+MemorySystem::~MemorySystem() { delete (dram_system_); }
 
 void MemorySystem::ClockTick() { dram_system_->ClockTick(); }
 
+uint64_t MemorySystem::NextEventCycle() const {
+    return dram_system_->NextEventCycle();
+}
+
+uint64_t MemorySystem::Clk() const { return dram_system_->Clk(); }
+
+void MemorySystem::ClockTicks(uint64_t cycles,
+                              std::vector<DoneTransaction> &done) {
+    dram_system_->ClockTicks(cycles, done);
+}
+
 double MemorySystem::GetTCK() const { return config_->tCK; }
 
 int MemorySystem::GetBusBits() const { return config_->bus_width; }
@@ -37,6 +57,11 @@ void MemorySystem::RegisterCallbacks(
     dram_system_->RegisterCallbacks(read_callback, write_callback);
 }
 
+void MemorySystem::RegisterIdCallbacks(TransactionCallback read_callback,
+                                       TransactionCallback write_callback) {
+    dram_system_->RegisterIdCallbacks(read_callback, write_callback);
+}
+
 bool MemorySystem::WillAcceptTransaction(uint64_t hex_addr,
                                          bool is_write) const {
     return dram_system_->WillAcceptTransaction(hex_addr, is_write);
@@ -46,6 +71,21 @@ bool MemorySystem::AddTransaction(uint64_t hex_addr, bool is_write) {
     return dram_system_->AddTransaction(hex_addr, is_write);
 }
 
+bool MemorySystem::AddTransaction(uint64_t hex_addr, bool is_write,
+                                  uint64_t id) {
+    return dram_system_->AddTransaction(hex_addr, is_write, id);
+}
+
+bool MemorySystem::AddTransaction(uint64_t hex_addr, bool is_write,
+                                  uint64_t id, int requester) {
+    return dram_system_->AddTransaction(hex_addr, is_write, id, requester);
+}
+
+size_t MemorySystem::AddTransactions(TransactionRequest *reqs,
+                                     size_t count) {
+    return dram_system_->AddTransactions(reqs, count);
+}
+
 void MemorySystem::PrintStats() const { dram_system_->PrintStats(); }
 
 void MemorySystem::ResetStats() { dram_system_->ResetStats(); }
@@ -2,8 +2,10 @@
 #define __MEMORY_SYSTEM__H
 
 #include <functional>
+#include <memory>
 #include <string>
 
+#include "analytic_system.h"
 #include "configuration.h"
 #include "dram_system.h"
 #include "hmc.h"
@@ -16,10 +18,25 @@ class MemorySystem {
     MemorySystem(const std::string &config_file, const std::string &output_dir,
                  std::function<void(uint64_t)> read_callback,
                  std::function<void(uint64_t)> write_callback);
+    // |config| may be shared by many memory systems, see Config::Shared()
+    MemorySystem(std::shared_ptr<const Config> config,
+                 std::function<void(uint64_t)> read_callback,
+                 std::function<void(uint64_t)> write_callback);
     ~MemorySystem();
     void ClockTick();
+    // advance |cycles| clocks, reporting finished transactions in |done|
+    // instead of calling back; see BaseDRAMSystem::ClockTicks
+    void ClockTicks(uint64_t cycles, std::vector<DoneTransaction> &done);
+    // the memory clock, and the earliest cycle at which it can call back or
+    // refresh; a host can skip the ticks in between by calling ClockTicks()
+    // only when a transaction is added or this is due
+    uint64_t Clk() const;
+    uint64_t NextEventCycle() const;
     void RegisterCallbacks(std::function<void(uint64_t)> read_callback,
                            std::function<void(uint64_t)> write_callback);
+    // call back with (id, addr, channel) instead, see AddTransaction()
+    void RegisterIdCallbacks(TransactionCallback read_callback,
+                             TransactionCallback write_callback);
     double GetTCK() const;
     int GetBusBits() const;
     int GetBurstLength() const;
@@ -29,15 +46,26 @@ class MemorySystem {
 
     bool WillAcceptTransaction(uint64_t hex_addr, bool is_write) const;
     bool AddTransaction(uint64_t hex_addr, bool is_write);
+    // |id| comes back to the id callbacks, so completions can be matched
+    // exactly even when reads to the same address are merged
+    bool AddTransaction(uint64_t hex_addr, bool is_write, uint64_t id);
+    // also attribute it to |requester| in the per-requester stats
+    bool AddTransaction(uint64_t hex_addr, bool is_write, uint64_t id,
+                        int requester);
+    // bulk version, see BaseDRAMSystem::AddTransactions
+    size_t AddTransactions(TransactionRequest *reqs, size_t count);
 
     //added by YRH
     int GetChannel(uint64_t hex_addr)const;
+    // address layout, used by integrators that interleave/hash addresses
+    // before they reach the controllers
+    const Config &GetConfig() const { return *config_; }
 
    private:
     // These have to be pointers because Gem5 will try to push this object
     // into container which will invoke a copy constructor, using pointers
     // here is safe
-    Config *config_;
+    std::shared_ptr<const Config> config_;
     BaseDRAMSystem *dram_system_;
 };
 
@@ -0,0 +1,128 @@
+#include "pending_index.h"
+#include <iostream>
+
+namespace dramsim3 {
+
+PendingIndex::PendingIndex(int expected_size)
+    : free_node_(-1), mask_(0), used_slots_(0), size_(0) {
+    // keep the table at most half full for short probe sequences
+    size_t num_slots = 16;
+    while (num_slots < 2 * static_cast<size_t>(expected_size)) {
+        num_slots <<= 1;
+    }
+    slots_.assign(num_slots, Slot{0, -1, -1, 0});
+    mask_ = num_slots - 1;
+    nodes_.reserve(expected_size);
+}
+
+size_t PendingIndex::Home(uint64_t addr) const {
+    // Fibonacci hashing: transaction addresses are burst aligned, so the
+    // low bits are mostly zero and must not pick the slot on their own
+    return static_cast<size_t>((addr * 0x9E3779B97F4A7C15ull) >> 32) & mask_;
+}
+
+size_t PendingIndex::Probe(uint64_t addr) const {
+    size_t pos = Home(addr);
+    while (slots_[pos].head >= 0 && slots_[pos].addr != addr) {
+        pos = (pos + 1) & mask_;
+    }
+    return pos;
+}
+
+size_t PendingIndex::Count(uint64_t addr) const {
+    const Slot& slot = slots_[Probe(addr)];
+    return slot.head >= 0 ? slot.count : 0;
+}
+
+int PendingIndex::AllocNode(const Transaction& trans) {
+    int idx;
+    if (free_node_ >= 0) {
+        idx = free_node_;
+        free_node_ = nodes_[idx].next;
+        nodes_[idx].trans = trans;
+    } else {
+        idx = static_cast<int>(nodes_.size());
+        nodes_.push_back(Node{trans, -1});
+    }
+    nodes_[idx].next = -1;
+    return idx;
+}
+
+void PendingIndex::Insert(uint64_t addr, const Transaction& trans) {
+    size_t pos = Probe(addr);
+    int idx = AllocNode(trans);
+    Slot& slot = slots_[pos];
+    if (slot.head >= 0) {
+        nodes_[slot.tail].next = idx;
+        slot.tail = idx;
+        slot.count++;
+    } else {
+        slot.addr = addr;
+        slot.head = idx;
+        slot.tail = idx;
+        slot.count = 1;
+        used_slots_++;
+        if (2 * used_slots_ > slots_.size()) {
+            Rehash(slots_.size() * 2);
+        }
+    }
+    size_++;
+}
+
+Transaction* PendingIndex::Front(uint64_t addr) {
+    const Slot& slot = slots_[Probe(addr)];
+    return slot.head >= 0 ? &nodes_[slot.head].trans : nullptr;
+}
+
+void PendingIndex::PopFront(uint64_t addr) {
+    size_t pos = Probe(addr);
+    Slot& slot = slots_[pos];
+    if (slot.head < 0) {
+        std::cerr << addr << " not in pending index!" << std::endl;
+        AbruptExit(__FILE__, __LINE__);
+    }
+    int idx = slot.head;
+    slot.head = nodes_[idx].next;
+    slot.count--;
+    nodes_[idx].next = free_node_;
+    free_node_ = idx;
+    size_--;
+    if (slot.count == 0) {
+        EraseSlot(pos);
+    }
+}
+
+void PendingIndex::EraseSlot(size_t pos) {
+    // backward-shift deletion: pull later members of the probe run into the
+    // hole unless that would move them in front of their home slot
+    size_t hole = pos;
+    size_t next = pos;
+    while (true) {
+        next = (next + 1) & mask_;
+        if (slots_[next].head < 0) {
+            break;
+        }
+        size_t home = Home(slots_[next].addr);
+        bool home_in_range = hole <= next ? (hole < home && home <= next)
+                                          : (hole < home || home <= next);
+        if (!home_in_range) {
+            slots_[hole] = slots_[next];
+            hole = next;
+        }
+    }
+    slots_[hole].head = -1;
+    used_slots_--;
+}
+
+void PendingIndex::Rehash(size_t num_slots) {
+    std::vector<Slot> old_slots(num_slots, Slot{0, -1, -1, 0});
+    old_slots.swap(slots_);
+    mask_ = num_slots - 1;
+    for (const auto& slot : old_slots) {
+        if (slot.head >= 0) {
+            slots_[Probe(slot.addr)] = slot;
+        }
+    }
+}
+
+}  // namespace dramsim3
@@ -0,0 +1,61 @@
+#ifndef __PENDING_INDEX_H
+#define __PENDING_INDEX_H
+
+#include <stdint.h>
+#include <vector>
+#include "common.h"
+
+namespace dramsim3 {
+
+// Flat index of in-flight transactions keyed by address, a drop-in for the
+// std::multimap the controller used to keep. Keys live in an open-addressing
+// table (linear probing, backward-shift deletion so there are no
+// tombstones); transactions to the same address hang off their slot as a
+// FIFO chain of nodes drawn from a preallocated pool. Both the table and the
+// pool are sized from the transaction queue size up front, so the steady
+// state does no allocation. Duplicates come back oldest first, like
+// multimap::find().
+class PendingIndex {
+   public:
+    explicit PendingIndex(int expected_size);
+
+    bool Empty() const { return size_ == 0; }
+    size_t Size() const { return size_; }
+    size_t Count(uint64_t addr) const;
+    void Insert(const Transaction& trans) { Insert(trans.addr, trans); }
+    // file |trans| under |addr| rather than its own address
+    void Insert(uint64_t addr, const Transaction& trans);
+    // Oldest transaction to |addr|, or nullptr if there is none
+    Transaction* Front(uint64_t addr);
+    // Remove the oldest transaction to |addr|, which must exist
+    void PopFront(uint64_t addr);
+
+   private:
+    struct Slot {
+        uint64_t addr;
+        int head;  // -1 if the slot is empty
+        int tail;
+        int count;
+    };
+    struct Node {
+        Transaction trans;
+        int next;
+    };
+
+    std::vector<Slot> slots_;
+    std::vector<Node> nodes_;
+    int free_node_;
+    size_t mask_;
+    size_t used_slots_;
+    size_t size_;
+
+    size_t Home(uint64_t addr) const;
+    // Index of the slot holding |addr|, or of the empty slot ending its probe
+    size_t Probe(uint64_t addr) const;
+    int AllocNode(const Transaction& trans);
+    void Rehash(size_t num_slots);
+    void EraseSlot(size_t pos);
+};
+
+}  // namespace dramsim3
+#endif  // __PENDING_INDEX_H
@@ -1,8 +1,13 @@
 #include "refresh.h"
 
+#include <algorithm>
+
 namespace dramsim3 {
 Refresh::Refresh(const Config &config, ChannelState &channel_state)
     : clk_(0),
+      max_postponed_(config.refresh_postpone),
+      postponed_(0),
+      pulled_in_(0),
       config_(config),
       channel_state_(channel_state),
       refresh_policy_(config.refresh_policy),
@@ -16,16 +21,55 @@ Refresh::Refresh(const Config &config, ChannelState &channel_state)
     } else {  // default refresh scheme: RANK STAGGERED
         refresh_interval_ = config_.tREFI / config_.ranks;
     }
+    next_refresh_ = refresh_interval_;
 }
 
-void Refresh::ClockTick() {
-    if (clk_ % refresh_interval_ == 0 && clk_ > 0) {
-        InsertRefresh();
+void Refresh::ClockTick(bool reads_pending, bool idle) {
+    if (clk_ == next_refresh_) {
+        next_refresh_ += refresh_interval_;
+        if (pulled_in_ > 0) {
+            pulled_in_--;
+        } else if (reads_pending && postponed_ < max_postponed_) {
+            postponed_++;
+        } else {
+            InsertRefresh();
+        }
+    }
+    // one at a time, so the refreshes never pile up in front of reads
+    if (max_postponed_ > 0 && !reads_pending &&
+        !channel_state_.IsRefreshWaiting()) {
+        if (postponed_ > 0) {
+            InsertRefresh();
+            postponed_--;
+        } else if (idle && pulled_in_ < max_postponed_ &&
+                   next_refresh_ - clk_ <= PullInWindow()) {
+            InsertRefresh();
+            pulled_in_++;
+        }
     }
     clk_++;
     return;
 }
 
+uint64_t Refresh::NextRefreshCycle() const {
+    if (max_postponed_ > 0 && postponed_ > 0) {
+        return clk_;
+    }
+    if (max_postponed_ > 0 && pulled_in_ < max_postponed_) {
+        return std::max(clk_, next_refresh_ - PullInWindow());
+    }
+    return std::max(clk_, next_refresh_);
+}
+
+uint64_t Refresh::PullInWindow() const {
+    // with k pulled in, the next may go (max - k) / (max + 1) of an
+    // interval before next_refresh_: an idle controller spreads its budget
+    // over an interval instead of spending it at the start of every idle
+    // gap, and once it is spent pulls in one more as each falls due
+    return static_cast<uint64_t>(refresh_interval_) *
+           (max_postponed_ - pulled_in_) / (max_postponed_ + 1);
+}
+
 void Refresh::InsertRefresh() {
     switch (refresh_policy_) {
         // Simultaneous all rank refresh
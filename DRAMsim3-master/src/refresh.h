@@ -11,17 +11,37 @@ namespace dramsim3 {
 class Refresh {
    public:
     Refresh(const Config& config, ChannelState& channel_state);
-    void ClockTick();
+    // With refresh_postpone > 0 a refresh that falls due while
+    // |reads_pending| is postponed, and owed refreshes are caught up once
+    // the reads are gone. While the controller is |idle| refreshes are
+    // pulled in ahead of time instead, and skipped when they fall due; see
+    // PullInWindow() for how far ahead.
+    void ClockTick(bool reads_pending = false, bool idle = false);
+    // first cycle >= the current one at which ClockTick() may insert a
+    // refresh, assuming the controller stays idle
+    uint64_t NextRefreshCycle() const;
+    // skip to |clk|, the caller guarantees no refresh is due before it
+    void ClockTickUntil(uint64_t clk) { clk_ = clk; }
+    int Postponed() const { return postponed_; }
+    int PulledIn() const { return pulled_in_; }
 
    private:
     uint64_t clk_;
+    uint64_t next_refresh_;
     int refresh_interval_;
+    int max_postponed_;
+    int postponed_;  // due but not inserted yet
+    int pulled_in_;  // inserted before they were due
     const Config& config_;
     ChannelState& channel_state_;
     RefreshPolicy refresh_policy_;
 
     int next_rank_, next_bg_, next_bank_;
 
+    // cycles before next_refresh_ from which one more refresh may be
+    // pulled in, shrinking with each one already pulled in
+    uint64_t PullInWindow() const;
+
     void InsertRefresh();
 
     void IterateNext();
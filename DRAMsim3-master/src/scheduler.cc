@@ -0,0 +1,176 @@
+#include "scheduler.h"
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+namespace dramsim3 {
+
+Scheduler::Scheduler(const Config& config, SimpleStats& simple_stats)
+    : config_(config),
+      simple_stats_(simple_stats),
+      num_slots_(config.num_requesters + 1),
+      row_hit_cap_(config.scheduler == SchedulerPolicy::FRFCFS
+                       ? 4
+                       : config.row_hit_cap) {}
+
+BlissScheduler::BlissScheduler(const Config& config, SimpleStats& simple_stats)
+    : Scheduler(config, simple_stats),
+      blacklisted_(num_slots_, 0),
+      last_slot_(-1),
+      streak_(0),
+      next_clear_(config.bliss_clear_interval),
+      blacklistings_(simple_stats.GetStatId("bliss_blacklistings")) {}
+
+void BlissScheduler::Update(std::vector<CMDQueue>& queues, uint64_t clk) {
+    if (clk < next_clear_) {
+        return;
+    }
+    std::fill(blacklisted_.begin(), blacklisted_.end(), 0);
+    uint64_t interval = config_.bliss_clear_interval;
+    next_clear_ = clk - clk % interval + interval;
+}
+
+void BlissScheduler::Served(const Command& cmd, uint64_t clk) {
+    int slot = Slot(cmd);
+    if (slot == last_slot_) {
+        streak_++;
+    } else {
+        last_slot_ = slot;
+        streak_ = 1;
+    }
+    if (streak_ >= config_.bliss_threshold && !blacklisted_[slot]) {
+        blacklisted_[slot] = 1;
+        simple_stats_.Increment(blacklistings_);
+    }
+}
+
+AtlasScheduler::AtlasScheduler(const Config& config, SimpleStats& simple_stats)
+    : Scheduler(config, simple_stats),
+      service_(num_slots_, 0.0),
+      attained_(num_slots_, 0.0),
+      rank_(num_slots_, 0),
+      next_quantum_(config.atlas_quantum),
+      quanta_(simple_stats.GetStatId("atlas_quanta")),
+      starved_served_(simple_stats.GetStatId("atlas_starved_served")) {}
+
+void AtlasScheduler::Update(std::vector<CMDQueue>& queues, uint64_t clk) {
+    if (clk < next_quantum_) {
+        return;
+    }
+    // the weight of history from the ATLAS paper, quanta the queue slept
+    // through contribute no service
+    const double alpha = 0.875;
+    uint64_t quantum = config_.atlas_quantum;
+    uint64_t elapsed = (clk - next_quantum_) / quantum + 1;
+    double decay = std::pow(alpha, static_cast<double>(elapsed - 1));
+    for (int i = 0; i < num_slots_; i++) {
+        attained_[i] = (alpha * attained_[i] + (1 - alpha) * service_[i]) *
+                       decay;
+        service_[i] = 0.0;
+    }
+    next_quantum_ += elapsed * quantum;
+
+    std::vector<int> order(num_slots_);
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [this](int a, int b) {
+        return attained_[a] < attained_[b];
+    });
+    for (int i = 0; i < num_slots_; i++) {
+        rank_[order[i]] = i;
+    }
+    simple_stats_.IncrementBy(quanta_, elapsed);
+}
+
+int AtlasScheduler::Priority(const Command& cmd, uint64_t clk) const {
+    if (clk - cmd.added_cycle >=
+        static_cast<uint64_t>(config_.atlas_starvation)) {
+        return -1;
+    }
+    return rank_[Slot(cmd)];
+}
+
+void AtlasScheduler::Served(const Command& cmd, uint64_t clk) {
+    service_[Slot(cmd)] += config_.burst_cycle;
+    if (clk - cmd.added_cycle >=
+        static_cast<uint64_t>(config_.atlas_starvation)) {
+        simple_stats_.Increment(starved_served_);
+    }
+}
+
+BatchScheduler::BatchScheduler(const Config& config, SimpleStats& simple_stats)
+    : Scheduler(config, simple_stats),
+      rank_(num_slots_, 0),
+      marks_(num_slots_ * config.ranks * config.banks, 0),
+      marked_left_(0),
+      batches_(simple_stats.GetStatId("batches_formed")),
+      marked_requests_(simple_stats.GetStatId("batch_marked_requests")) {}
+
+void BatchScheduler::Update(std::vector<CMDQueue>& queues, uint64_t clk) {
+    if (marked_left_ > 0) {
+        return;
+    }
+    // queues hold their commands oldest first
+    int banks = config_.ranks * config_.banks;
+    std::fill(marks_.begin(), marks_.end(), 0);
+    for (auto& queue : queues) {
+        for (auto& cmd : queue) {
+            int bank = cmd.Rank() * config_.banks +
+                       cmd.Bankgroup() * config_.banks_per_group + cmd.Bank();
+            int& marks = marks_[Slot(cmd) * banks + bank];
+            if (marks < config_.batch_cap) {
+                cmd.marked = true;
+                marks++;
+                marked_left_++;
+            }
+        }
+    }
+    if (marked_left_ == 0) {
+        return;
+    }
+
+    // shortest job first: the fewest requests in the most loaded bank,
+    // then the fewest requests overall
+    std::vector<std::pair<int, int>> load(num_slots_, {0, 0});
+    for (int i = 0; i < num_slots_; i++) {
+        for (int b = 0; b < banks; b++) {
+            int marks = marks_[i * banks + b];
+            load[i].first = std::max(load[i].first, marks);
+            load[i].second += marks;
+        }
+    }
+    std::vector<int> order(num_slots_);
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(),
+                     [&load](int a, int b) { return load[a] < load[b]; });
+    for (int i = 0; i < num_slots_; i++) {
+        rank_[order[i]] = i;
+    }
+    simple_stats_.Increment(batches_);
+    simple_stats_.IncrementBy(marked_requests_, marked_left_);
+}
+
+void BatchScheduler::Served(const Command& cmd, uint64_t clk) {
+    if (cmd.marked) {
+        marked_left_--;
+    }
+}
+
+std::unique_ptr<Scheduler> MakeScheduler(const Config& config,
+                                         SimpleStats& simple_stats) {
+    switch (config.scheduler) {
+        case SchedulerPolicy::BLISS:
+            return std::unique_ptr<Scheduler>(
+                new BlissScheduler(config, simple_stats));
+        case SchedulerPolicy::ATLAS:
+            return std::unique_ptr<Scheduler>(
+                new AtlasScheduler(config, simple_stats));
+        case SchedulerPolicy::BATCH:
+            return std::unique_ptr<Scheduler>(
+                new BatchScheduler(config, simple_stats));
+        default:
+            return std::unique_ptr<Scheduler>(
+                new Scheduler(config, simple_stats));
+    }
+}
+
+}  // namespace dramsim3
@@ -0,0 +1,118 @@
+#ifndef __SCHEDULER_H
+#define __SCHEDULER_H
+
+#include <memory>
+#include <vector>
+#include "common.h"
+#include "configuration.h"
+#include "simple_stats.h"
+
+namespace dramsim3 {
+
+using CMDIterator = std::vector<Command>::iterator;
+using CMDQueue = std::vector<Command>;
+
+// Request prioritization of a CommandQueue, selected by the INI
+// `scheduler`. The FR-FCFS variants need no ranking: the queues are
+// visited round robin, the first ready command of a queue issues, and
+// ArbitratePrecharge() keeps a row open for pending hits up to RowHitCap()
+// of them. The other policies rank the ready commands of all the queues
+// by Priority(), then row hits first, then oldest first.
+class Scheduler {
+   public:
+    Scheduler(const Config& config, SimpleStats& simple_stats);
+    virtual ~Scheduler() {}
+    // row hits a bank serves before a pending miss may close it, 0 = no cap
+    int RowHitCap() const { return row_hit_cap_; }
+    // false leaves the FR-FCFS path of the queue untouched
+    virtual bool Ranks() const { return false; }
+    // called at |clk| before the ready commands are ranked
+    virtual void Update(std::vector<CMDQueue>& queues, uint64_t clk) {}
+    // lower is served first, |cmd| is a queued R/W command
+    virtual int Priority(const Command& cmd, uint64_t clk) const { return 0; }
+    // the queued R/W command |cmd| issued at |clk| and left the queue
+    virtual void Served(const Command& cmd, uint64_t clk) {}
+
+   protected:
+    // requesters out of range share the last slot
+    int Slot(const Command& cmd) const {
+        return cmd.requester >= 0 && cmd.requester < num_slots_ - 1
+                   ? cmd.requester
+                   : num_slots_ - 1;
+    }
+
+    const Config& config_;
+    SimpleStats& simple_stats_;
+    int num_slots_;
+    int row_hit_cap_;
+};
+
+// BLISS: a requester served bliss_threshold requests in a row is
+// blacklisted and deprioritized until the blacklist is cleared every
+// bliss_clear_interval cycles
+class BlissScheduler : public Scheduler {
+   public:
+    BlissScheduler(const Config& config, SimpleStats& simple_stats);
+    bool Ranks() const override { return true; }
+    void Update(std::vector<CMDQueue>& queues, uint64_t clk) override;
+    int Priority(const Command& cmd, uint64_t clk) const override {
+        return blacklisted_[Slot(cmd)];
+    }
+    void Served(const Command& cmd, uint64_t clk) override;
+
+   private:
+    std::vector<int> blacklisted_;
+    int last_slot_;
+    int streak_;
+    uint64_t next_clear_;
+    StatId blacklistings_;
+};
+
+// ATLAS: requesters that attained the least service, as data bus cycles
+// averaged over past quanta, are served first. Requests older than
+// atlas_starvation cycles go ahead of any ranking.
+class AtlasScheduler : public Scheduler {
+   public:
+    AtlasScheduler(const Config& config, SimpleStats& simple_stats);
+    bool Ranks() const override { return true; }
+    void Update(std::vector<CMDQueue>& queues, uint64_t clk) override;
+    int Priority(const Command& cmd, uint64_t clk) const override;
+    void Served(const Command& cmd, uint64_t clk) override;
+
+   private:
+    std::vector<double> service_;   // in the current quantum
+    std::vector<double> attained_;  // averaged over the past quanta
+    std::vector<int> rank_;
+    uint64_t next_quantum_;
+    StatId quanta_;
+    StatId starved_served_;
+};
+
+// Parallelism-aware batching: once the previous batch is served, up to
+// batch_cap of the oldest requests per requester and bank are marked and
+// served ahead of the rest, requesters with the least work in their
+// most loaded bank first. Keeps a gather stream from being starved by a
+// requester streaming through open rows.
+class BatchScheduler : public Scheduler {
+   public:
+    BatchScheduler(const Config& config, SimpleStats& simple_stats);
+    bool Ranks() const override { return true; }
+    void Update(std::vector<CMDQueue>& queues, uint64_t clk) override;
+    int Priority(const Command& cmd, uint64_t clk) const override {
+        return cmd.marked ? rank_[Slot(cmd)] : num_slots_;
+    }
+    void Served(const Command& cmd, uint64_t clk) override;
+
+   private:
+    std::vector<int> rank_;
+    std::vector<int> marks_;  // per requester and bank, scratch
+    int marked_left_;
+    StatId batches_;
+    StatId marked_requests_;
+};
+
+std::unique_ptr<Scheduler> MakeScheduler(const Config& config,
+                                         SimpleStats& simple_stats);
+
+}  // namespace dramsim3
+#endif
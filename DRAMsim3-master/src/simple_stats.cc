@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <iostream>
 
 #include "fmt/format.h"
@@ -16,6 +17,10 @@ void PrintStatText(std::ostream& where, std::string name, T value,
     return;
 }
 
+// percentiles reported for every histogram stat, as name suffix and quantile
+static const std::vector<std::pair<std::string, double> > kPercentiles = {
+    {"p50", 0.50}, {"p95", 0.95}, {"p99", 0.99}, {"p999", 0.999}};
+
 SimpleStats::SimpleStats(const Config& config, int channel_id)
     : config_(config), channel_id_(channel_id) {
     // counter stats
@@ -24,6 +29,8 @@ SimpleStats::SimpleStats(const Config& config, int channel_id)
     InitStat("num_reads_done", "counter", "Number of read requests issued");
     InitStat("num_writes_done", "counter", "Number of read requests issued");
     InitStat("num_write_buf_hits", "counter", "Number of write buffer hits");
+    InitStat("num_write_coalesced", "counter",
+             "Number of writes merged into a buffered write");
     InitStat("num_read_row_hits", "counter", "Number of read row buffer hits");
     InitStat("num_write_row_hits", "counter",
              "Number of write row buffer hits");
@@ -37,6 +44,21 @@ SimpleStats::SimpleStats(const Config& config, int channel_id)
     InitStat("num_srefe_cmds", "counter", "Number of SREFE commands");
     InitStat("num_srefx_cmds", "counter", "Number of SREFX commands");
     InitStat("hbm_dual_cmds", "counter", "Number of cycles dual cmds issued");
+    InitStat("num_row_hit_cap_pres", "counter",
+             "Number of PRE commands forced by the row hit cap");
+    // scheduler policy stats, see scheduler.h
+    if (config_.scheduler == SchedulerPolicy::BLISS) {
+        InitStat("bliss_blacklistings", "counter",
+                 "Number of requesters blacklisted");
+    } else if (config_.scheduler == SchedulerPolicy::ATLAS) {
+        InitStat("atlas_quanta", "counter", "Number of ATLAS quanta");
+        InitStat("atlas_starved_served", "counter",
+                 "Number of requests served past atlas_starvation");
+    } else if (config_.scheduler == SchedulerPolicy::BATCH) {
+        InitStat("batches_formed", "counter", "Number of batches formed");
+        InitStat("batch_marked_requests", "counter",
+                 "Number of requests marked into batches");
+    }
 
     // double stats
     InitStat("act_energy", "double", "Activation energy");
@@ -67,6 +89,35 @@ SimpleStats::SimpleStats(const Config& config, int channel_id)
     InitHistoStat("interarrival_latency",
                   "Request interarrival latency (cycles)", 0, 100, 10);
 
+    // per-requester stats, see Transaction::requester
+    int requesters = config_.num_requesters;
+    for (int i = 0; i < requesters; i++) {
+        std::string suffix = "." + std::to_string(i);
+        // 640 instead of 8192 buckets each, percentiles within ~3%
+        InitHistoStat("requester_read_latency" + suffix,
+                      "Read request latency of requester" + suffix +
+                          " (cycles)",
+                      0, 200, 10, 6);
+    }
+    if (requesters > 0) {
+        InitVecStat("requester_reads_done", "vec_counter",
+                    "Number of read requests done", "requester", requesters);
+        InitVecStat("requester_writes_done", "vec_counter",
+                    "Number of write requests done", "requester", requesters);
+        InitVecStat("requester_read_row_hits", "vec_counter",
+                    "Number of reads served by a row hit", "requester",
+                    requesters);
+        InitVecStat("requester_bandwidth", "vec_double", "Average bandwidth",
+                    "requester", requesters);
+        InitVecStat("requester_row_hit_rate", "vec_double", "Read row hit rate",
+                    "requester", requesters);
+        InitVecStat("requester_slowdown", "vec_double",
+                    "Average over unloaded read latency", "requester",
+                    requesters);
+        InitStat("unfairness", "calculated",
+                 "Max over min requester slowdown");
+    }
+
     // some irregular stats
     InitStat("average_bandwidth", "calculated", "Average bandwidth");
     InitStat("total_energy", "calculated", "Total energy (pJ)");
@@ -77,13 +128,16 @@ SimpleStats::SimpleStats(const Config& config, int channel_id)
              "Average request interarrival latency (cycles)");
 }
 
-void SimpleStats::AddValue(const std::string name, const int value) {
-    auto& epoch_counts = epoch_histo_counts_[name];
-    if (epoch_counts.count(value) <= 0) {
-        epoch_counts[value] = 1;
-    } else {
-        epoch_counts[value] += 1;
+StatId SimpleStats::GetStatId(const std::string& name) const {
+    for (const auto ids : {&counter_ids_, &vec_counter_ids_, &histo_ids_}) {
+        auto it = ids->find(name);
+        if (it != ids->end()) {
+            return it->second;
+        }
     }
+    std::cerr << "Unknown stat " << name << std::endl;
+    AbruptExit(__FILE__, __LINE__);
+    return -1;
 }
 
 std::string SimpleStats::GetTextHeader(bool is_final) const {
@@ -92,7 +146,8 @@ std::string SimpleStats::GetTextHeader(bool is_final) const {
         "Channel " +
         std::to_string(channel_id_);
     if (!is_final) {
-        header += " of epoch " + std::to_string(counters_.at("epoch_num"));
+        header += " of epoch " +
+                  std::to_string(counters_[counter_ids_.at("epoch_num")]);
     }
     header += "\n###########################################\n";
     return header;
@@ -104,11 +159,15 @@ double SimpleStats::RankBackgroundEnergy(const int rank) const{
            vec_doubles_.at("sref_energy")[rank];
 }
 
-void SimpleStats::PrintEpochStats() {
+void SimpleStats::PrintEpochStats(EpochWriter* writer) {
     UpdateEpochStats();
     if (config_.output_level >= 1) {
-        std::ofstream j_out(config_.json_epoch_name, std::ofstream::app);
-        j_out << j_data_;
+        if (writer) {
+            writer->Write(j_data_);
+        } else {
+            std::ofstream j_out(config_.json_epoch_name, std::ofstream::app);
+            j_out << j_data_;
+        }
     }
     if (config_.output_level >= 2) {
         std::cout << GetTextHeader(false);
@@ -144,17 +203,13 @@ void SimpleStats::PrintFinalStats() {
 }
 
 void SimpleStats::Reset() {
-    for (auto& it : counters_) {
-        it.second = 0;
-    }
-    for (auto& it : epoch_counters_) {
-        it.second = 0;
-    }
+    std::fill(counters_.begin(), counters_.end(), 0);
+    std::fill(epoch_counters_.begin(), epoch_counters_.end(), 0);
     for (auto& vec : vec_counters_) {
-        std::fill(vec.second.begin(), vec.second.end(), 0);
+        std::fill(vec.begin(), vec.end(), 0);
     }
     for (auto& vec : epoch_vec_counters_) {
-        std::fill(vec.second.begin(), vec.second.end(), 0);
+        std::fill(vec.begin(), vec.end(), 0);
     }
     for (auto& it : doubles_) {
         it.second = 0.0;
@@ -166,10 +221,10 @@ void SimpleStats::Reset() {
         it.second = 0.0;
     }
     for (auto& it : histo_counts_) {
-        it.second.clear();
+        it.Clear();
     }
     for (auto& it : epoch_histo_counts_) {
-        it.second.clear();
+        it.Clear();
     }
 }
 
@@ -177,8 +232,9 @@ void SimpleStats::InitStat(std::string name, std::string stat_type,
                            std::string description) {
     header_descs_.emplace(name, description);
     if (stat_type == "counter") {
-        counters_.emplace(name, 0);
-        epoch_counters_.emplace(name, 0);
+        counter_ids_.emplace(name, static_cast<StatId>(counters_.size()));
+        counters_.push_back(0);
+        epoch_counters_.push_back(0);
     } else if (stat_type == "double") {
         doubles_.emplace(name, 0.0);
     } else if (stat_type == "calculated") {
@@ -196,20 +252,24 @@ void SimpleStats::InitVecStat(std::string name, std::string stat_type,
         header_descs_.emplace(actual_name, actual_desc);
     }
     if (stat_type == "vec_counter") {
-        vec_counters_.emplace(name, std::vector<uint64_t>(vec_len, 0));
-        epoch_vec_counters_.emplace(name, std::vector<uint64_t>(vec_len, 0));
+        vec_counter_ids_.emplace(name,
+                                 static_cast<StatId>(vec_counters_.size()));
+        vec_counters_.emplace_back(vec_len, 0);
+        epoch_vec_counters_.emplace_back(vec_len, 0);
     } else if (stat_type == "vec_double") {
         vec_doubles_.emplace(name, std::vector<double>(vec_len, 0));
     }
 }
 
 void SimpleStats::InitHistoStat(std::string name, std::string description,
-                                int start_val, int end_val, int num_bins) {
+                                int start_val, int end_val, int num_bins,
+                                int sub_bucket_bits) {
     int bin_width = (end_val - start_val) / num_bins;
-    bin_widths_.emplace(name, bin_width);
-    histo_bounds_.emplace(name, std::make_pair(start_val, end_val));
-    histo_counts_.emplace(name, std::unordered_map<int, uint64_t>());
-    epoch_histo_counts_.emplace(name, std::unordered_map<int, uint64_t>());
+    histo_ids_.emplace(name, static_cast<StatId>(histo_bounds_.size()));
+    bin_widths_.push_back(bin_width);
+    histo_bounds_.push_back(std::make_pair(start_val, end_val));
+    histo_counts_.emplace_back(sub_bucket_bits);
+    epoch_histo_counts_.emplace_back(sub_bucket_bits);
 
     // initialize headers, descriptions
     std::vector<std::string> headers;
@@ -227,103 +287,104 @@ void SimpleStats::InitHistoStat(std::string name, std::string description,
     headers.push_back(header);
     header_descs_.emplace(header, description);
 
-    histo_headers_.emplace(name, headers);
+    histo_headers_.push_back(headers);
+
+    for (const auto& pct : kPercentiles) {
+        header_descs_.emplace(name + "_" + pct.first,
+                              description + " " + pct.first);
+    }
 
     // +2 for front and end
-    histo_bins_.emplace(name, std::vector<uint64_t>(num_bins + 2, 0));
-    epoch_histo_bins_.emplace(name, std::vector<uint64_t>(num_bins + 2, 0));
+    histo_bins_.emplace_back(num_bins + 2, 0);
+    epoch_histo_bins_.emplace_back(num_bins + 2, 0);
 }
 
 void SimpleStats::UpdateCounters() {
-    for (const auto& it : epoch_counters_) {
-        counters_[it.first] += it.second;
+    for (size_t id = 0; id < counters_.size(); id++) {
+        counters_[id] += epoch_counters_[id];
     }
-    for (const auto& vec : epoch_vec_counters_) {
-        for (size_t i = 0; i < vec.second.size(); i++) {
-            vec_counters_[vec.first][i] += vec.second[i];
+    for (size_t id = 0; id < vec_counters_.size(); id++) {
+        for (size_t i = 0; i < vec_counters_[id].size(); i++) {
+            vec_counters_[id][i] += epoch_vec_counters_[id][i];
         }
     }
 }
 
 void SimpleStats::UpdateHistoBins() {
-    for (auto& name_bins : epoch_histo_bins_) {
-        const auto& name = name_bins.first;
-        auto& bins = name_bins.second;
+    for (size_t id = 0; id < epoch_histo_bins_.size(); id++) {
+        auto& bins = epoch_histo_bins_[id];
+        const auto& bounds = histo_bounds_[id];
         std::fill(bins.begin(), bins.end(), 0);
-        for (const auto it : epoch_histo_counts_[name]) {
-            int value = it.first;
-            uint64_t count = it.second;
-            int bin_idx = 0;
-            if (value < histo_bounds_[name].first) {
-                bin_idx = 0;
-            } else if (value > histo_bounds_[name].second) {
-                bin_idx = bins.size() - 1;
-            } else {
-                bin_idx =
-                    (value - histo_bounds_[name].first) / bin_widths_[name] + 1;
-            }
-            bins[bin_idx] += count;
-        }
+        // each bucket goes to the bin of its lowest value: exact below
+        // 2^sub_bucket_bits where a bucket holds one value, above that a
+        // sample may land in a lower bin when its bucket, up to
+        // 2^-(sub_bucket_bits-1) of the value wide, straddles a bin edge
+        // (from 64 cycles on for the per-requester histograms)
+        int bin_width = bin_widths_[id];
+        epoch_histo_counts_[id].ForEachBucket(
+            [&bins, &bounds, bin_width](uint64_t low, uint64_t count) {
+                int value = static_cast<int>(low);
+                int bin_idx = 0;
+                if (value < bounds.first) {
+                    bin_idx = 0;
+                } else if (value > bounds.second) {
+                    bin_idx = bins.size() - 1;
+                } else {
+                    bin_idx = (value - bounds.first) / bin_width + 1;
+                }
+                bins[bin_idx] += count;
+            });
     }
 
     // update overall histogram counts based on epoch histo counts
-    for (auto& name_counts : epoch_histo_counts_) {
-        const auto& name = name_counts.first;
-        auto& epoch_counts = name_counts.second;
-        auto& final_counts = histo_counts_[name];
-        for (const auto& val_cnt : epoch_counts) {
-            if (final_counts.count(val_cnt.first) <= 0) {
-                final_counts[val_cnt.first] = val_cnt.second;
-            } else {
-                final_counts[val_cnt.first] += val_cnt.second;
-            }
-        }
-        auto& final_bins = histo_bins_[name];
+    for (size_t id = 0; id < epoch_histo_counts_.size(); id++) {
+        histo_counts_[id].Merge(epoch_histo_counts_[id]);
+        auto& final_bins = histo_bins_[id];
         for (size_t i = 0; i < final_bins.size(); i++) {
-            final_bins[i] += epoch_histo_bins_[name][i];
+            final_bins[i] += epoch_histo_bins_[id][i];
         }
     }
 }
 
-double SimpleStats::GetHistoAvg(const HistoCount& hist_counts) const {
-    uint64_t accu_sum = 0;
-    uint64_t count = 0;
-    for (auto i = hist_counts.begin(); i != hist_counts.end(); i++) {
-        accu_sum += i->first * i->second;
-        count += i->second;
-    }
-    return count == 0
-               ? 0.0
-               : static_cast<double>(accu_sum) / static_cast<double>(count);
-}
-
 void SimpleStats::UpdatePrints(bool epoch) {
     j_data_["channel"] = channel_id_;
 
-    std::unordered_map<std::string, uint64_t>& ref_counters =
+    const std::vector<uint64_t>& ref_counters =
         epoch ? epoch_counters_ : counters_;
-    for (const auto& it : ref_counters) {
-        print_pairs_.emplace_back(it.first, std::to_string(it.second));
-        j_data_[it.first] = it.second;
+    for (const auto& it : counter_ids_) {
+        uint64_t value = ref_counters[it.second];
+        print_pairs_.emplace_back(it.first, std::to_string(value));
+        j_data_[it.first] = value;
     }
-    j_data_["epoch_num"] = counters_["epoch_num"];
+    j_data_["epoch_num"] = counters_[counter_ids_.at("epoch_num")];
 
-    VecStat& ref_vcounter = epoch ? epoch_vec_counters_ : vec_counters_;
-    for (const auto& it : ref_vcounter) {
+    const VecStat& ref_vcounter = epoch ? epoch_vec_counters_ : vec_counters_;
+    for (const auto& it : vec_counter_ids_) {
+        const auto& values = ref_vcounter[it.second];
         Json j_list;
-        for (size_t i = 0; i < it.second.size(); i++) {
+        for (size_t i = 0; i < values.size(); i++) {
             std::string name = it.first + "." + std::to_string(i);
-            print_pairs_.emplace_back(name, std::to_string(it.second[i]));
-            j_list[std::to_string(i)] = it.second[i];
+            print_pairs_.emplace_back(name, std::to_string(values[i]));
+            j_list[std::to_string(i)] = values[i];
         }
         j_data_[it.first] = j_list;
     }
-    VecStat& ref_hbins = epoch ? epoch_histo_bins_ : histo_bins_;
-    for (const auto& it : ref_hbins) {
-        const auto& names = histo_headers_[it.first];
-        for (size_t i = 0; i < it.second.size(); i++) {
-            print_pairs_.emplace_back(names[i], std::to_string(it.second[i]));
-            j_data_[names[i]] = it.second[i];
+    const VecStat& ref_hbins = epoch ? epoch_histo_bins_ : histo_bins_;
+    for (const auto& it : histo_ids_) {
+        const auto& bins = ref_hbins[it.second];
+        const auto& names = histo_headers_[it.second];
+        for (size_t i = 0; i < bins.size(); i++) {
+            print_pairs_.emplace_back(names[i], std::to_string(bins[i]));
+            j_data_[names[i]] = bins[i];
+        }
+    }
+    const auto& ref_histos = epoch ? epoch_histo_counts_ : histo_counts_;
+    for (const auto& it : histo_ids_) {
+        for (const auto& pct : kPercentiles) {
+            std::string name = it.first + "_" + pct.first;
+            uint64_t value = ref_histos[it.second].ValueAtQuantile(pct.second);
+            print_pairs_.emplace_back(name, std::to_string(value));
+            j_data_[name] = value;
         }
     }
 
@@ -331,12 +392,13 @@ void SimpleStats::UpdatePrints(bool epoch) {
     // huge therefore we only put aggregated histo in each epoch but
     // complete data at the end
     if (!epoch) {
-        for (const auto& name_hist : histo_counts_) {
+        for (const auto& it : histo_ids_) {
             Json j_list;
-            for (const auto& it : name_hist.second) {
-                j_list[std::to_string(it.first)] = it.second;
-            }
-            j_data_[name_hist.first] = j_list;
+            histo_counts_[it.second].ForEachBucket(
+                [&j_list](uint64_t low, uint64_t count) {
+                    j_list[std::to_string(low)] = count;
+                });
+            j_data_[it.first] = j_list;
         }
     }
 
@@ -363,28 +425,32 @@ void SimpleStats::UpdatePrints(bool epoch) {
 void SimpleStats::UpdateEpochStats() {
     // push counter values as is
     UpdateCounters();
+    auto counter = [this](const char* name) {
+        return epoch_counters_[GetStatId(name)];
+    };
+    auto vec_counter = [this](const char* name, int i) {
+        return epoch_vec_counters_[GetStatId(name)][i];
+    };
 
     // update computed stats
-    doubles_["act_energy"] =
-        epoch_counters_["num_act_cmds"] * config_.act_energy_inc;
+    doubles_["act_energy"] = counter("num_act_cmds") * config_.act_energy_inc;
     doubles_["read_energy"] =
-        epoch_counters_["num_read_cmds"] * config_.read_energy_inc;
+        counter("num_read_cmds") * config_.read_energy_inc;
     doubles_["write_energy"] =
-        epoch_counters_["num_write_cmds"] * config_.write_energy_inc;
-    doubles_["ref_energy"] =
-        epoch_counters_["num_ref_cmds"] * config_.ref_energy_inc;
+        counter("num_write_cmds") * config_.write_energy_inc;
+    doubles_["ref_energy"] = counter("num_ref_cmds") * config_.ref_energy_inc;
     doubles_["refb_energy"] =
-        epoch_counters_["num_refb_cmds"] * config_.refb_energy_inc;
+        counter("num_refb_cmds") * config_.refb_energy_inc;
 
     // vector doubles, update first, then push
     double background_energy = 0.0;
     for (int i = 0; i < config_.ranks; i++) {
-        double act_stb = epoch_vec_counters_["rank_active_cycles"][i] *
-                         config_.act_stb_energy_inc;
-        double pre_stb = epoch_vec_counters_["all_bank_idle_cycles"][i] *
+        double act_stb =
+            vec_counter("rank_active_cycles", i) * config_.act_stb_energy_inc;
+        double pre_stb = vec_counter("all_bank_idle_cycles", i) *
                          config_.pre_stb_energy_inc;
         double sref_energy =
-            epoch_vec_counters_["sref_cycles"][i] * config_.sref_energy_inc;
+            vec_counter("sref_cycles", i) * config_.sref_energy_inc;
         vec_doubles_["act_stb_energy"][i] = act_stb;
         vec_doubles_["pre_stb_energy"][i] = pre_stb;
         vec_doubles_["sref_energy"][i] = sref_energy;
@@ -395,8 +461,8 @@ void SimpleStats::UpdateEpochStats() {
 
     // calculated stats
     uint64_t total_reqs =
-        epoch_counters_["num_reads_done"] + epoch_counters_["num_writes_done"];
-    double total_time = epoch_counters_["num_cycles"] * config_.tCK;
+        counter("num_reads_done") + counter("num_writes_done");
+    double total_time = counter("num_cycles") * config_.tCK;
     double avg_bw = total_reqs * config_.request_size_bytes / total_time;
     calculated_["average_bandwidth"] = avg_bw;
 
@@ -404,47 +470,52 @@ void SimpleStats::UpdateEpochStats() {
                           doubles_["write_energy"] + doubles_["ref_energy"] +
                           doubles_["refb_energy"] + background_energy;
     calculated_["total_energy"] = total_energy;
-    calculated_["average_power"] = total_energy / epoch_counters_["num_cycles"];
+    calculated_["average_power"] = total_energy / counter("num_cycles");
     calculated_["average_read_latency"] =
-        GetHistoAvg(epoch_histo_counts_.at("read_latency"));
+        epoch_histo_counts_[GetStatId("read_latency")].Mean();
     calculated_["average_interarrival"] =
-        GetHistoAvg(epoch_histo_counts_.at("interarrival_latency"));
+        epoch_histo_counts_[GetStatId("interarrival_latency")].Mean();
+    UpdateRequesterStats(true);
 
     UpdatePrints(true);
-    for (auto& it : epoch_counters_) {
-        it.second = 0;
-    }
+    std::fill(epoch_counters_.begin(), epoch_counters_.end(), 0);
     for (auto& vec : epoch_vec_counters_) {
-        std::fill(vec.second.begin(), vec.second.end(), 0);
+        std::fill(vec.begin(), vec.end(), 0);
     }
     for (auto& it : epoch_histo_counts_) {
-        it.second.clear();
+        it.Clear();
     }
     return;
 }
 
 void SimpleStats::UpdateFinalStats() {
     UpdateCounters();
+    auto counter = [this](const char* name) {
+        return counters_[GetStatId(name)];
+    };
+    auto vec_counter = [this](const char* name, int i) {
+        return vec_counters_[GetStatId(name)][i];
+    };
 
     // update computed stats
-    doubles_["act_energy"] = counters_["num_act_cmds"] * config_.act_energy_inc;
+    doubles_["act_energy"] = counter("num_act_cmds") * config_.act_energy_inc;
     doubles_["read_energy"] =
-        counters_["num_read_cmds"] * config_.read_energy_inc;
+        counter("num_read_cmds") * config_.read_energy_inc;
     doubles_["write_energy"] =
-        counters_["num_write_cmds"] * config_.write_energy_inc;
-    doubles_["ref_energy"] = counters_["num_ref_cmds"] * config_.ref_energy_inc;
+        counter("num_write_cmds") * config_.write_energy_inc;
+    doubles_["ref_energy"] = counter("num_ref_cmds") * config_.ref_energy_inc;
     doubles_["refb_energy"] =
-        counters_["num_refb_cmds"] * config_.refb_energy_inc;
+        counter("num_refb_cmds") * config_.refb_energy_inc;
 
     // vector doubles, update first, then push
     double background_energy = 0.0;
     for (int i = 0; i < config_.ranks; i++) {
         double act_stb =
-            vec_counters_["rank_active_cycles"][i] * config_.act_stb_energy_inc;
-        double pre_stb = vec_counters_["all_bank_idle_cycles"][i] *
+            vec_counter("rank_active_cycles", i) * config_.act_stb_energy_inc;
+        double pre_stb = vec_counter("all_bank_idle_cycles", i) *
                          config_.pre_stb_energy_inc;
         double sref_energy =
-            vec_counters_["sref_cycles"][i] * config_.sref_energy_inc;
+            vec_counter("sref_cycles", i) * config_.sref_energy_inc;
         vec_doubles_["act_stb_energy"][i] = act_stb;
         vec_doubles_["pre_stb_energy"][i] = pre_stb;
         vec_doubles_["sref_energy"][i] = sref_energy;
@@ -456,8 +527,8 @@ void SimpleStats::UpdateFinalStats() {
 
     // calculated stats
     uint64_t total_reqs =
-        counters_["num_reads_done"] + counters_["num_writes_done"];
-    double total_time = counters_["num_cycles"] * config_.tCK;
+        counter("num_reads_done") + counter("num_writes_done");
+    double total_time = counter("num_cycles") * config_.tCK;
     double avg_bw = total_reqs * config_.request_size_bytes / total_time;
     calculated_["average_bandwidth"] = avg_bw;
 
@@ -465,15 +536,57 @@ void SimpleStats::UpdateFinalStats() {
                           doubles_["write_energy"] + doubles_["ref_energy"] +
                           doubles_["refb_energy"] + background_energy;
     calculated_["total_energy"] = total_energy;
-    calculated_["average_power"] = total_energy / counters_["num_cycles"];
-    // calculated_["average_read_latency"] = GetHistoAvg("read_latency");
+    calculated_["average_power"] = total_energy / counter("num_cycles");
     calculated_["average_read_latency"] =
-        GetHistoAvg(histo_counts_.at("read_latency"));
+        histo_counts_[GetStatId("read_latency")].Mean();
     calculated_["average_interarrival"] =
-        GetHistoAvg(histo_counts_.at("interarrival_latency"));
+        histo_counts_[GetStatId("interarrival_latency")].Mean();
+    UpdateRequesterStats(false);
 
     UpdatePrints(false);
     return;
 }
 
+void SimpleStats::UpdateRequesterStats(bool epoch) {
+    if (config_.num_requesters == 0) {
+        return;
+    }
+    const VecStat& ref_vcounter = epoch ? epoch_vec_counters_ : vec_counters_;
+    const auto& ref_counters = epoch ? epoch_counters_ : counters_;
+    const auto& ref_histos = epoch ? epoch_histo_counts_ : histo_counts_;
+    const auto& reads = ref_vcounter[GetStatId("requester_reads_done")];
+    const auto& writes = ref_vcounter[GetStatId("requester_writes_done")];
+    const auto& hits = ref_vcounter[GetStatId("requester_read_row_hits")];
+    auto& bandwidth = vec_doubles_["requester_bandwidth"];
+    auto& hit_rate = vec_doubles_["requester_row_hit_rate"];
+    auto& slowdown = vec_doubles_["requester_slowdown"];
+
+    double total_time = ref_counters[GetStatId("num_cycles")] * config_.tCK;
+    // slowdown is relative to a read that opens a row on an idle channel
+    int act_to_read = config_.IsGDDR() || config_.IsHBM()
+                          ? config_.tRCDRD
+                          : config_.tRCD - config_.AL;
+    double unloaded = act_to_read + config_.read_delay;
+    double min_slowdown = 0.0, max_slowdown = 0.0;
+    for (int i = 0; i < config_.num_requesters; i++) {
+        uint64_t reqs = reads[i] + writes[i];
+        bandwidth[i] = reqs * config_.request_size_bytes / total_time;
+        if (reads[i] == 0) {
+            hit_rate[i] = 0.0;
+            slowdown[i] = 0.0;
+            continue;
+        }
+        hit_rate[i] = static_cast<double>(hits[i]) / reads[i];
+        StatId latency =
+            GetStatId("requester_read_latency." + std::to_string(i));
+        slowdown[i] = ref_histos[latency].Mean() / unloaded;
+        if (min_slowdown == 0.0 || slowdown[i] < min_slowdown) {
+            min_slowdown = slowdown[i];
+        }
+        max_slowdown = std::max(max_slowdown, slowdown[i]);
+    }
+    calculated_["unfairness"] =
+        min_slowdown > 0.0 ? max_slowdown / min_slowdown : 0.0;
+}
+
 }  // namespace dramsim3
\ No newline at end of file
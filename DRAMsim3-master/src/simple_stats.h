@@ -7,34 +7,48 @@
 #include <vector>
 
 #include "configuration.h"
+#include "epoch_writer.h"
+#include "histogram.h"
 #include "json.hpp"
 
 namespace dramsim3 {
 
+// Handle to a counter, vec counter or histogram stat, see GetStatId()
+using StatId = int;
+
 class SimpleStats {
    public:
     SimpleStats(const Config& config, int channel_id);
+
+    // look up the handle of a registered stat once, then update through it;
+    // names are only used for registration and printing
+    StatId GetStatId(const std::string& name) const;
+
     // incrementing counter
-    void Increment(const std::string name) { epoch_counters_[name] += 1; }
+    void Increment(StatId id) { epoch_counters_[id] += 1; }
+
+    // increment counter by number
+    void IncrementBy(StatId id, uint64_t num) { epoch_counters_[id] += num; }
 
     // incrementing for vec counter
-    void IncrementVec(const std::string name, int pos) {
-        epoch_vec_counters_[name][pos] += 1;
-    }
+    void IncrementVec(StatId id, int pos) { epoch_vec_counters_[id][pos] += 1; }
 
     // increment vec counter by number
-    void IncrementVecBy(const std::string name, int pos, int num) {
-        epoch_vec_counters_[name][pos] += num;
+    void IncrementVecBy(StatId id, int pos, uint64_t num) {
+        epoch_vec_counters_[id][pos] += num;
     }
 
-    // add historgram value
-    void AddValue(const std::string name, const int value);
+    // add historgram value, negative values are counted as 0
+    void AddValue(StatId id, const int value) {
+        epoch_histo_counts_[id].Record(value < 0 ? 0 : value);
+    }
 
     // return per rank background energy
     double RankBackgroundEnergy(const int r) const;
 
-    // Epoch update
-    void PrintEpochStats();
+    // Epoch update, the record goes to |writer| if given, otherwise it is
+    // appended to json_epoch_name as is
+    void PrintEpochStats(EpochWriter* writer = nullptr);
 
     // Final statas output
     void PrintFinalStats();
@@ -43,24 +57,26 @@ class SimpleStats {
     void Reset();
 
    private:
-    using VecStat = std::unordered_map<std::string, std::vector<uint64_t> >;
-    using HistoCount = std::unordered_map<int, uint64_t>;
+    using VecStat = std::vector<std::vector<uint64_t> >;
+    using StatIds = std::unordered_map<std::string, StatId>;
     using Json = nlohmann::json;
     void InitStat(std::string name, std::string stat_type,
                   std::string description);
     void InitVecStat(std::string name, std::string stat_type,
                      std::string description, std::string part_name,
                      int vec_len);
+    // |sub_bucket_bits| sets the percentile precision, see LogLinearHistogram
     void InitHistoStat(std::string name, std::string description, int start_val,
-                       int end_val, int num_bins);
+                       int end_val, int num_bins, int sub_bucket_bits = 10);
 
     void UpdateCounters();
     void UpdateHistoBins();
     void UpdatePrints(bool epoch);
-    double GetHistoAvg(const HistoCount& histo_counts) const;
     std::string GetTextHeader(bool is_final) const;
     void UpdateEpochStats();
     void UpdateFinalStats();
+    // derive the per-requester bandwidth, row hit rate and slowdown
+    void UpdateRequesterStats(bool epoch);
 
     const Config& config_;
     int channel_id_;
@@ -68,11 +84,16 @@ class SimpleStats {
     // map names to descriptions
     std::unordered_map<std::string, std::string> header_descs_;
 
-    // counter stats, indexed by their name
-    std::unordered_map<std::string, uint64_t> counters_;
-    std::unordered_map<std::string, uint64_t> epoch_counters_;
+    // name -> handle of each kind of stat, iterated in this order for output
+    StatIds counter_ids_;
+    StatIds vec_counter_ids_;
+    StatIds histo_ids_;
+
+    // counter stats, indexed by their handle
+    std::vector<uint64_t> counters_;
+    std::vector<uint64_t> epoch_counters_;
 
-    // vectored counter stats, first indexed by name then by index
+    // vectored counter stats, first indexed by handle then by index
     VecStat vec_counters_;
     VecStat epoch_vec_counters_;
 
@@ -86,13 +107,13 @@ class SimpleStats {
     // calculated stats, similar to double, but not the same
     std::unordered_map<std::string, double> calculated_;
 
-    // histogram stats
-    std::unordered_map<std::string, std::vector<std::string> > histo_headers_;
+    // histogram stats, indexed by handle
+    std::vector<std::vector<std::string> > histo_headers_;
 
-    std::unordered_map<std::string, std::pair<int, int> > histo_bounds_;
-    std::unordered_map<std::string, int> bin_widths_;
-    std::unordered_map<std::string, HistoCount> histo_counts_;
-    std::unordered_map<std::string, HistoCount> epoch_histo_counts_;
+    std::vector<std::pair<int, int> > histo_bounds_;
+    std::vector<int> bin_widths_;
+    std::vector<LogLinearHistogram> histo_counts_;
+    std::vector<LogLinearHistogram> epoch_histo_counts_;
     VecStat histo_bins_;
     VecStat epoch_histo_bins_;
 
@@ -1,22 +1,5 @@
 #include "thermal.h"
-
-extern "C" double *steady_thermal_solver(double ***powerM, double W, double Lc,
-                                         int numP, int dimX, int dimZ,
-                                         double **Midx, int count,
-                                         double Tamb_);
-extern "C" double *transient_thermal_solver(double ***powerM, double W,
-                                            double L, int numP, int dimX,
-                                            int dimZ, double **Midx,
-                                            int MidxSize, double *Cap,
-                                            int CapSize, double time, int iter,
-                                            double *T_trans, double Tamb_);
-extern "C" double **calculate_Midx_array(double W, double Lc, int numP,
-                                         int dimX, int dimZ, int *MidxSize,
-                                         double Tamb_);
-extern "C" double *calculate_Cap_array(double W, double Lc, int numP, int dimX,
-                                       int dimZ, int *CapSize);
-extern "C" double *initialize_Temperature(double W, double Lc, int numP,
-                                          int dimX, int dimZ, double Tamb_);
+#include "thermal_solver.h"
 
 namespace dramsim3 {
 
@@ -25,6 +8,8 @@ std::function<Address(const Address &addr)> GetPhyAddress;
 ThermalCalculator::ThermalCalculator(const Config &config)
     : config_(config),
       time_iter0(10),
+      trans_kernel_(nullptr),
+      steady_factor_(nullptr),
       sample_id(0),
       background_energy_(config_.channels,
                          std::vector<double>(config_.ranks, 0)),
@@ -91,11 +76,12 @@ ThermalCalculator::ThermalCalculator(const Config &config)
     cur_Pmap = std::vector<std::vector<double>>(
         num_case, std::vector<double>(numP * dimX * dimY, 0));
     T_size = (numP * 3 + 1) * (dimX + num_dummy) * (dimY + num_dummy);
-    T_trans = new double *[num_case];
-    T_final = new double *[num_case];
-    for (int i = 0; i < num_case; i++) {
-        T_trans[i] = new double[T_size];
-    }
+    T_trans = std::vector<std::vector<double>>(num_case,
+                                               std::vector<double>(T_size));
+    T_final = std::vector<std::vector<double>>(num_case,
+                                               std::vector<double>(T_size));
+    power_grid_ = std::vector<double>(
+        numP * (dimX + num_dummy) * (dimY + num_dummy), 0.0);
 
     InitialParameters();
 
@@ -127,7 +113,14 @@ ThermalCalculator::ThermalCalculator(const Config &config)
     }
 }
 
-ThermalCalculator::~ThermalCalculator() {}
+ThermalCalculator::~ThermalCalculator() {
+    free_transient_kernel(trans_kernel_);
+    if (steady_factor_) {
+        free_steady_factor(steady_factor_);
+    }
+    free_Midx_array(Midx, MidxSize);
+    free(Cap);
+}
 
 void ThermalCalculator::SetPhyAddressMapping() {
     std::string mapping_string = config_.loc_mapping;
@@ -538,7 +531,7 @@ void ThermalCalculator::UpdateEpoch(uint64_t clk) {
                 int case_id = i * config_.ranks + j;
                 double bg_energy =
                     background_energy_[i][j] / (dimX * dimY * numP);
-                for (int k = 0; k < dimX * dimY * numP; i++) {
+                for (int k = 0; k < dimX * dimY * numP; k++) {
                     cur_Pmap[case_id][k] += bg_energy / 1000 / num_devices;
                 }
             }
@@ -598,8 +591,8 @@ void ThermalCalculator::PrintFinalPT(uint64_t clk) {
                 int case_id = i * config_.ranks + j;
                 double bg_energy =
                     background_energy_[i][j] / (dimX * dimY * numP);
-                for (int k = 0; k < dimX * dimY * numP; i++) {
-                    accu_Pmap[case_id][i] += bg_energy / 1000 / num_devices;
+                for (int k = 0; k < dimX * dimY * numP; k++) {
+                    accu_Pmap[case_id][k] += bg_energy / 1000 / num_devices;
                 }
             }
         }
@@ -623,64 +616,53 @@ void ThermalCalculator::PrintFinalPT(uint64_t clk) {
 }
 
 void ThermalCalculator::CalcTransT(int case_id) {
-    double time = config_.epoch_period * config_.tCK * 1e-9;
-    double ***powerM = InitPowerM(case_id, 0);
-    double totP = GetTotalPower(powerM);
+    FillPowerGrid(case_id, 0);
+    double totP = GetTotalPower();
     std::cout << "total trans power is " << totP * 1000 << " [mW]" << std::endl;
-    T_trans[case_id] = transient_thermal_solver(
-        powerM, config_.chip_dim_x, config_.chip_dim_y, numP, dimX + num_dummy,
-        dimY + num_dummy, Midx, MidxSize, Cap, CapSize, time, time_iter,
-        T_trans[case_id], Tamb);
+    transient_thermal_solver(trans_kernel_, power_grid_.data(),
+                             config_.chip_dim_x, config_.chip_dim_y, numP,
+                             dimX + num_dummy, dimY + num_dummy, time_iter,
+                             T_trans[case_id].data(), Tamb);
 }
 
 void ThermalCalculator::CalcFinalT(int case_id, uint64_t clk) {
-    double ***powerM = InitPowerM(case_id, clk);
-    double totP = GetTotalPower(powerM);
+    FillPowerGrid(case_id, clk);
+    double totP = GetTotalPower();
     std::cout << "total final power is " << totP * 1000 << " [mW]" << std::endl;
-    double *T = steady_thermal_solver(
-        powerM, config_.chip_dim_x, config_.chip_dim_y, numP, dimX + num_dummy,
-        dimY + num_dummy, Midx, MidxSize, Tamb);
-    T_final[case_id] = T;
+    // the conductance matrix is the same for every case, factorize it once
+    if (!steady_factor_) {
+        steady_factor_ = factorize_steady_system(
+            Midx, MidxSize, numP, dimX + num_dummy, dimY + num_dummy);
+    }
+    steady_thermal_solver(steady_factor_, power_grid_.data(),
+                          config_.chip_dim_x, config_.chip_dim_y, numP,
+                          dimX + num_dummy, dimY + num_dummy,
+                          T_final[case_id].data(), Tamb);
 }
 
-double ***ThermalCalculator::InitPowerM(int case_id, uint64_t clk) {
-    double ***powerM;
-    // assert in powerM
-    powerM = new double **[dimX + num_dummy];
-    for (int i = 0; i < dimX + num_dummy; i++) {
-        powerM[i] = new double *[dimY + num_dummy];
-        for (int j = 0; j < dimY + num_dummy; j++) {
-            powerM[i][j] = new double[numP];
-        }
-    }
-    // initialize powerM
-    for (int i = 0; i < dimX + num_dummy; i++)
-        for (int j = 0; j < dimY + num_dummy; j++)
-            std::fill_n(powerM[i][j], numP, 0.0);
-
+void ThermalCalculator::FillPowerGrid(int case_id, uint64_t clk) {
     // when clk is 0 then it's trans otherwise it's final
     double div = clk == 0 ? (double)config_.epoch_period : (double)clk;
-    auto &power_map = clk == 0 ? cur_Pmap : accu_Pmap;
-    // fill in powerM
-    for (int i = 0; i < dimX; i++) {
+    const auto &power_map = clk == 0 ? cur_Pmap[case_id] : accu_Pmap[case_id];
+    // the dummy cells around the die stay at 0
+    int grid_x = dimX + num_dummy;
+    int grid_y = dimY + num_dummy;
+    for (int l = 0; l < numP; l++) {
         for (int j = 0; j < dimY; j++) {
-            for (int l = 0; l < numP; l++) {
-                powerM[i + num_dummy / 2][j + num_dummy / 2][l] =
-                    power_map[case_id][l * (dimX * dimY) + j * dimX + i] / div;
+            const double *src = &power_map[l * (dimX * dimY) + j * dimX];
+            double *dst = &power_grid_[(l * grid_y + j + num_dummy / 2) * grid_x +
+                                       num_dummy / 2];
+            for (int i = 0; i < dimX; i++) {
+                dst[i] = src[i] / div;
             }
         }
     }
-    return powerM;
 }
 
-double ThermalCalculator::GetTotalPower(double ***powerM) {
+double ThermalCalculator::GetTotalPower() const {
     double total_power = 0.0;
-    for (int i = 0; i < dimX; i++) {
-        for (int j = 0; j < dimY; j++) {
-            for (int l = 0; l < numP; l++) {
-                total_power += powerM[i + num_dummy / 2][j + num_dummy / 2][l];
-            }
-        }
+    for (auto p : power_grid_) {
+        total_power += p;
     }
     return total_power;
 }
@@ -694,12 +676,16 @@ void ThermalCalculator::InitialParameters() {
     Cap = calculate_Cap_array(config_.chip_dim_x, config_.chip_dim_y, numP,
                               dimX + num_dummy, dimY + num_dummy, &CapSize);
     calculate_time_step();
+    double dt = config_.epoch_period * config_.tCK * 1e-9 / time_iter;
+    trans_kernel_ = build_transient_kernel(Midx, MidxSize, Cap,
+                                           dimX + num_dummy, dimY + num_dummy,
+                                           dt);
 
     for (int ir = 0; ir < num_case; ir++) {
         double *T =
             initialize_Temperature(config_.chip_dim_x, config_.chip_dim_y, numP,
                                    dimX + num_dummy, dimY + num_dummy, Tamb);
-        for (int i = 0; i < T_size; i++) T_trans[ir][i] = T[i];
+        std::copy(T, T + T_size, T_trans[ir].begin());
         free(T);
     }
 }
@@ -759,7 +745,8 @@ void ThermalCalculator::calculate_time_step() {
     std::cout << "time_iter = " << time_iter << std::endl;
 }
 
-double ThermalCalculator::GetMaxTofCase(double **temp_map, int case_id) {
+double ThermalCalculator::GetMaxTofCase(
+    const std::vector<std::vector<double>> &temp_map, int case_id) {
     double maxT = 0;
     for (int i = 0; i < T_size; i++) {
         if (temp_map[case_id][i] > maxT) {
@@ -769,8 +756,8 @@ double ThermalCalculator::GetMaxTofCase(double **temp_map, int case_id) {
     return maxT;
 }
 
-double ThermalCalculator::GetMaxTofCaseLayer(double **temp_map, int case_id,
-                                             int layer) {
+double ThermalCalculator::GetMaxTofCaseLayer(
+    const std::vector<std::vector<double>> &temp_map, int case_id, int layer) {
     double maxT = 0;
     int layer_pos_offset =
         (layerP[layer] + 1) * ((dimX + num_dummy) * (dimY + num_dummy));
@@ -785,9 +772,9 @@ double ThermalCalculator::GetMaxTofCaseLayer(double **temp_map, int case_id,
     return maxT;
 }
 
-void ThermalCalculator::PrintCSV_trans(std::ofstream &csvfile,
-                                       std::vector<std::vector<double>> P_,
-                                       double **T_, int id, uint64_t scale) {
+void ThermalCalculator::PrintCSV_trans(
+    std::ofstream &csvfile, const std::vector<std::vector<double>> &P_,
+    const std::vector<std::vector<double>> &T_, int id, uint64_t scale) {
     for (int l = 0; l < numP; l++) {
         for (int j = num_dummy / 2; j < dimY + num_dummy / 2; j++) {
             for (int i = num_dummy / 2; i < dimX + num_dummy / 2; i++) {
@@ -807,9 +794,9 @@ void ThermalCalculator::PrintCSV_trans(std::ofstream &csvfile,
     }
 }
 
-void ThermalCalculator::PrintCSV_final(std::ofstream &csvfile,
-                                       std::vector<std::vector<double>> P_,
-                                       double **T_, int id, uint64_t scale) {
+void ThermalCalculator::PrintCSV_final(
+    std::ofstream &csvfile, const std::vector<std::vector<double>> &P_,
+    const std::vector<std::vector<double>> &T_, int id, uint64_t scale) {
     for (int l = 0; l < numP; l++) {
         for (int j = num_dummy / 2; j < dimY + num_dummy / 2; j++) {
             for (int i = num_dummy / 2; i < dimX + num_dummy / 2; i++) {
@@ -12,6 +12,9 @@
 #include "configuration.h"
 #include "thermal_config.h"
 
+struct transient_kernel;
+struct steady_factor;
+
 namespace dramsim3 {
 
 extern std::function<Address(const Address &addr)> GetPhyAddress;
@@ -33,7 +36,7 @@ class ThermalCalculator {
 
    private:
     // Initialization
-    double ***InitPowerM(int case_id, uint64_t clk);
+    void FillPowerGrid(int case_id, uint64_t clk);
     void InitialParameters();
 
     // location mapping functions
@@ -57,20 +60,25 @@ class ThermalCalculator {
     // calculations
     void CalcTransT(int case_id);
     void CalcFinalT(int case_id, uint64_t clk);
-    double GetTotalPower(double ***powerM);
+    double GetTotalPower() const;
     int square_array(int total_grids_);
     int determineXY(double xd, double yd, int total_grids_);
-    double GetMaxTofCase(double **temp_map, int case_id);
-    double GetMaxTofCaseLayer(double **temp_map, int case_id, int layer);
+    double GetMaxTofCase(const std::vector<std::vector<double>> &temp_map,
+                         int case_id);
+    double GetMaxTofCaseLayer(
+        const std::vector<std::vector<double>> &temp_map, int case_id,
+        int layer);
     void calculate_time_step();
 
     // print to csv-files
     void PrintCSV_trans(std::ofstream &csvfile,
-                        std::vector<std::vector<double>> P_, double **T_,
-                        int id, uint64_t scale);
+                        const std::vector<std::vector<double>> &P_,
+                        const std::vector<std::vector<double>> &T_, int id,
+                        uint64_t scale);
     void PrintCSV_final(std::ofstream &csvfile,
-                        std::vector<std::vector<double>> P_, double **T_,
-                        int id, uint64_t scale);
+                        const std::vector<std::vector<double>> &P_,
+                        const std::vector<std::vector<double>> &T_, int id,
+                        uint64_t scale);
     void PrintCSVHeader_final(std::ofstream &csvfile);
     void PrintCSV_bank(std::ofstream &csvfile);
 
@@ -86,7 +94,12 @@ class ThermalCalculator {
     double *Cap;            // Cap storing the thermal capacitance
     int MidxSize, CapSize;  // first dimension size of Midx and Cap
     int T_size;
-    double **T_trans, **T_final;
+    // temperature of every grid node, one contiguous grid per case
+    std::vector<std::vector<double>> T_trans, T_final;
+    // power of the case being solved, padded with the dummy cells
+    std::vector<double> power_grid_;
+    transient_kernel *trans_kernel_;  // built once, Midx never changes
+    steady_factor *steady_factor_;    // LU of Midx, built on first use
 
     int sample_id;  // index of the sampling power
 
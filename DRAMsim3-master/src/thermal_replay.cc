@@ -125,44 +125,46 @@ void ThermalReplay::ProcessCMD(Command &cmd, uint64_t clk) {
     uint64_t past_clks = clk - last_clk_;
     for (int i = 0; i < config_.channels; i++) {
         for (int j = 0; j < config_.ranks; j++) {
+            auto& stats = channel_stats_[i];
             if (IsRankActive(i, j)) {
-                channel_stats_[i].IncrementVecBy("rank_active_cycles", j,
-                                                 past_clks);
+                stats.IncrementVecBy(stats.GetStatId("rank_active_cycles"), j,
+                                     past_clks);
             } else {
-                channel_stats_[i].IncrementVecBy("all_bank_idle_cycles", j,
-                                                 past_clks);
+                stats.IncrementVecBy(stats.GetStatId("all_bank_idle_cycles"),
+                                     j, past_clks);
             }
         }
     }
 
     int channel = cmd.Channel();
+    auto& stats = channel_stats_[channel];
     // update cmd count
     switch (cmd.cmd_type) {
         case CommandType::READ:
         case CommandType::READ_PRECHARGE:
-            channel_stats_[channel].Increment("num_read_cmds");
+            stats.Increment(stats.GetStatId("num_read_cmds"));
             break;
         case CommandType::WRITE:
         case CommandType::WRITE_PRECHARGE:
-            channel_stats_[channel].Increment("num_write_cmds");
+            stats.Increment(stats.GetStatId("num_write_cmds"));
             break;
         case CommandType::ACTIVATE:
-            channel_stats_[channel].Increment("num_act_cmds");
+            stats.Increment(stats.GetStatId("num_act_cmds"));
             break;
         case CommandType::PRECHARGE:
-            channel_stats_[channel].Increment("num_pre_cmds");
+            stats.Increment(stats.GetStatId("num_pre_cmds"));
             break;
         case CommandType::REFRESH:
-            channel_stats_[channel].Increment("num_ref_cmds");
+            stats.Increment(stats.GetStatId("num_ref_cmds"));
             break;
         case CommandType::REFRESH_BANK:
-            channel_stats_[channel].Increment("num_refb_cmds");
+            stats.Increment(stats.GetStatId("num_refb_cmds"));
             break;
         case CommandType::SREF_ENTER:
-            channel_stats_[channel].Increment("num_srefe_cmds");
+            stats.Increment(stats.GetStatId("num_srefe_cmds"));
             break;
         case CommandType::SREF_EXIT:
-            channel_stats_[channel].Increment("num_srefx_cmds");
+            stats.Increment(stats.GetStatId("num_srefx_cmds"));
             break;
         default:
             AbruptExit(__FILE__, __LINE__);
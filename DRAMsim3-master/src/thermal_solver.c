@@ -6,16 +6,16 @@
 #include <omp.h>
 #include <stdbool.h>
 #include <stdio.h>
+#include <string.h>
 #include <time.h>
 #include "../ext/SuperLU_MT_3.1/SRC/slu_mt_ddefs.h"
 #include "thermal_config.h"
+#include "thermal_solver.h"
 
 //#define DEBUG
 //#define DEBUGMIDX
 //#define DEBUGMAT
 
-double get_maxT(double *T, int Tsize);
-
 double *initialize_Temperature(double W, double Lc, int numP, int dimX,
                                int dimZ, double Tamb) {
     int numLayer, l;
@@ -420,57 +420,64 @@ double **calculate_Midx_array(double W, double Lc, int numP, int dimX, int dimZ,
     return Midx;
 }
 
-double *steady_thermal_solver(double ***powerM, double W, double Lc, int numP,
-                              int dimX, int dimZ, double **Midx, int count,
-                              double Tamb) {
-    int numLayer = numP * 3;
-    int_t *layerP;
-    // define the active layer array
-    if (!(layerP = intMalloc(numP))) SUPERLU_ABORT("Malloc fails for numP[].");
-    for (int l = 0; l < numP; l++) layerP[l] = l * 3;
-
-    double Wsink = W;
-    double Lsink = Lc;
-    double Hsink = Hhs;
-    double Ksink = Khs;
-    double gridXsink = Wsink / dimX;
-    double gridZsink = Lsink / dimZ;
-    double Rsinky = Hsink / Ksink / gridXsink / gridZsink;  // y direction
-    double Ramb = Rsinky / 2;
-
-    // convert the values to the SuperMatrix format
-    SuperMatrix A, L, U, B;
-    double *a;
-    int_t *asub, *xa;
+void free_Midx_array(double **Midx, int MidxSize) {
+    for (int i = 0; i < MidxSize; i++) free(Midx[i]);
+    free(Midx);
+}
+
+/* thermal resistance between the heat sink and the ambient */
+static double ambient_resistance(double W, double Lc, int dimX, int dimZ) {
+    double gridXsink = W / dimX;
+    double gridZsink = Lc / dimZ;
+    double Rsinky = Hhs / Khs / gridXsink / gridZsink;  // y direction
+    return Rsinky / 2;
+}
+
+/* heat flowing into each node: the ambient into the heat sink layer and
+ * the power map into the active layers, zero elsewhere */
+static void fill_heat_input(double *P, const double *powerM, double W,
+                            double Lc, int numP, int dimX, int dimZ,
+                            double Tamb) {
+    int layer_size = dimX * dimZ;
+    double Ramb = ambient_resistance(W, Lc, dimX, dimZ);
+    memset(P, 0, layer_size * (numP * 3 + 1) * sizeof(*P));
+    for (int i = 0; i < layer_size; i++) P[i] = Tamb / Ramb;
+    // active layer l sits on layer l * 3 of the stack, right above the sink
+    for (int l = 0; l < numP; l++)
+        memcpy(P + layer_size * (l * 3 + 1), powerM + layer_size * l,
+               layer_size * sizeof(*P));
+}
+
+struct steady_factor {
+    SuperMatrix A, AC, L, U;
     int_t *perm_r; /* row permutations from partial pivoting */
     int_t *perm_c; /* column permutation vector */
-    SCPformat *Lstore;
-    NCPformat *Ustore;
-    int_t nrhs, info, m, n, nnz, b;
-    int_t nprocs; /* maximum number of processors to use. */
-    int_t panel_size, relax, maxsup;
-    int_t permc_spec;
-    trans_t trans;
+    superlumt_options_t options;
+    Gstat_t gstat;
+    int_t nprocs;
+    int_t info;
     double *rhs;
-    superlu_memusage_t superlu_memusage;
+};
+
+struct steady_factor *factorize_steady_system(double **Midx, int count,
+                                              int numP, int dimX, int dimZ) {
+    struct steady_factor *f;
+    double *a;
+    int_t *asub, *xa;
+    int_t m, n, nnz, panel_size, relax;
 
-    nrhs = 1;
-    trans = NOTRANS;
-    nprocs = omp_get_max_threads();
-    b = 1;
+    if (!(f = (struct steady_factor *)malloc(sizeof(*f))))
+        SUPERLU_ABORT("Malloc fails for steady_factor.");
+    f->nprocs = omp_get_max_threads();
     panel_size = sp_ienv(1);
     relax = sp_ienv(2);
-    maxsup = sp_ienv(3);
 
     /* Initialize matrix A. */
-    m = n = dimX * dimZ * (numLayer + 1);
+    m = n = dimX * dimZ * (numP * 3 + 1);
     nnz = count;
-    if (!(a = doubleMalloc(nnz)))
-        SUPERLU_ABORT("Malloc fails for a[].");  // I cannot free the space
-    if (!(asub = intMalloc(nnz)))
-        SUPERLU_ABORT("Malloc fails for asub[].");  // I cannot free the space
-    if (!(xa = intMalloc(n + 1)))
-        SUPERLU_ABORT("Malloc fails for xa[].");  // I cannot free the space
+    if (!(a = doubleMalloc(nnz))) SUPERLU_ABORT("Malloc fails for a[].");
+    if (!(asub = intMalloc(nnz))) SUPERLU_ABORT("Malloc fails for asub[].");
+    if (!(xa = intMalloc(n + 1))) SUPERLU_ABORT("Malloc fails for xa[].");
 
     /* assign values to the arrays: a, asub and xa */
     int row = -1;
@@ -484,232 +491,182 @@ double *steady_thermal_solver(double ***powerM, double W, double Lc, int numP,
     }
     xa[row + 1] = count;
 
-    printf("Using %lld Cores to calculate\n", nprocs);
-    printf("Building the sparse matrix ...\n");
+    printf("Using %lld Cores to calculate\n", f->nprocs);
     printf("Dimension of the G matrix is %lld x %lld\n", m, n);
     printf("Number of non-zero entries is %lld\n", nnz);
 
-    /* Create matrix A in the format expected by SuperLU. */
-    dCreate_CompCol_Matrix(&A, m, n, nnz, a, asub, xa, SLU_NC, SLU_D, SLU_GE);
-    // dPrint_CompCol_Matrix("A", &A);
-    /* Create right-hand side matrix B. */
-    if (!(rhs = doubleMalloc(m * nrhs)))
-        SUPERLU_ABORT("Malloc fails for rhs[].");
-
-    // assign values to B
-    for (int i = 0; i < m; i++)  // initialize rhs to 0
-        rhs[i] = 0;
-    for (int i = 0; i < dimX * dimZ; i++) rhs[i] = Tamb / Ramb;
-    for (int l = 0; l < numP; l++)
-        for (int i = 0; i < dimX; i++)
-            for (int j = 0; j < dimZ; j++) {
-                rhs[dimX * dimZ * (layerP[l] + 1) + j * dimX + i] =
-                    powerM[i][j][l];
-                // rhs[dimX*dimZ*(layerP[l]+1) + i*dimZ + j] = powerM[i][j][l];
-                // printf("%.6f\n", powerM[i][j][l]);
-            }
-
-    // free the space
-    for (int i = 0; i < dimX; i++) {
-        for (int j = 0; j < dimZ; j++) {
-            free(powerM[i][j]);
-        }
-        free(powerM[i]);
+    /* Create matrix A in the format expected by SuperLU, it owns a, asub
+     * and xa from now on */
+    dCreate_CompCol_Matrix(&f->A, m, n, nnz, a, asub, xa, SLU_NC, SLU_D,
+                           SLU_GE);
+
+    if (!(f->perm_r = intMalloc(m)))
+        SUPERLU_ABORT("Malloc fails for perm_r[].");
+    if (!(f->perm_c = intMalloc(n)))
+        SUPERLU_ABORT("Malloc fails for perm_c[].");
+    if (!(f->rhs = doubleMalloc(m))) SUPERLU_ABORT("Malloc fails for rhs[].");
+
+    /* minimum degree ordering on structure of A'*A */
+    get_perm_c(1, &f->A, f->perm_c);
+
+    /* the same steps as pdgssv() but keeping L and U for later solves */
+    StatAlloc(n, f->nprocs, panel_size, relax, &f->gstat);
+    StatInit(n, f->nprocs, &f->gstat);
+    pdgstrf_init(f->nprocs, EQUILIBRATE, NOTRANS, NO, panel_size, relax, 1.0,
+                 NO, 0.0, f->perm_c, f->perm_r, NULL, 0, &f->A, &f->AC,
+                 &f->options, &f->gstat);
+    pdgstrf(&f->options, &f->AC, f->perm_r, &f->L, &f->U, &f->gstat,
+            &f->info);
+    if (f->info != 0) {
+        printf("LU factorization of the G matrix failed, info = %lld\n",
+               f->info);
+        SUPERLU_ABORT("Cannot factorize the thermal conductance matrix.");
     }
-    free(powerM);
-
-    dCreate_Dense_Matrix(&B, m, nrhs, rhs, m, SLU_DN, SLU_D, SLU_GE);
-
-    // dPrint_Dense_Matrix("B", &B);
-
-    if (!(perm_r = intMalloc(m))) SUPERLU_ABORT("Malloc fails for perm_r[].");
-    if (!(perm_c = intMalloc(n))) SUPERLU_ABORT("Malloc fails for perm_c[].");
-
-    /*
-     * Get column permutation vector perm_c[], according to permc_spec:
-     *   permc_spec = 0: natural ordering
-     *   permc_spec = 1: minimum degree ordering on structure of A'*A
-     *   permc_spec = 2: minimum degree ordering on structure of A'+A
-     *   permc_spec = 3: approximate minimum degree for unsymmetric matrices
-     */
-    permc_spec = 1;
-    get_perm_c(permc_spec, &A, perm_c);
-
-    printf("Finish building the sparse matrix\n");
+    printf("#NZ in L+U = " IFMT "\n",
+           ((SCPformat *)f->L.Store)->nnz + ((NCPformat *)f->U.Store)->nnz -
+               f->L.ncol);
+    printf("Finish factorizing the sparse matrix\n");
     printf("------------------------------------------------------------\n\n");
+    return f;
+}
 
-    /* Solve the linear system. */
-    pdgssv(nprocs, &A, perm_c, perm_r, &L, &U, &B, &info);
-
-    printf("Finish solving the linear equation\n");
-
-    // dPrint_Dense_Matrix("B", &B);
-
-    // extract the Temperature from B
-    DNformat *Astore = (DNformat *)B.Store;
-    // double *Tt; // vector stores the temperature for all grids
-
-    double *Ttp, *Tt;
-    if (!(Tt = (double *)malloc(dimX * dimZ * (numP * 3 + 1) * sizeof(double))))
-        printf("Malloc fails for Tt\n");
-    Ttp = (double *)Astore->nzval;
-    printf("B.nrow is %lld\n", B.nrow);
-    for (int i = 0; i < B.nrow; ++i) {
-        Tt[i] = Ttp[i] - T0;
-        // printf("Tt[%d] = %.2f\n", i, Tt[i]);
-    }
-
-    /*Tt = (double *) Astore->nzval;
-    printf("B.nrow is %d\n", B.nrow);
-    for (i = 0; i < B.nrow; ++i)
-    {
-        Tt[i] = Tt[i] - T0;
-        //printf("%.2f\n", T[i]);
-    }*/
-
-    printf("Finish converting the temperature matrix\n");
-    printf("Free the space...\n");
-
-    if (info == 0) {
-        // dinf_norm_error(nrhs, &B, xact); /* Inf. norm of the error */
-
-        Lstore = (SCPformat *)L.Store;
-        Ustore = (NCPformat *)U.Store;
-        printf("#NZ in factor L = " IFMT "\n", Lstore->nnz);
-        printf("#NZ in factor U = " IFMT "\n", Ustore->nnz);
-        printf("#NZ in L+U = " IFMT "\n", Lstore->nnz + Ustore->nnz - L.ncol);
-
-        superlu_dQuerySpace(nprocs, &L, &U, panel_size, &superlu_memusage);
-        printf("L\\U MB %.3f\ttotal MB needed %.3f\texpansions " IFMT "\n",
-               superlu_memusage.for_lu / 1024 / 1024,
-               superlu_memusage.total_needed / 1024 / 1024,
-               superlu_memusage.expansions);
-    }
+void free_steady_factor(struct steady_factor *f) {
+    pxgstrf_finalize(&f->options, &f->AC);
+    StatFree(&f->gstat);
+    SUPERLU_FREE(f->rhs);
+    SUPERLU_FREE(f->perm_r);
+    SUPERLU_FREE(f->perm_c);
+    Destroy_CompCol_Matrix(&f->A);
+    Destroy_SuperNode_SCP(&f->L);
+    Destroy_CompCol_NCP(&f->U);
+    free(f);
+}
 
-    /* De-allocate storage */
-    // free the arrays defined by myself
-    SUPERLU_FREE(layerP);
-    SUPERLU_FREE(rhs);
-    SUPERLU_FREE(perm_r);
-    SUPERLU_FREE(perm_c);
-    printf("finish SUPERLU_FREE\n");
-    Destroy_CompCol_Matrix(&A);
+void steady_thermal_solver(struct steady_factor *f, const double *powerM,
+                           double W, double Lc, int numP, int dimX, int dimZ,
+                           double *T, double Tamb) {
+    SuperMatrix B;
+    int_t m = f->A.nrow;
+    int_t info;
+
+    fill_heat_input(f->rhs, powerM, W, Lc, numP, dimX, dimZ, Tamb);
+    dCreate_Dense_Matrix(&B, m, 1, f->rhs, m, SLU_DN, SLU_D, SLU_GE);
+    /* Solve the linear system, overwriting rhs with the temperature. */
+    dgstrs(NOTRANS, &f->L, &f->U, f->perm_r, f->perm_c, &B, &f->gstat, &info);
+    if (info != 0) SUPERLU_ABORT("Steady thermal solve failed.");
     Destroy_SuperMatrix_Store(&B);
-    Destroy_SuperNode_SCP(&L);
-    Destroy_CompCol_NCP(&U);
-    /* De-allocate other storage */
-    // free(K); free(H); free(layerP); free(Tt);
 
-    printf(
-        "================= FINISH STEADY TEMPERATURE SOLVER "
-        "===============\n\n");
-
-    return Tt;
+    for (int_t i = 0; i < m; i++) T[i] = f->rhs[i] - T0;
 }
 
-double *transient_thermal_solver(double ***powerM, double W, double Lc,
-                                 int numP, int dimX, int dimZ, double **Midx,
-                                 int MidxSize, double *Cap, int CapSize,
-                                 double time, int iter, double *T_trans,
-                                 double Tamb) {
-    int numLayer = numP * 3;
-
-    // define the active layer array
-    int_t *layerP;
-    if (!(layerP = intMalloc(numP))) SUPERLU_ABORT("Malloc fails for numP[].");
-    for (int l = 0; l < numP; l++) layerP[l] = l * 3;
-
-    double Wsink = W;
-    double Lsink = Lc;
-    double Hsink = Hhs;
-    double Ksink = Khs;
-    double gridXsink = Wsink / dimX;
-    double gridZsink = Lsink / dimZ;
-    double Rsinky = Hsink / Ksink / gridXsink / gridZsink;  // y direction
-    double Ramb = Rsinky / 2;
-
-    double *Tp = T_trans;
-    double *T, *P;
-    int T_size = dimX * dimZ * (numLayer + 1);
-    if (!(T = doubleMalloc(T_size))) SUPERLU_ABORT("Malloc fails for rhs[].");
-    if (!(P = doubleMalloc(T_size))) SUPERLU_ABORT("Malloc fails for rhs[].");
-
-    // initialize T and P
-    memset(T, 0, T_size * sizeof(*T));
-    memset(P, 0, T_size * sizeof(*T));
-
-    for (int i = 0; i < dimX * dimZ; i++) P[i] = Tamb / Ramb;
-    for (int l = 0; l < numP; l++)
-        for (int j = 0; j < dimZ; j++)
-            for (int i = 0; i < dimX; i++) {
-                P[dimX * dimZ * (layerP[l] + 1) + i * dimZ + j] =
-                    powerM[i][j][l];
-                // printf("%.6f\n", powerM[i][j][l]);
-            }
-
-    double dt = time / (double)iter;
-
-    ////////////// iteratively update the temperature /////////////////
-
-    // tried to optimize the following code
-    // multi-threading won't work unless you figure out T[idx0] access patterns
-    // also tried a variety of loop tiling technique, on our server block_size=8
-    // or 4 yields best performance, so let it be...
-    const int block_size = 8;
-    for (int iit = 0; iit < iter; iit++) {
-        // main calculation of the new T
-        for (int j = 0; j < MidxSize; j += block_size) {
-            int bound = j + block_size < MidxSize ? (j + block_size) : MidxSize;
-            for (int b = j; b < bound; b++) {
-                int idx0 = (int)(Midx[b][0] + 0.01);
-                int idx1 = (int)(Midx[b][1] + 0.01);
-                double tmp_c = Midx[b][2];
-                int idxC = idx0 / (dimX * dimZ);
-
-                if (idx0 == idx1) {
-                    // if (1-Midx[j][2]*dt/Cap[idxC] < 0)
-                    //    printf("NEGATIVE: idx0 = %d\n", idx0);
-                    double tmp_a = 1 - tmp_c * dt / Cap[idxC];
-                    double tmp_b = tmp_a * Tp[idx1] + P[idx0] * dt / Cap[idxC];
-                    T[idx0] += tmp_b;
-                } else {
-                    double tmp_a = tmp_c * Tp[idx1] * dt / Cap[idxC];
-                    T[idx0] -= tmp_a;
-                }
-            }
+struct transient_kernel {
+    int n;         // number of grid nodes
+    int width;     // entries kept per row, short rows are padded
+    int *col;      // width x n, entry k of row r at k * n + r
+    double *coef;  // 0 in padding entries
+    double *dt_cap;  // dt / C of each node, turns heat input into dT
+    double *bias;    // per step heat input, dt_cap * P
+    double *T_next;
+};
+
+struct transient_kernel *build_transient_kernel(double **Midx, int MidxSize,
+                                                double *Cap, int dimX,
+                                                int dimZ, double dt) {
+    struct transient_kernel *kern;
+    int layer_size = dimX * dimZ;
+    int n = (int)(Midx[MidxSize - 1][0] + 0.01) + 1;
+
+    if (!(kern = (struct transient_kernel *)malloc(sizeof(*kern))))
+        SUPERLU_ABORT("Malloc fails for transient_kernel.");
+    kern->n = n;
+
+    // Midx is sorted by row, the widest row decides the padding
+    int width = 0, run = 0;
+    for (int j = 0; j < MidxSize; j++) {
+        run++;
+        if (j + 1 == MidxSize ||
+            (int)(Midx[j + 1][0] + 0.01) != (int)(Midx[j][0] + 0.01)) {
+            width = run > width ? run : width;
+            run = 0;
         }
-
-        // give value for the next T
-        double *Tt;  // for swap the storage between T and Tp
-        Tt = Tp;
-        Tp = T;
-        T = Tt;  // exchange T, Tp
-        memset(T, 0, dimX * dimZ * (numLayer + 1) * sizeof(*T));
     }
-
-    // free the space
-    for (int i = 0; i < dimX; i++) {
-        for (int j = 0; j < dimZ; j++) {
-            free(powerM[i][j]);
+    kern->width = width;
+
+    if (!(kern->col = (int *)malloc(width * n * sizeof(int))))
+        SUPERLU_ABORT("Malloc fails for col[].");
+    if (!(kern->coef = doubleMalloc(width * n)))
+        SUPERLU_ABORT("Malloc fails for coef[].");
+    if (!(kern->dt_cap = doubleMalloc(n)))
+        SUPERLU_ABORT("Malloc fails for dt_cap[].");
+    if (!(kern->bias = doubleMalloc(n)))
+        SUPERLU_ABORT("Malloc fails for bias[].");
+    if (!(kern->T_next = doubleMalloc(n)))
+        SUPERLU_ABORT("Malloc fails for T_next[].");
+
+    for (int r = 0; r < n; r++) {
+        kern->dt_cap[r] = dt / Cap[r / layer_size];
+        for (int k = 0; k < width; k++) {
+            kern->col[k * n + r] = r;
+            kern->coef[k * n + r] = 0.0;
         }
-        free(powerM[i]);
     }
-    free(powerM);
-
-    SUPERLU_FREE(layerP);
-    SUPERLU_FREE(P);
-    SUPERLU_FREE(T);
-
-    return Tp;
+    // T'[r] = T[r] + dt / C * (P[r] - sum_c G[r][c] * T[c])
+    int k = 0;
+    for (int j = 0; j < MidxSize; j++) {
+        int idx0 = (int)(Midx[j][0] + 0.01);
+        int idx1 = (int)(Midx[j][1] + 0.01);
+        double c = -Midx[j][2] * kern->dt_cap[idx0];
+        if (idx0 == idx1) c += 1.0;
+        kern->col[k * n + idx0] = idx1;
+        kern->coef[k * n + idx0] = c;
+        k = (j + 1 < MidxSize && (int)(Midx[j + 1][0] + 0.01) == idx0) ? k + 1
+                                                                      : 0;
+    }
+    printf("Transient kernel: %d nodes, %d entries per row\n", n, width);
+    return kern;
 }
 
-double get_maxT(double *T, int Tsize) {
-    double maxT = 0.0;
-    int i;
+void free_transient_kernel(struct transient_kernel *kern) {
+    free(kern->col);
+    SUPERLU_FREE(kern->coef);
+    SUPERLU_FREE(kern->dt_cap);
+    SUPERLU_FREE(kern->bias);
+    SUPERLU_FREE(kern->T_next);
+    free(kern);
+}
 
-    for (i = 0; i < Tsize; i++) {
-        if (T[i] > maxT) maxT = T[i];
+void transient_thermal_solver(struct transient_kernel *kern,
+                              const double *powerM, double W, double Lc,
+                              int numP, int dimX, int dimZ, int iter,
+                              double *T, double Tamb) {
+    const int n = kern->n;
+    const int width = kern->width;
+    const int *col = kern->col;
+    const double *coef = kern->coef;
+    double *bias = kern->bias;
+
+    fill_heat_input(bias, powerM, W, Lc, numP, dimX, dimZ, Tamb);
+    for (int r = 0; r < n; r++) bias[r] *= kern->dt_cap[r];
+
+    // every row of a step only reads the previous step, so rows are split
+    // across threads and vectorised; the implicit barrier of omp for
+    // separates the steps
+#pragma omp parallel
+    {
+        const double *src = T;
+        double *dst = kern->T_next;
+        for (int iit = 0; iit < iter; iit++) {
+#pragma omp for simd schedule(static)
+            for (int r = 0; r < n; r++) {
+                double t = bias[r];
+                for (int k = 0; k < width; k++)
+                    t += coef[k * n + r] * src[col[k * n + r]];
+                dst[r] = t;
+            }
+            double *tmp = (double *)src;
+            src = dst;
+            dst = tmp;
+        }
     }
-
-    return maxT;
+    if (iter % 2) memcpy(T, kern->T_next, n * sizeof(*T));
 }
@@ -0,0 +1,52 @@
+#ifndef __THERMAL_SOLVER_H
+#define __THERMAL_SOLVER_H
+
+/* interface of the superLU based thermal solver in thermal_solver.c
+ * all grids are contiguous, a power grid of numP active layers is indexed
+ * as powerM[(l * dimZ + j) * dimX + i] and a temperature grid of
+ * (numP * 3 + 1) layers as T[(layer * dimZ + j) * dimX + i]
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+double **calculate_Midx_array(double W, double Lc, int numP, int dimX,
+                              int dimZ, int *MidxSize, double Tamb);
+void free_Midx_array(double **Midx, int MidxSize);
+double *calculate_Cap_array(double W, double Lc, int numP, int dimX, int dimZ,
+                            int *CapSize);
+double *initialize_Temperature(double W, double Lc, int numP, int dimX,
+                               int dimZ, double Tamb);
+
+/* Explicit time stepping of the transient equation. The conductance matrix
+ * and the time step never change during a run, so they are folded into a
+ * padded (ELLPACK) iteration matrix once; every step is then a
+ * multithreaded, vectorisable sparse matrix-vector product. */
+struct transient_kernel;
+struct transient_kernel *build_transient_kernel(double **Midx, int MidxSize,
+                                                double *Cap, int dimX,
+                                                int dimZ, double dt);
+void free_transient_kernel(struct transient_kernel *kernel);
+/* advance T (updated in place) by iter steps under power powerM */
+void transient_thermal_solver(struct transient_kernel *kernel,
+                              const double *powerM, double W, double Lc,
+                              int numP, int dimX, int dimZ, int iter,
+                              double *T, double Tamb);
+
+/* The steady state system is LU factorised once and every further power
+ * map only costs a pair of triangular solves. */
+struct steady_factor;
+struct steady_factor *factorize_steady_system(double **Midx, int count,
+                                              int numP, int dimX, int dimZ);
+void free_steady_factor(struct steady_factor *factor);
+/* write the steady temperature in [C] of every grid node to T */
+void steady_thermal_solver(struct steady_factor *factor, const double *powerM,
+                           double W, double Lc, int numP, int dimX, int dimZ,
+                           double *T, double Tamb);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // __THERMAL_SOLVER_H
@@ -0,0 +1,88 @@
+#include "tick_pool.h"
+
+namespace dramsim3 {
+
+namespace {
+// how many times an idle worker polls for the next job before sleeping
+const int kSpinIterations = 1 << 14;
+}  // namespace
+
+TickPool::TickPool(int num_threads)
+    : task_(nullptr),
+      num_tasks_(0),
+      next_task_(0),
+      busy_workers_(0),
+      generation_(0),
+      stop_(false) {
+    // the calling thread takes part in every Run(), so spawn one less
+    for (int i = 1; i < num_threads; i++) {
+        workers_.emplace_back(&TickPool::WorkerLoop, this);
+    }
+}
+
+TickPool::~TickPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+        generation_++;
+    }
+    wake_cv_.notify_all();
+    for (auto& worker : workers_) {
+        worker.join();
+    }
+}
+
+void TickPool::Run(int num_tasks, const std::function<void(int)>& task) {
+    if (workers_.empty() || num_tasks <= 1) {
+        for (int i = 0; i < num_tasks; i++) {
+            task(i);
+        }
+        return;
+    }
+
+    task_ = &task;
+    num_tasks_ = num_tasks;
+    next_task_ = 0;
+    busy_workers_ = static_cast<int>(workers_.size());
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        generation_++;
+    }
+    wake_cv_.notify_all();
+
+    DrainTasks();
+    while (busy_workers_.load(std::memory_order_acquire) > 0) {
+        std::this_thread::yield();
+    }
+    task_ = nullptr;
+}
+
+void TickPool::DrainTasks() {
+    int i;
+    while ((i = next_task_.fetch_add(1)) < num_tasks_) {
+        (*task_)(i);
+    }
+}
+
+void TickPool::WorkerLoop() {
+    uint64_t seen = 0;
+    while (true) {
+        int spins = 0;
+        while (generation_.load(std::memory_order_acquire) == seen &&
+               spins < kSpinIterations) {
+            spins++;
+        }
+        if (generation_.load(std::memory_order_acquire) == seen) {
+            std::unique_lock<std::mutex> lock(mutex_);
+            wake_cv_.wait(lock, [&] { return generation_ != seen; });
+        }
+        seen = generation_.load(std::memory_order_acquire);
+        if (stop_) {
+            return;
+        }
+        DrainTasks();
+        busy_workers_.fetch_sub(1, std::memory_order_release);
+    }
+}
+
+}  // namespace dramsim3
@@ -0,0 +1,45 @@
+#ifndef __TICK_POOL_H
+#define __TICK_POOL_H
+
+#include <stdint.h>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace dramsim3 {
+
+// A small fork/join pool used to tick independent channel controllers in
+// parallel. Run() hands out task indices [0, num_tasks) to the workers and
+// the calling thread, and returns once every task has finished.
+// Workers spin briefly between jobs (a job is usually one clock cycle) and
+// fall back to sleeping on a condition variable when the pool goes idle.
+class TickPool {
+   public:
+    explicit TickPool(int num_threads);
+    ~TickPool();
+    TickPool(const TickPool&) = delete;
+    TickPool& operator=(const TickPool&) = delete;
+
+    int NumThreads() const { return static_cast<int>(workers_.size()) + 1; }
+    void Run(int num_tasks, const std::function<void(int)>& task);
+
+   private:
+    void WorkerLoop();
+    void DrainTasks();
+
+    std::vector<std::thread> workers_;
+    std::mutex mutex_;
+    std::condition_variable wake_cv_;
+    const std::function<void(int)>* task_;
+    int num_tasks_;
+    std::atomic<int> next_task_;
+    std::atomic<int> busy_workers_;
+    std::atomic<uint64_t> generation_;
+    std::atomic<bool> stop_;
+};
+
+}  // namespace dramsim3
+#endif  // __TICK_POOL_H
@@ -0,0 +1,56 @@
+#include <iostream>
+#include <string>
+#include "./../ext/headers/args.hxx"
+#include "binary_trace.h"
+
+// this will not be used in a library file so it's ok to do this
+using namespace dramsim3;
+
+// Turn a text trace ("addr READ|WRITE cycle" per line) into the binary
+// format that TraceBasedCPU maps into memory
+int main(int argc, const char **argv) {
+    args::ArgumentParser parser(
+        "Convert a DRAMsim3 text trace to the binary trace format.",
+        "Examples: \n"
+        "./build/traceconvert sample_trace.txt sample_trace.bin\n"
+        "./build/dramsim3main configs/DDR4_8Gb_x8_3200.ini -c 100000 -t "
+        "sample_trace.bin");
+    args::HelpFlag help(parser, "help", "Display the help menu", {'h', "help"});
+    args::Positional<std::string> input_arg(
+        parser, "input", "text trace file (mandatory)");
+    args::Positional<std::string> output_arg(
+        parser, "output", "binary trace file to write (mandatory)");
+
+    try {
+        parser.ParseCLI(argc, argv);
+    } catch (args::Help) {
+        std::cout << parser;
+        return 0;
+    } catch (args::ParseError e) {
+        std::cerr << e.what() << std::endl;
+        std::cerr << parser;
+        return 1;
+    }
+
+    std::string input_name = args::get(input_arg);
+    std::string output_name = args::get(output_arg);
+    if (input_name.empty() || output_name.empty()) {
+        std::cerr << parser;
+        return 1;
+    }
+
+    std::ifstream in(input_name);
+    if (!in) {
+        std::cerr << "cannot open " << input_name << std::endl;
+        return 1;
+    }
+    BinaryTraceWriter out(output_name);
+    Transaction trans;
+    while (in >> trans) {
+        out.Append(trans.addr, trans.is_write, trans.added_cycle);
+    }
+    out.Close();
+    std::cout << out.NumRecords() << " transactions written to "
+              << output_name << std::endl;
+    return 0;
+}
@@ -1,6 +1,22 @@
+#include <dirent.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cstdio>
+#include <fstream>
+#include <limits>
+#include <sstream>
 #include "catch.hpp"
+#include "analytic_system.h"
+#include "binary_trace.h"
+#include "cmd_trace.h"
 #include "configuration.h"
+#include "controller.h"
 #include "dram_system.h"
+#include "epoch_writer.h"
+#include "histogram.h"
+#include "pending_index.h"
+#include "refresh.h"
+#include "scheduler.h"
 
 bool call_back_called = false;
 void dummy_call_back(uint64_t addr) {
@@ -29,4 +45,658 @@ TEST_CASE("Jedec DRAMSystem Testing", "[dramsim3]") {
         int tRC = config.tRCDRD + config.CL + config.BL;
         REQUIRE(clk == tRC);
     }
+
+    SECTION("TEST merged reads come back with their own ids") {
+        uint64_t ch_stride = 1ull << (config.ch_pos + config.shift_bits);
+        std::vector<uint64_t> ids;
+        std::vector<int> channels;
+        dramsys.RegisterIdCallbacks(
+            [&](uint64_t id, uint64_t addr, int channel) {
+                ids.push_back(id);
+                channels.push_back(channel);
+            },
+            [&](uint64_t id, uint64_t addr, int channel) {});
+        dramsys.AddTransaction(2 * ch_stride, false, 7);
+        dramsys.AddTransaction(2 * ch_stride, false, 9);
+        for (int i = 0; i < 200 && ids.size() < 2; i++) {
+            dramsys.ClockTick();
+        }
+
+        REQUIRE(ids == std::vector<uint64_t>({7, 9}));
+        REQUIRE(channels == std::vector<int>({2, 2}));
+        REQUIRE(!call_back_called);
+    }
+}
+
+TEST_CASE("Jedec DRAMSystem batched ticking", "[dramsim3]") {
+    dramsim3::Config config("configs/HBM1_4Gb_x128.ini", ".");
+    config.tick_threads = 4;
+
+    dramsim3::JedecDRAMSystem dramsys(config, ".", dummy_call_back,
+                                      dummy_call_back);
+    int tRC = config.tRCDRD + config.CL + config.BL;
+
+    SECTION("TEST completions are reported with their cycle") {
+        dramsys.AddTransaction(1, false);
+        std::vector<dramsim3::DoneTransaction> done;
+        dramsys.ClockTicks(2 * tRC, done);
+
+        REQUIRE(done.size() == 1);
+        REQUIRE(done[0].cycle == static_cast<uint64_t>(tRC - 1));
+        REQUIRE(!done[0].is_write);
+        REQUIRE(!call_back_called);
+    }
+
+    SECTION("TEST same-cycle completions come back in channel order") {
+        uint64_t ch_stride = 1ull << (config.ch_pos + config.shift_bits);
+        dramsys.AddTransaction(3 * ch_stride, false);
+        dramsys.AddTransaction(1 * ch_stride, false);
+        std::vector<dramsim3::DoneTransaction> done;
+        dramsys.ClockTicks(2 * tRC, done);
+
+        REQUIRE(done.size() == 2);
+        REQUIRE(done[0].cycle == done[1].cycle);
+        REQUIRE(done[0].channel == 1);
+        REQUIRE(done[1].channel == 3);
+        REQUIRE(done[0].id == 1 * ch_stride);
+    }
+
+    SECTION("TEST bulk adds stop at the first refusal of a channel") {
+        uint64_t ch_stride = 1ull << (config.ch_pos + config.shift_bits);
+        uint64_t ch0_stride = ch_stride * config.channels;
+        std::vector<dramsim3::TransactionRequest> reqs;
+        // one more read than channel 0 holds, then a write it would take
+        for (int i = 0; i <= config.trans_queue_size; i++) {
+            reqs.push_back({i * ch0_stride, static_cast<uint64_t>(i), -1,
+                            false, false});
+        }
+        reqs.push_back({0, 100, -1, true, false});
+        reqs.push_back({2 * ch_stride, 101, -1, false, false});
+        size_t accepted = dramsys.AddTransactions(reqs.data(), reqs.size());
+
+        REQUIRE(accepted == static_cast<size_t>(config.trans_queue_size) + 1);
+        REQUIRE(reqs[config.trans_queue_size - 1].accepted);
+        REQUIRE(!reqs[config.trans_queue_size].accepted);
+        REQUIRE(!reqs[config.trans_queue_size + 1].accepted);
+        REQUIRE(reqs.back().accepted);
+        REQUIRE(!dramsys.WillAcceptTransaction(0, false));
+    }
+}
+
+TEST_CASE("Analytic DRAMSystem", "[dramsim3]") {
+    dramsim3::Config config("configs/HBM1_4Gb_x128.ini", ".");
+    config.memory_model = dramsim3::MemoryModel::ANALYTIC;
+
+    dramsim3::AnalyticDRAMSystem dramsys(config, ".", dummy_call_back,
+                                         dummy_call_back);
+    uint64_t col_stride = 1ull << (config.co_pos + config.shift_bits);
+    uint64_t row_stride = 1ull << (config.ro_pos + config.shift_bits);
+    std::vector<dramsim3::DoneTransaction> done;
+
+    SECTION("TEST a read to a closed bank takes tRCD + RL + burst") {
+        REQUIRE(dramsys.NextEventCycle() ==
+                std::numeric_limits<uint64_t>::max());
+        dramsys.AddTransaction(0, false);
+        uint64_t latency = config.tRCD + config.RL + config.burst_cycle;
+        REQUIRE(dramsys.LastReadModelLatency() == latency);
+        dramsys.ClockTicks(2 * latency, done);
+
+        REQUIRE(done.size() == 1);
+        REQUIRE(done[0].cycle == latency);
+        REQUIRE(!call_back_called);
+    }
+
+    SECTION("TEST row hits are faster than row conflicts") {
+        dramsys.AddTransaction(0, false);
+        dramsys.ClockTicks(1000, done);
+        dramsys.AddTransaction(col_stride, false);
+        uint64_t hit = dramsys.LastReadModelLatency();
+        dramsys.ClockTicks(1000, done);
+        dramsys.AddTransaction(row_stride, false);
+        uint64_t conflict = dramsys.LastReadModelLatency();
+
+        REQUIRE(hit == static_cast<uint64_t>(config.RL + config.burst_cycle));
+        REQUIRE(conflict >= hit + config.tRP + config.tRCD);
+    }
+
+    SECTION("TEST reads to a buffered write are forwarded") {
+        dramsys.AddTransaction(0, true);
+        dramsys.AddTransaction(0, false);
+        dramsys.ClockTicks(2, done);
+
+        REQUIRE(done.size() == 2);
+        REQUIRE(done[0].is_write);
+        REQUIRE(done[1].cycle == 1);
+    }
+}
+
+TEST_CASE("Analytic write buffer drains", "[dramsim3]") {
+    dramsim3::Config config("configs/HBM1_4Gb_x128.ini", ".");
+    config.memory_model = dramsim3::MemoryModel::ANALYTIC;
+    config.output_level = 0;
+    config.json_stats_name = "test_analytic_drain_stats.json";
+    config.write_high_watermark = 2;
+    config.write_low_watermark = 0;
+    config.write_idle_drain = config.trans_queue_size;
+    dramsim3::AnalyticDRAMSystem dramsys(config, ".", dummy_call_back,
+                                         dummy_call_back);
+    uint64_t line = config.request_size_bytes;
+    uint64_t col_stride = 1ull << (config.co_pos + config.shift_bits);
+    std::vector<dramsim3::DoneTransaction> done;
+
+    dramsys.AddTransaction(0, true);
+    dramsys.AddTransaction(line / 2, true);  // merges
+    // the second line of the channel reaches the high watermark, both
+    // lines are picked for a drain but don't issue before the next cycle
+    dramsys.AddTransaction(col_stride, true);
+    // the draining line is buffered anew instead of merging
+    dramsys.AddTransaction(0, true);
+    dramsys.ClockTicks(1000, done);
+    REQUIRE(done.size() == 4);
+
+    std::remove(config.json_stats_name.c_str());
+    dramsys.PrintStats();
+    std::ifstream in(config.json_stats_name);
+    auto stats = nlohmann::json::parse(in)["0"];
+    REQUIRE(stats["num_writes_done"] == 4);
+    REQUIRE(stats["num_write_coalesced"] == 1);
+    std::remove(config.json_stats_name.c_str());
+}
+
+TEST_CASE("Controller skip-ahead clocking", "[dramsim3]") {
+    dramsim3::Config config("configs/HBM1_4Gb_x128.ini", ".");
+    dramsim3::Timing timing(config);
+    dramsim3::Controller ctrl(0, config, timing);
+
+    SECTION("TEST idle controller skips to the next refresh") {
+        uint64_t refresh = ctrl.NextEventCycle();
+        REQUIRE(refresh > 0);
+        REQUIRE(ctrl.ClockTickUntil(refresh + 100) == refresh);
+        // a refresh is due now, nothing more to skip
+        REQUIRE(ctrl.ClockTickUntil(refresh + 100) == refresh);
+    }
+
+    SECTION("TEST queued work stops skipping") {
+        REQUIRE(ctrl.ClockTickUntil(5) == 5);
+        ctrl.AddTransaction(dramsim3::Transaction(0, false));
+        REQUIRE(ctrl.NextEventCycle() == 5);
+        REQUIRE(ctrl.ClockTickUntil(50) == 5);
+    }
+}
+
+TEST_CASE("Per-requester stats", "[dramsim3]") {
+    dramsim3::Config config("configs/HBM1_4Gb_x128.ini", ".");
+    config.num_requesters = 2;
+    config.output_level = 0;
+    config.json_stats_name = "test_requester_stats.json";
+    dramsim3::Timing timing(config);
+    dramsim3::Controller ctrl(0, config, timing);
+
+    // requester 1 reads the row requester 0 opened
+    uint64_t col_stride = 1ull << (config.co_pos + config.shift_bits);
+    dramsim3::Transaction first(0, false);
+    first.requester = 0;
+    dramsim3::Transaction second(col_stride, false);
+    second.requester = 1;
+    ctrl.AddTransaction(first);
+    ctrl.ClockTick();
+    ctrl.AddTransaction(second);
+    dramsim3::Transaction untracked(0, true);
+    ctrl.AddTransaction(untracked);
+    int done = 0;
+    dramsim3::Transaction trans;
+    for (uint64_t clk = 1; clk < 200 && done < 3; clk++) {
+        while (ctrl.ReturnDoneTrans(clk, trans)) {
+            done++;
+        }
+        ctrl.ClockTick();
+    }
+    REQUIRE(done == 3);
+
+    std::remove(config.json_stats_name.c_str());
+    ctrl.PrintFinalStats();
+    std::ifstream in(config.json_stats_name);
+    std::stringstream text;
+    text << "{" << in.rdbuf() << "}";
+    auto stats = nlohmann::json::parse(text.str())["0"];
+    REQUIRE(stats["requester_reads_done"]["0"] == 1);
+    REQUIRE(stats["requester_reads_done"]["1"] == 1);
+    REQUIRE(stats["requester_writes_done"]["0"] == 0);
+    REQUIRE(stats["requester_read_row_hits"]["0"] == 0);
+    REQUIRE(stats["requester_read_row_hits"]["1"] == 1);
+    REQUIRE(stats["requester_row_hit_rate"]["1"] == 1.0);
+    REQUIRE(stats["requester_slowdown"]["0"].get<double>() >= 1.0);
+    REQUIRE(stats["unfairness"].get<double>() >= 1.0);
+    std::remove(config.json_stats_name.c_str());
+}
+
+TEST_CASE("Write buffer coalescing and watermarks", "[dramsim3]") {
+    dramsim3::Config config("configs/HBM1_4Gb_x128.ini", ".");
+    config.output_level = 0;
+    config.json_stats_name = "test_write_buffer_stats.json";
+    config.write_high_watermark = 4;
+    config.write_low_watermark = 1;
+    config.write_idle_drain = config.trans_queue_size;
+    dramsim3::Timing timing(config);
+    dramsim3::Controller ctrl(0, config, timing);
+    uint64_t line = config.request_size_bytes;
+
+    ctrl.AddTransaction(dramsim3::Transaction(0, true));
+    // a partial write to the same line merges, a read of it is forwarded
+    ctrl.AddTransaction(dramsim3::Transaction(line / 2, true));
+    ctrl.AddTransaction(dramsim3::Transaction(line / 4, false));
+    // the fourth line reaches the high watermark
+    for (uint64_t i = 1; i < 4; i++) {
+        ctrl.AddTransaction(dramsim3::Transaction(i * line, true));
+    }
+    // two reads of one line take one burst
+    ctrl.AddTransaction(dramsim3::Transaction(10 * line, false));
+    ctrl.AddTransaction(dramsim3::Transaction(10 * line + 8, false));
+    dramsim3::Transaction trans;
+    int reads = 0;
+    for (uint64_t clk = 1; clk < 500; clk++) {
+        while (ctrl.ReturnDoneTrans(clk, trans)) {
+            reads += !trans.is_write;
+        }
+        ctrl.ClockTick();
+    }
+    REQUIRE(reads == 3);
+
+    std::remove(config.json_stats_name.c_str());
+    ctrl.PrintFinalStats();
+    std::ifstream in(config.json_stats_name);
+    std::stringstream text;
+    text << "{" << in.rdbuf() << "}";
+    auto stats = nlohmann::json::parse(text.str())["0"];
+    REQUIRE(stats["num_writes_done"] == 5);
+    REQUIRE(stats["num_write_coalesced"] == 1);
+    REQUIRE(stats["num_write_buf_hits"] == 1);
+    REQUIRE(stats["num_read_cmds"] == 1);
+    // drained down to the low watermark, the newest write stays buffered
+    REQUIRE(stats["num_write_cmds"] == 3);
+    std::remove(config.json_stats_name.c_str());
+}
+
+TEST_CASE("Scheduler policies", "[dramsim3]") {
+    dramsim3::Config config("configs/HBM1_4Gb_x128.ini", ".");
+    config.num_requesters = 2;
+    config.output_level = 0;
+    uint64_t row_stride = 1ull << (config.ro_pos + config.shift_bits);
+    auto read = [&](uint64_t addr, int requester) {
+        dramsim3::Command cmd(dramsim3::CommandType::READ,
+                              config.AddressMapping(addr), addr);
+        cmd.requester = requester;
+        return cmd;
+    };
+    auto r0 = read(0, 0), r1 = read(0, 1);
+
+    SECTION("TEST BLISS blacklists a streak until the next clear") {
+        config.scheduler = dramsim3::SchedulerPolicy::BLISS;
+        dramsim3::SimpleStats stats(config, 0);
+        dramsim3::BlissScheduler bliss(config, stats);
+        std::vector<dramsim3::CMDQueue> queues;
+        for (int i = 0; i < config.bliss_threshold; i++) {
+            REQUIRE(bliss.Priority(r0, i) == 0);
+            bliss.Served(r0, i);
+        }
+        REQUIRE(bliss.Priority(r0, 10) > bliss.Priority(r1, 10));
+        bliss.Update(queues, config.bliss_clear_interval);
+        REQUIRE(bliss.Priority(r0, config.bliss_clear_interval) == 0);
+    }
+
+    SECTION("TEST ATLAS favors the least attained service") {
+        config.scheduler = dramsim3::SchedulerPolicy::ATLAS;
+        dramsim3::SimpleStats stats(config, 0);
+        dramsim3::AtlasScheduler atlas(config, stats);
+        std::vector<dramsim3::CMDQueue> queues;
+        for (int i = 0; i < 10; i++) {
+            atlas.Served(r0, i);
+        }
+        atlas.Update(queues, config.atlas_quantum);
+        REQUIRE(atlas.Priority(r1, 0) < atlas.Priority(r0, 0));
+        // starving requests go first whatever their requester
+        REQUIRE(atlas.Priority(r0, config.atlas_starvation) == -1);
+    }
+
+    SECTION("TEST BATCH marks the oldest requests, shortest job first") {
+        config.scheduler = dramsim3::SchedulerPolicy::BATCH;
+        dramsim3::SimpleStats stats(config, 0);
+        dramsim3::BatchScheduler batch(config, stats);
+        std::vector<dramsim3::CMDQueue> queues(1);
+        for (int i = 0; i <= config.batch_cap; i++) {
+            queues[0].push_back(read(i * row_stride, 0));
+        }
+        queues[0].push_back(read(0, 1));
+        batch.Update(queues, 0);
+        REQUIRE(queues[0].front().marked);
+        REQUIRE(!queues[0][config.batch_cap].marked);
+        REQUIRE(queues[0].back().marked);
+        int first = batch.Priority(queues[0].front(), 0);
+        int unmarked = batch.Priority(queues[0][config.batch_cap], 0);
+        REQUIRE(batch.Priority(queues[0].back(), 0) < first);
+        REQUIRE(first < unmarked);
+        // no new batch until the marked ones are served
+        queues[0].push_back(read(0, 1));
+        batch.Update(queues, 1);
+        REQUIRE(!queues[0].back().marked);
+    }
+
+    SECTION("TEST every policy drains a contended bank") {
+        for (auto policy : {dramsim3::SchedulerPolicy::FRFCFS,
+                            dramsim3::SchedulerPolicy::FRFCFS_CAP,
+                            dramsim3::SchedulerPolicy::BLISS,
+                            dramsim3::SchedulerPolicy::ATLAS,
+                            dramsim3::SchedulerPolicy::BATCH}) {
+            config.scheduler = policy;
+            config.row_hit_cap = 2;
+            dramsim3::Timing timing(config);
+            dramsim3::Controller ctrl(0, config, timing);
+            // requester 0 streams one row, requester 1 wants another
+            uint64_t col_stride = 1ull << (config.co_pos + config.shift_bits);
+            int added = 0;
+            for (int i = 0; i < 8; i++) {
+                dramsim3::Transaction hit(i * col_stride, false);
+                hit.requester = 0;
+                dramsim3::Transaction miss(row_stride + i * col_stride, false);
+                miss.requester = 1;
+                added += ctrl.AddTransaction(hit);
+                added += ctrl.AddTransaction(miss);
+            }
+            int done = 0;
+            dramsim3::Transaction trans;
+            for (uint64_t clk = 1; clk < 2000 && done < added; clk++) {
+                while (ctrl.ReturnDoneTrans(clk, trans)) {
+                    done++;
+                }
+                ctrl.ClockTick();
+            }
+            REQUIRE(done == added);
+        }
+    }
+}
+
+TEST_CASE("Refresh postponement", "[dramsim3]") {
+    dramsim3::Config config("configs/HBM1_4Gb_x128.ini", ".");
+    config.refresh_postpone = 8;
+    dramsim3::Timing timing(config);
+    dramsim3::ChannelState channel_state(config, timing);
+    dramsim3::Refresh refresh(config, channel_state);
+    int interval = config.tREFI / config.ranks;
+    // stands in for the controller issuing the refreshes
+    auto issue_all = [&]() {
+        while (channel_state.IsRefreshWaiting()) {
+            for (int r = 0; r < config.ranks; r++) {
+                channel_state.RankNeedRefresh(r, false);
+            }
+        }
+    };
+
+    SECTION("TEST busy reads postpone up to eight refreshes") {
+        for (int i = 0; i <= 8 * interval; i++) {
+            refresh.ClockTick(true, false);
+        }
+        REQUIRE(refresh.Postponed() == 8);
+        REQUIRE(!channel_state.IsRefreshWaiting());
+        for (int i = 0; i < interval; i++) {
+            refresh.ClockTick(true, false);
+        }
+        // the ninth one cannot wait
+        REQUIRE(channel_state.IsRefreshWaiting());
+        issue_all();
+        refresh.ClockTick(false, false);
+        REQUIRE(refresh.Postponed() == 7);
+        REQUIRE(channel_state.IsRefreshWaiting());
+    }
+
+    SECTION("TEST idle cycles pull refreshes in spread over an interval") {
+        // the k-th goes (8 - k) / 9 of an interval before the first is due
+        uint64_t clk = 0;
+        for (int k = 0; k < 8; k++) {
+            uint64_t at = interval - interval * (8 - k) / 9;
+            REQUIRE(refresh.NextRefreshCycle() == at);
+            for (; clk <= at; clk++) {
+                refresh.ClockTick(false, true);
+            }
+            REQUIRE(refresh.PulledIn() == k + 1);
+            issue_all();
+        }
+        REQUIRE(refresh.NextRefreshCycle() ==
+                static_cast<uint64_t>(interval));
+        for (; clk <= static_cast<uint64_t>(interval); clk++) {
+            refresh.ClockTick(false, false);
+        }
+        REQUIRE(refresh.PulledIn() == 7);
+        REQUIRE(!channel_state.IsRefreshWaiting());
+        // with the budget spent one more only comes in late in the interval
+        REQUIRE(refresh.NextRefreshCycle() ==
+                static_cast<uint64_t>(2 * interval - interval / 9));
+    }
+}
+
+TEST_CASE("Pending transaction index", "[dramsim3]") {
+    dramsim3::PendingIndex index(4);
+
+    SECTION("TEST duplicates come back oldest first") {
+        dramsim3::Transaction a(64, false), b(64, false);
+        a.added_cycle = 1;
+        b.added_cycle = 2;
+        index.Insert(a);
+        index.Insert(b);
+        REQUIRE(index.Count(64) == 2);
+        REQUIRE(index.Front(64)->added_cycle == 1);
+        index.PopFront(64);
+        REQUIRE(index.Front(64)->added_cycle == 2);
+        index.PopFront(64);
+        REQUIRE(index.Front(64) == nullptr);
+        REQUIRE(index.Empty());
+    }
+
+    SECTION("TEST grows past the expected size and survives deletes") {
+        for (uint64_t i = 0; i < 100; i++) {
+            index.Insert(dramsim3::Transaction(i << 6, true));
+        }
+        for (uint64_t i = 0; i < 100; i += 2) {
+            index.PopFront(i << 6);
+        }
+        REQUIRE(index.Size() == 50);
+        for (uint64_t i = 0; i < 100; i++) {
+            REQUIRE(index.Count(i << 6) == i % 2);
+        }
+    }
+}
+
+TEST_CASE("Log-linear histogram", "[dramsim3]") {
+    dramsim3::LogLinearHistogram histo(4, 16);
+
+    SECTION("TEST small values are exact") {
+        for (uint64_t v = 1; v <= 10; v++) {
+            histo.Record(v);
+        }
+        REQUIRE(histo.Count() == 10);
+        REQUIRE(histo.Mean() == Approx(5.5));
+        REQUIRE(histo.ValueAtQuantile(0.5) == 5);
+        REQUIRE(histo.ValueAtQuantile(1.0) == 10);
+    }
+
+    SECTION("TEST large values keep bounded relative error") {
+        for (uint64_t v = 1000; v < 2000; v++) {
+            histo.Record(v);
+        }
+        // 8 sub-buckets per power of two: within 1/8 of the true value
+        uint64_t p50 = histo.ValueAtQuantile(0.5);
+        REQUIRE(p50 >= 1499);
+        REQUIRE(p50 <= 1499 + 1499 / 8);
+        REQUIRE(histo.ValueAtQuantile(1.0) == 1999);
+        REQUIRE(histo.Sum() == 1499500);
+    }
+
+    SECTION("TEST merge adds counts") {
+        dramsim3::LogLinearHistogram other(4, 16);
+        histo.Record(3);
+        other.Record(100000);
+        histo.Merge(other);
+        REQUIRE(histo.Count() == 2);
+        REQUIRE(histo.Min() == 3);
+        REQUIRE(histo.ValueAtQuantile(0.999) == 100000);
+    }
+}
+
+TEST_CASE("Buffered epoch writer", "[dramsim3]") {
+    using dramsim3::EpochWriter;
+    std::string file_name = "test_epoch_writer.tmp";
+    auto read_file = [&file_name]() {
+        std::ifstream in(file_name);
+        std::stringstream ss;
+        ss << in.rdbuf();
+        return ss.str();
+    };
+
+    SECTION("TEST json output is one array across flushes") {
+        {
+            // tiny flush size so every record goes through the flusher
+            EpochWriter writer(file_name, EpochWriter::Format::JSON, 4);
+            for (int i = 0; i < 3; i++) {
+                writer.Write(nlohmann::json{{"epoch_num", i}});
+            }
+        }
+        REQUIRE(read_file() ==
+                "[{\"epoch_num\":0},\n{\"epoch_num\":1},\n"
+                "{\"epoch_num\":2}]\n");
+    }
+
+    SECTION("TEST ndjson output has one record per line") {
+        EpochWriter writer(file_name, EpochWriter::Format::NDJSON, 4);
+        writer.Write(nlohmann::json{{"epoch_num", 0}});
+        writer.Write(nlohmann::json{{"epoch_num", 1}});
+        writer.Close();
+        REQUIRE(read_file() == "{\"epoch_num\":0}\n{\"epoch_num\":1}\n");
+    }
+    std::remove(file_name.c_str());
+}
+
+TEST_CASE("Binary trace round trip", "[dramsim3]") {
+    using dramsim3::Transaction;
+    std::string file_name = "test_binary_trace.tmp";
+    // backwards jumps in address and cycle need the zigzag deltas
+    std::vector<Transaction> records = {
+        Transaction(0x2000D5C0, false), Transaction(0x1FF96FC0, true),
+        Transaction(0xFFFFFFFFFFC0ull, false), Transaction(0x40, true)};
+    uint64_t cycles[] = {30, 160, 159, 1ull << 40};
+    {
+        dramsim3::BinaryTraceWriter writer(file_name);
+        for (size_t i = 0; i < records.size(); i++) {
+            writer.Append(records[i].addr, records[i].is_write, cycles[i]);
+        }
+    }
+    REQUIRE(dramsim3::BinaryTraceReader::IsBinaryTrace(file_name));
+
+    dramsim3::BinaryTraceReader reader(file_name);
+    REQUIRE(reader.NumRecords() == records.size());
+    Transaction trans;
+    for (size_t i = 0; i < records.size(); i++) {
+        REQUIRE(reader.Next(trans));
+        REQUIRE(trans.addr == records[i].addr);
+        REQUIRE(trans.is_write == records[i].is_write);
+        REQUIRE(trans.added_cycle == cycles[i]);
+    }
+    REQUIRE_FALSE(reader.Next(trans));
+    std::remove(file_name.c_str());
+}
+
+TEST_CASE("Command tracer", "[dramsim3]") {
+    using dramsim3::TraceRecord;
+    std::string file_name = "test_cmd_trace.tmp";
+    {
+        // a 4 record ring wraps and stalls the channel on the writer
+        dramsim3::CommandTracer tracer(file_name, 2, 4, 10, 100);
+        REQUIRE_FALSE(tracer.InWindow(9));
+        REQUIRE(tracer.InWindow(10));
+        REQUIRE_FALSE(tracer.InWindow(100));
+        dramsim3::Address addr(1, 0, 1, 2, 0x1234, 0x56);
+        dramsim3::Command cmd(dramsim3::CommandType::ACTIVATE, addr, 0x40);
+        for (uint64_t clk = 10; clk < 30; clk++) {
+            tracer.AddCommand(1, clk, cmd);
+        }
+        tracer.AddTransaction(0, 12, 0x80, true);
+    }
+
+    std::ifstream in(file_name, std::ifstream::binary);
+    char magic[sizeof(dramsim3::kCmdTraceMagic)];
+    REQUIRE(in.read(magic, sizeof(magic)));
+    REQUIRE(std::string(magic, sizeof(magic)) ==
+            std::string(dramsim3::kCmdTraceMagic, sizeof(magic)));
+    std::vector<TraceRecord> records;
+    TraceRecord record;
+    while (in.read(reinterpret_cast<char *>(&record), sizeof(record))) {
+        records.push_back(record);
+    }
+    REQUIRE(records.size() == 21);
+    uint64_t next_clk = 10;
+    for (const auto &r : records) {
+        if (r.channel == 0) {
+            REQUIRE(r.type == dramsim3::kTraceWrite);
+            REQUIRE(r.hex_addr == 0x80);
+            REQUIRE(r.clk == 12);
+            continue;
+        }
+        // the commands of a channel keep their order
+        REQUIRE(r.clk == next_clk++);
+        REQUIRE(r.type ==
+                static_cast<uint8_t>(dramsim3::CommandType::ACTIVATE));
+        REQUIRE(r.bankgroup == 1);
+        REQUIRE(r.bank == 2);
+        REQUIRE(r.row == 0x1234);
+        REQUIRE(r.column == 0x56);
+    }
+    in.close();
+    std::remove(file_name.c_str());
+}
+
+TEST_CASE("Config cache", "[dramsim3]") {
+    using dramsim3::Config;
+    std::string ini = "configs/HBM1_4Gb_x128.ini";
+    std::string cache_dir = "test_config_cache";
+    mkdir(cache_dir.c_str(), 0755);
+    auto cached_files = [&cache_dir]() {
+        std::vector<std::string> names;
+        DIR *dir = opendir(cache_dir.c_str());
+        while (dirent *entry = readdir(dir)) {
+            std::string name = entry->d_name;
+            if (name != "." && name != "..") {
+                names.push_back(cache_dir + "/" + name);
+            }
+        }
+        closedir(dir);
+        return names;
+    };
+
+    Config parsed(ini, ".");
+    Config copy(parsed);
+    REQUIRE(copy.Deserialize(parsed.Serialize()));
+    REQUIRE_FALSE(copy.Deserialize(parsed.Serialize().substr(0, 100)));
+
+    // the first load parses and leaves the blob, the second reads it
+    auto first = Config::Load(ini, ".", cache_dir);
+    REQUIRE(cached_files().size() == 1);
+    auto second = Config::Load(ini, "tests", cache_dir);
+    REQUIRE(second->Serialize() == parsed.Serialize());
+    REQUIRE(second->tRCD == parsed.tRCD);
+    REQUIRE(second->address_mapping == parsed.address_mapping);
+    REQUIRE(second->output_prefix == "tests/dramsim3");
+    REQUIRE(second->json_stats_name == "tests/dramsim3.json");
+
+    // a damaged blob is parsed over
+    std::string blob_name = cached_files()[0];
+    std::ofstream(blob_name) << "garbage";
+    auto third = Config::Load(ini, ".", cache_dir);
+    REQUIRE(third->Serialize() == parsed.Serialize());
+
+    auto shared = Config::Shared(ini, ".");
+    REQUIRE(Config::Shared(ini, ".") == shared);
+    REQUIRE(Config::Shared(ini, "tests") != shared);
+
+    for (const auto &name : cached_files()) {
+        std::remove(name.c_str());
+    }
+    rmdir(cache_dir.c_str());
 }
@@ -13,11 +13,12 @@ private:
     size_t size;                      // 数据大小
     std::vector<uint32_t> data;        // 数据内容
     bool is_write;                     // 是否为写操作
+    int requester;                     // 发起请求的上游编号，-1 表示未标记
 
 public:
     // 构造函数
     DataPacket(addr_t a =0 , size_t s =0 , bool read = true) 
-        : addr(a), size(s), is_write(read) {}
+        : addr(a), size(s), is_write(read), requester(-1) {}
     
     // 析构函数
     ~DataPacket() = default;
@@ -46,6 +47,9 @@ public:
     void setWrite(addr_t _is_write) { is_write = _is_write; }
     // 设置大小
     void setSize(size_t s) { size = s; }
+    // 获取/设置请求者编号，DRAMsim3 按它统计每个请求者的延迟和带宽
+    int getRequester() const { return requester; }
+    void setRequester(int r) { requester = r; }
 };
 
 // 简单的指针类型
@@ -0,0 +1,390 @@
+#include "dram/addr_mapper.h"
+#include <algorithm>
+#include <iomanip>
+#include <stdexcept>
+
+namespace GNN {
+
+AddrMapper::AddrMapper(const std::string &_name, dramsim3_wrapper *wrapper_,
+                       int num_channels_, int num_upstreams_,
+                       int num_up_ports_, InterleaveMode mode_)
+    : SimObject(_name), wrapper(wrapper_), num_channels(num_channels_),
+      num_upstreams(num_upstreams_), num_up_ports(num_up_ports_),
+      mode(mode_), hash_bank(true), numRemapped(0) {
+  // 第一步：读取 DRAMsim3 的地址布局
+  loadLayout();
+  defaultPaeMasks();
+
+  // 第二步：创建端口
+  upPorts.resize(num_up_ports);
+  for (int p = 0; p < num_up_ports; p++) {
+    upPorts[p].reserve(num_upstreams);
+    for (int up = 0; up < num_upstreams; up++) {
+      std::string port_name = _name + ".up_side" + std::to_string(p) + "_" +
+                              std::to_string(up);
+      upPorts[p].emplace_back(port_name, *this, p, up);
+    }
+  }
+  memPorts.resize(num_channels);
+  for (int ch = 0; ch < num_channels; ch++) {
+    memPorts[ch].reserve(num_upstreams);
+    for (int up = 0; up < num_upstreams; up++) {
+      std::string port_name = _name + ".mem_side" + std::to_string(ch) + "_" +
+                              std::to_string(up);
+      memPorts[ch].emplace_back(port_name, *this, ch, up);
+    }
+  }
+
+  // 第三步：重试记录与统计
+  reqBlocked.assign(num_channels,
+                    std::vector<std::deque<int>>(num_upstreams));
+  respBlocked.assign(num_up_ports,
+                     std::vector<std::deque<int>>(num_upstreams));
+  channelHist.assign(num_channels, 0);
+  bankHist.assign(1 << (bgField.width + baField.width), 0);
+}
+
+void AddrMapper::loadLayout() {
+  const dramsim3::Config &config = wrapper->get_config();
+  shift_bits = config.shift_bits;
+  auto width = [](uint64_t mask) {
+    int w = 0;
+    while (mask) {
+      w++;
+      mask >>= 1;
+    }
+    return w;
+  };
+  chField = {config.ch_pos, width(config.ch_mask), {}, 0};
+  bgField = {config.bg_pos, width(config.bg_mask), {}, 0};
+  baField = {config.ba_pos, width(config.ba_mask), {}, 0};
+  roField = {config.ro_pos, width(config.ro_mask), {}, 0};
+  coField = {config.co_pos, width(config.co_mask), {}, 0};
+  // XOR_HASH 默认与整个行地址折叠
+  chField.xorSrc = bgField.xorSrc = baField.xorSrc = fieldMask(roField);
+
+  // 通道端口与 DRAMsim3 通道一一对应，否则请求会被路由到不存在的端口
+  if ((1 << chField.width) != num_channels) {
+    throw std::invalid_argument(
+        "通道数不一致: DRAMsim3 channels=" +
+        std::to_string(1 << chField.width) +
+        ", 端口数=" + std::to_string(num_channels));
+  }
+}
+
+void AddrMapper::setAddressRange(addr_t bytes) {
+  // 范围以外的地址位恒为 0，只折叠范围内会变化的位；
+  // bank 字段混入通道位，让各通道的同一行落到不同 bank
+  int bits = 0;
+  while (bits < 64 && (1ull << bits) < bytes) {
+    bits++;
+  }
+  bits -= shift_bits;
+  uint64_t in_range = bits >= 64 ? ~0ull : bits <= 0 ? 0 : (1ull << bits) - 1;
+  uint64_t row_col = (fieldMask(roField) | fieldMask(coField)) & in_range;
+  chField.xorSrc = row_col;
+  bgField.xorSrc = (row_col | fieldMask(chField)) & in_range;
+  baField.xorSrc = bgField.xorSrc;
+}
+
+void AddrMapper::defaultPaeMasks() {
+  // 默认 PAE 掩码：目标字段第 i 位与行地址中 (j % width == i) 的各位异或；
+  // 通道字段额外混入列地址位，打散 GNN 特征按固定步长访问造成的通道热点
+  auto build = [this](Field &field, bool with_column) {
+    field.masks.assign(field.width, 0);
+    for (int i = 0; i < field.width; i++) {
+      for (int j = i; j < roField.width; j += field.width) {
+        field.masks[i] |= 1ull << (roField.pos + j);
+      }
+      if (with_column) {
+        for (int j = i; j < coField.width; j += field.width) {
+          field.masks[i] |= 1ull << (coField.pos + j);
+        }
+      }
+      field.masks[i] &= ~fieldMask(field);
+    }
+  };
+  build(chField, true);
+  build(bgField, false);
+  build(baField, false);
+}
+
+uint64_t AddrMapper::fieldMask(const Field &field) {
+  return ((1ull << field.width) - 1) << field.pos;
+}
+
+void AddrMapper::setMasks(Field &field, const std::vector<uint64_t> &masks) {
+  field.masks.assign(field.width, 0);
+  for (int i = 0; i < field.width && i < (int)masks.size(); i++) {
+    // 屏蔽目标字段自身，保证重映射仍是双射
+    field.masks[i] = masks[i] & ~fieldMask(field);
+  }
+}
+
+void AddrMapper::setChannelHashMasks(const std::vector<uint64_t> &masks) {
+  setMasks(chField, masks);
+}
+
+void AddrMapper::setBankHashMasks(const std::vector<uint64_t> &masks) {
+  setMasks(baField, masks);
+}
+
+void AddrMapper::setBankgroupHashMasks(const std::vector<uint64_t> &masks) {
+  setMasks(bgField, masks);
+}
+
+uint64_t AddrMapper::foldXor(uint64_t value, int width) {
+  if (width <= 0) {
+    return 0;
+  }
+  uint64_t mask = (1ull << width) - 1;
+  uint64_t result = 0;
+  while (value) {
+    result ^= value & mask;
+    value >>= width;
+  }
+  return result;
+}
+
+uint64_t AddrMapper::gatherBits(uint64_t value, uint64_t mask) {
+  // 把 mask 选中的位依次压到低位
+  uint64_t result = 0;
+  int out = 0;
+  for (; mask; mask &= mask - 1) {
+    int bit = __builtin_ctzll(mask);
+    result |= ((value >> bit) & 1) << out++;
+  }
+  return result;
+}
+
+int AddrMapper::parity(uint64_t value) {
+  return __builtin_parityll(value);
+}
+
+uint64_t AddrMapper::hashField(uint64_t addr, const Field &field) const {
+  if (field.width == 0) {
+    return 0;
+  }
+  if (mode == InterleaveMode::XOR_HASH) {
+    // 置换交织：字段与源地址位（默认为行地址）折叠后的值异或
+    return foldXor(gatherBits(addr, field.xorSrc), field.width);
+  }
+  // PAE：每一位独立选取一组地址位求奇偶
+  uint64_t hash = 0;
+  for (int i = 0; i < field.width; i++) {
+    hash |= (uint64_t)parity(addr & field.masks[i]) << i;
+  }
+  return hash;
+}
+
+addr_t AddrMapper::remap(addr_t addr) const {
+  if (mode == InterleaveMode::BIT_SLICE) {
+    return addr;
+  }
+  // 只改写字段位，低 shift_bits 位（请求内偏移）保持不变
+  uint64_t offset = addr & ((1ull << shift_bits) - 1);
+  uint64_t a = addr >> shift_bits;
+  // 每个字段只异或“其他位”的函数，逐个字段应用仍保持双射
+  a ^= hashField(a, chField) << chField.pos;
+  if (hash_bank) {
+    a ^= hashField(a, bgField) << bgField.pos;
+    a ^= hashField(a, baField) << baField.pos;
+  }
+  return (a << shift_bits) | offset;
+}
+
+addr_t AddrMapper::unmap(addr_t mapped_addr) const {
+  if (mode == InterleaveMode::BIT_SLICE) {
+    return mapped_addr;
+  }
+  // 每一步都是对合（异或的源位不在目标字段内），逆序再做一遍即可还原
+  uint64_t offset = mapped_addr & ((1ull << shift_bits) - 1);
+  uint64_t a = mapped_addr >> shift_bits;
+  if (hash_bank) {
+    a ^= hashField(a, baField) << baField.pos;
+    a ^= hashField(a, bgField) << bgField.pos;
+  }
+  a ^= hashField(a, chField) << chField.pos;
+  return (a << shift_bits) | offset;
+}
+
+int AddrMapper::route(addr_t mapped_addr) const {
+  // 通道号以 DRAMsim3 的真实映射为准
+  return wrapper->get_channel(mapped_addr);
+}
+
+void AddrMapper::init() {
+  for (int p = 0; p < num_up_ports; p++) {
+    for (int up = 0; up < num_upstreams; up++) {
+      if (!upPorts[p][up].isConnected()) {
+        D_WARN("ADDR_MAP", "上游端口未连接: %s",
+               upPorts[p][up].name().c_str());
+      }
+    }
+  }
+  D_INFO("ADDR_MAP", "模式=%d, ch[pos=%d,w=%d] bg[pos=%d,w=%d] ba[pos=%d,w=%d]",
+         (int)mode, chField.pos, chField.width, bgField.pos, bgField.width,
+         baField.pos, baField.width);
+}
+
+Port &AddrMapper::getPort(const std::string &if_name, int idx) {
+  // 上游侧端口：格式为 "up_side<port>_<upstream>"
+  if (if_name.find("up_side") == 0) {
+    return parsePortName(if_name, 7, true);
+  }
+  // 存储侧端口：格式为 "mem_side<channel>_<upstream>"
+  if (if_name.find("mem_side") == 0) {
+    return parsePortName(if_name, 8, false);
+  }
+  throw std::runtime_error("未知端口名: " + if_name);
+}
+
+Port &AddrMapper::parsePortName(const std::string &if_name,
+                                size_t prefix_len, bool up_side) {
+  int first = -1;
+  int up = 0;
+  try {
+    size_t next = if_name.find('_', prefix_len);
+    first = std::stoi(if_name.substr(
+        prefix_len,
+        next == std::string::npos ? std::string::npos : next - prefix_len));
+    if (next != std::string::npos) {
+      up = std::stoi(if_name.substr(next + 1));
+    }
+  } catch (...) {
+    throw std::runtime_error("端口名格式错误: " + if_name);
+  }
+
+  int limit = up_side ? num_up_ports : num_channels;
+  if (first >= 0 && first < limit && up >= 0 && up < num_upstreams) {
+    if (up_side) {
+      return upPorts[first][up];
+    }
+    return memPorts[first][up];
+  }
+  throw std::runtime_error("端口索引超出范围: " + if_name);
+}
+
+bool AddrMapper::recvTimingReq(PacketPtr pkt, int port_id, int upstream_id) {
+  assert(port_id >= 0 && port_id < num_up_ports);
+  assert(upstream_id >= 0 && upstream_id < num_upstreams);
+
+  addr_t orig_addr = pkt->getAddr();
+  addr_t mapped_addr = remap(orig_addr);
+  int ch = route(mapped_addr);
+  assert(ch >= 0 && ch < num_channels); // 构造时已校验通道数
+
+  // 读请求需要在响应时找回来源，先登记（写请求下游不返回响应）
+  bool is_read = pkt->isRead();
+  if (is_read) {
+    origins[pkt] = {port_id, orig_addr};
+  }
+  pkt->setAddr(mapped_addr);
+  // 中间经过片上互连时 DramArb 看不到上游编号，在此标记请求者
+  pkt->setRequester(upstream_id);
+
+  if (memPorts[ch][upstream_id].sendTimingReq(pkt)) {
+    D_DEBUG("ADDR_MAP", "转发请求: addr=%d -> %d, port=%d, ch=%d, upstream=%d",
+            orig_addr, mapped_addr, port_id, ch, upstream_id);
+    ++channelHist[ch];
+    dramsim3::Address fields = wrapper->get_config().AddressMapping(mapped_addr);
+    ++bankHist[(fields.bankgroup << baField.width) | fields.bank];
+    if (mapped_addr != orig_addr) {
+      ++numRemapped;
+    }
+    return true;
+  }
+
+  // 下游拒绝：恢复原地址，记录该上游端口等待此通道的重试
+  if (is_read) {
+    origins.erase(pkt);
+  }
+  pkt->setAddr(orig_addr);
+  auto &waiters = reqBlocked[ch][upstream_id];
+  if (std::find(waiters.begin(), waiters.end(), port_id) == waiters.end()) {
+    waiters.push_back(port_id);
+  }
+  return false;
+}
+
+bool AddrMapper::recvTimingResp(PacketPtr pkt, int channel_id,
+                                int upstream_id) {
+  auto it = origins.find(pkt);
+  assert(it != origins.end());
+  Origin origin = it->second;
+
+  // 上游看到的是原始地址
+  addr_t mapped_addr = pkt->getAddr();
+  pkt->setAddr(origin.addr);
+  if (upPorts[origin.port_id][upstream_id].sendTimingResp(pkt)) {
+    origins.erase(it);
+    return true;
+  }
+
+  // 上游拒绝：DramArb 会阻塞这个队列，等待上游重试后再发
+  pkt->setAddr(mapped_addr);
+  auto &waiters = respBlocked[origin.port_id][upstream_id];
+  if (std::find(waiters.begin(), waiters.end(), channel_id) == waiters.end()) {
+    waiters.push_back(channel_id);
+  }
+  return false;
+}
+
+void AddrMapper::handleReqRetry(int channel_id, int upstream_id) {
+  // 先取出等待者：上游在 sendRetryReq 中可能立即重发并再次被拒绝
+  std::deque<int> waiters;
+  waiters.swap(reqBlocked[channel_id][upstream_id]);
+  for (int port_id : waiters) {
+    upPorts[port_id][upstream_id].sendRetryReq();
+  }
+}
+
+void AddrMapper::handleRespRetry(int port_id, int upstream_id) {
+  std::deque<int> waiters;
+  waiters.swap(respBlocked[port_id][upstream_id]);
+  for (int channel_id : waiters) {
+    memPorts[channel_id][upstream_id].sendRetryResp();
+  }
+}
+
+void AddrMapper::printStats(std::ostream &os) const {
+  uint64_t total = 0;
+  uint64_t max_cnt = 0;
+  for (auto cnt : channelHist) {
+    total += cnt;
+    max_cnt = std::max(max_cnt, cnt);
+  }
+  double mean = num_channels ? (double)total / num_channels : 0.0;
+
+  os << "---- AddrMapper channel balance ----" << std::endl;
+  for (int ch = 0; ch < num_channels; ch++) {
+    double pct = total ? 100.0 * channelHist[ch] / total : 0.0;
+    os << "  ch" << std::setw(2) << ch << " " << std::setw(10)
+       << channelHist[ch] << " " << std::fixed << std::setprecision(1)
+       << std::setw(5) << pct << "% "
+       << std::string(static_cast<size_t>(pct / 2), '#') << std::endl;
+  }
+  os << "  requests=" << total << " remapped=" << numRemapped
+     << " imbalance(max/mean)=" << std::setprecision(3)
+     << (mean > 0 ? max_cnt / mean : 0.0) << std::endl;
+  os << "  banks used=" << banksUsed() << "/" << numBanks()
+     << " bank histogram:";
+  for (auto cnt : bankHist) {
+    os << " " << cnt;
+  }
+  os << std::defaultfloat << std::endl;
+}
+
+int AddrMapper::banksUsed() const {
+  return static_cast<int>(
+      std::count_if(bankHist.begin(), bankHist.end(),
+                    [](uint64_t cnt) { return cnt > 0; }));
+}
+
+void AddrMapper::resetStats() {
+  std::fill(channelHist.begin(), channelHist.end(), 0);
+  std::fill(bankHist.begin(), bankHist.end(), 0);
+  numRemapped = 0;
+}
+
+} // namespace GNN
@@ -0,0 +1,153 @@
+#ifndef ADDR_MAPPER_H
+#define ADDR_MAPPER_H
+
+#include "common/debug.h"
+#include "common/object.h"
+#include "common/packet.h"
+#include "common/port.h"
+#include "dram/dramsim3_wrapper.h"
+#include "event/eventq.h"
+#include <deque>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace GNN {
+
+// 地址交织/哈希单元：位于上游 buffer 与 DramArb 之间。
+// 对每个请求先做地址重映射（可选 XOR 哈希 / PAE 风格置换），再按
+// DRAMsim3 真实的地址映射（GetChannel）选择通道端口，保证 DramArb 的
+// bank 下标与 DRAMsim3 的通道一致。响应返回时恢复原始地址并送回原端口。
+class AddrMapper : public SimObject {
+public:
+  enum class InterleaveMode {
+    BIT_SLICE, // 不重映射，直接使用 DRAMsim3 配置中的位切片
+    XOR_HASH,  // 通道/bank 字段与行地址折叠异或（置换交织）
+    PAE        // 通道/bank 的每一位与一组可配置地址位异或（PAE 风格）
+  };
+
+  AddrMapper(const std::string &_name, dramsim3_wrapper *wrapper_,
+             int num_channels_, int num_upstreams_, int num_up_ports_,
+             InterleaveMode mode_ = InterleaveMode::BIT_SLICE);
+  void init() override;
+  Port &getPort(const std::string &if_name, int idx = -1) override;
+
+  // PAE 掩码：masks[i] 为参与目标字段第 i 位异或的地址位（按 DRAMsim3
+  // 去掉 shift_bits 后的地址计），目标字段自身的位会被自动屏蔽
+  void setChannelHashMasks(const std::vector<uint64_t> &masks);
+  void setBankHashMasks(const std::vector<uint64_t> &masks);
+  void setBankgroupHashMasks(const std::vector<uint64_t> &masks);
+  // 是否同时对 bankgroup/bank 字段做哈希（默认开启）
+  void setHashBank(bool enable) { hash_bank = enable; }
+  // 访问的地址范围 [0, bytes)。XOR_HASH 默认折叠整个行地址，范围够不到行地址时
+  // 哈希不起作用；设置后改为折叠范围内的行/列地址位，bank 字段再混入通道位
+  void setAddressRange(addr_t bytes);
+
+  // 地址重映射（双射）及其逆映射，以及重映射后地址所在的通道
+  addr_t remap(addr_t addr) const;
+  addr_t unmap(addr_t mapped_addr) const;
+  int route(addr_t mapped_addr) const;
+
+  // 通道均衡直方图
+  void printStats(std::ostream &os) const;
+  void resetStats();
+  // 有流量的 (bankgroup, bank) 数与总数
+  int banksUsed() const;
+  int numBanks() const { return static_cast<int>(bankHist.size()); }
+
+  // 上游侧端口：上游 buffer 的请求端口绑定于此
+  class UpSidePort : public ResponsePort {
+    AddrMapper &mapper;
+    int port_id;
+    int upstream_id;
+
+  public:
+    UpSidePort(const std::string &name, AddrMapper &_mapper, int _port_id,
+               int _up_id)
+        : ResponsePort(name), mapper(_mapper), port_id(_port_id),
+          upstream_id(_up_id) {}
+    bool recvTimingReq(PacketPtr pkt) override {
+      return mapper.recvTimingReq(pkt, port_id, upstream_id);
+    }
+    void recvRespRetry() override {
+      mapper.handleRespRetry(port_id, upstream_id);
+    }
+  };
+  // 存储侧端口：绑定到 DramArb 的 response<ch>_<up>
+  class MemSidePort : public RequestPort {
+    AddrMapper &mapper;
+    int channel_id;
+    int upstream_id;
+
+  public:
+    MemSidePort(const std::string &name, AddrMapper &_mapper, int _ch_id,
+                int _up_id)
+        : RequestPort(name), mapper(_mapper), channel_id(_ch_id),
+          upstream_id(_up_id) {}
+    bool recvTimingResp(PacketPtr pkt) override {
+      return mapper.recvTimingResp(pkt, channel_id, upstream_id);
+    }
+    void recvReqRetry() override {
+      mapper.handleReqRetry(channel_id, upstream_id);
+    }
+  };
+
+  std::vector<std::vector<UpSidePort>> upPorts;   // [up_port][upstream]
+  std::vector<std::vector<MemSidePort>> memPorts; // [channel][upstream]
+
+  bool recvTimingReq(PacketPtr pkt, int port_id, int upstream_id);
+  bool recvTimingResp(PacketPtr pkt, int channel_id, int upstream_id);
+  void handleReqRetry(int channel_id, int upstream_id);
+  void handleRespRetry(int port_id, int upstream_id);
+
+private:
+  // 读请求的来源：上游端口号与原始地址
+  struct Origin {
+    int port_id;
+    addr_t addr;
+  };
+
+  dramsim3_wrapper *wrapper;
+  int num_channels;
+  int num_upstreams;
+  int num_up_ports;
+  InterleaveMode mode;
+  bool hash_bank;
+
+  // DRAMsim3 地址字段布局（去掉 shift_bits 之后）
+  struct Field {
+    int pos;
+    int width;
+    std::vector<uint64_t> masks; // PAE 模式下每一位的异或源
+    uint64_t xorSrc;             // XOR_HASH 模式下折叠的地址位
+  };
+  int shift_bits;
+  Field chField, bgField, baField, roField, coField;
+
+  std::unordered_map<PacketPtr, Origin> origins;
+  // 被下游拒绝而等待重试的上游端口：[channel][upstream] -> up_port 列表
+  std::vector<std::vector<std::deque<int>>> reqBlocked;
+  // 被上游拒绝而等待重试的通道：[up_port][upstream] -> channel 列表
+  std::vector<std::vector<std::deque<int>>> respBlocked;
+
+  // 统计
+  std::vector<uint64_t> channelHist;
+  std::vector<uint64_t> bankHist;
+  uint64_t numRemapped;
+
+  void loadLayout();
+  void defaultPaeMasks();
+  static uint64_t fieldMask(const Field &field);
+  void setMasks(Field &field, const std::vector<uint64_t> &masks);
+  uint64_t hashField(uint64_t addr, const Field &field) const;
+  static uint64_t foldXor(uint64_t value, int width);
+  static uint64_t gatherBits(uint64_t value, uint64_t mask);
+  static int parity(uint64_t value);
+  Port &parsePortName(const std::string &if_name, size_t prefix_len,
+                      bool up_side);
+};
+
+} // namespace GNN
+
+#endif
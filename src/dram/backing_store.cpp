@@ -0,0 +1,130 @@
+#include "dram/backing_store.h"
+#include "common/debug.h"
+#include <algorithm>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace GNN {
+
+BackingStore::~BackingStore() { unloadImage(); }
+
+bool BackingStore::loadImage(const std::string &path, addr_t base) {
+  unloadImage();
+  int fd = ::open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    D_ERROR("BACKING", "无法打开镜像文件: %s", path.c_str());
+    return false;
+  }
+  struct stat st;
+  if (::fstat(fd, &st) != 0 || st.st_size == 0) {
+    D_ERROR("BACKING", "镜像文件为空或无法读取: %s", path.c_str());
+    ::close(fd);
+    return false;
+  }
+  // 私有只读映射：只有被访问到的页才会真正读入内存
+  void *p = ::mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  ::close(fd);
+  if (p == MAP_FAILED) {
+    D_ERROR("BACKING", "mmap 失败: %s", path.c_str());
+    return false;
+  }
+  image = static_cast<const uint8_t *>(p);
+  imageBytes = st.st_size;
+  imageBase = base;
+  D_INFO("BACKING", "加载镜像 %s: base=%d, size=%d", path.c_str(), base,
+         imageBytes);
+  return true;
+}
+
+void BackingStore::unloadImage() {
+  if (image) {
+    ::munmap(const_cast<uint8_t *>(image), imageBytes);
+    image = nullptr;
+    imageBytes = 0;
+  }
+}
+
+void BackingStore::readImage(addr_t addr, uint8_t *dst, size_t size) const {
+  std::memset(dst, 0, size);
+  if (!image || addr + size <= imageBase || addr >= imageBase + imageBytes) {
+    return;
+  }
+  addr_t begin = std::max(addr, imageBase);
+  addr_t end = std::min<addr_t>(addr + size, imageBase + imageBytes);
+  std::memcpy(dst + (begin - addr), image + (begin - imageBase), end - begin);
+}
+
+BackingStore::Page &BackingStore::touch(uint64_t page_no) {
+  auto &page = pages[page_no];
+  if (!page) {
+    // 第一次写入：分配页，并用镜像内容（或 0）初始化
+    page.reset(new Page);
+    readImage(page_no * kPageBytes, page->data(), kPageBytes);
+  }
+  return *page;
+}
+
+void BackingStore::read(addr_t addr, void *dst, size_t size) const {
+  addr = backingAddr(addr);
+  uint8_t *out = static_cast<uint8_t *>(dst);
+  bytesRead += size;
+  // 逐页拷贝，访问可能跨页
+  while (size > 0) {
+    uint64_t page_no = addr / kPageBytes;
+    size_t offset = addr % kPageBytes;
+    size_t chunk = std::min(size, kPageBytes - offset);
+    auto it = pages.find(page_no);
+    if (it != pages.end()) {
+      std::memcpy(out, it->second->data() + offset, chunk);
+    } else {
+      readImage(addr, out, chunk);
+    }
+    addr += chunk;
+    out += chunk;
+    size -= chunk;
+  }
+}
+
+void BackingStore::write(addr_t addr, const void *src, size_t size) {
+  addr = backingAddr(addr);
+  const uint8_t *in = static_cast<const uint8_t *>(src);
+  bytesWritten += size;
+  while (size > 0) {
+    uint64_t page_no = addr / kPageBytes;
+    size_t offset = addr % kPageBytes;
+    size_t chunk = std::min(size, kPageBytes - offset);
+    std::memcpy(touch(page_no).data() + offset, in, chunk);
+    addr += chunk;
+    in += chunk;
+    size -= chunk;
+  }
+}
+
+void BackingStore::fillPacket(PacketPtr pkt) const {
+  size_t size = pkt->getSize();
+  std::vector<uint32_t> data((size + sizeof(uint32_t) - 1) / sizeof(uint32_t));
+  read(pkt->getAddr(), data.data(), size);
+  pkt->setData(data);
+}
+
+void BackingStore::commitPacket(PacketPtr pkt) {
+  commit(pkt->getAddr(), pkt->get_data());
+}
+
+void BackingStore::commit(addr_t addr, const std::vector<uint32_t> &data) {
+  // 写包的负载就是要写入的全部数据
+  write(addr, data.data(), data.size() * sizeof(uint32_t));
+}
+
+void BackingStore::printStats(std::ostream &os) const {
+  os << "---- BackingStore ----" << std::endl;
+  os << "  touched pages=" << pages.size() << " resident="
+     << residentBytes() / 1024 << "KiB image=" << imageBytes / 1024
+     << "KiB read=" << bytesRead << "B written=" << bytesWritten << "B"
+     << std::endl;
+}
+
+} // namespace GNN
@@ -0,0 +1,75 @@
+#ifndef BACKING_STORE_H
+#define BACKING_STORE_H
+
+#include "common/common.h"
+#include "common/packet.h"
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+
+namespace GNN {
+
+// 稀疏的功能性后备存储：按 4KiB 页组织，页在第一次写入时才分配，
+// 内存占用只与实际写过的数据量成正比。可选地把特征/权重镜像文件
+// 以只读方式 mmap 到某个基地址，读未写过的页时直接取镜像内容，
+// 第一次写入时把对应镜像页拷贝成私有页（写时复制）。
+// 从未写过、也不在镜像内的地址读出全 0。
+class BackingStore {
+public:
+  static constexpr size_t kPageBytes = 4096;
+
+  BackingStore() = default;
+  ~BackingStore();
+  BackingStore(const BackingStore &) = delete;
+  BackingStore &operator=(const BackingStore &) = delete;
+
+  // 把镜像文件映射到 [base, base + 文件大小)，失败返回 false
+  bool loadImage(const std::string &path, addr_t base = 0);
+  void unloadImage();
+
+  // 存储按“未经交织的原始地址”组织；若请求在到达 DRAM 前被重映射，
+  // 在这里注册逆映射（如 AddrMapper::unmap），保证镜像内容对得上
+  void setAddrTranslator(std::function<addr_t(addr_t)> fn) { translate = fn; }
+
+  void read(addr_t addr, void *dst, size_t size) const;
+  void write(addr_t addr, const void *src, size_t size);
+
+  // 读完成时填充数据包负载（getSize() 字节）；写完成时提交负载
+  void fillPacket(PacketPtr pkt) const;
+  void commitPacket(PacketPtr pkt);
+  void commit(addr_t addr, const std::vector<uint32_t> &data);
+
+  size_t touchedPages() const { return pages.size(); }
+  size_t residentBytes() const { return pages.size() * kPageBytes; }
+  void printStats(std::ostream &os) const;
+
+private:
+  using Page = std::array<uint8_t, kPageBytes>;
+
+  std::unordered_map<uint64_t, std::unique_ptr<Page>> pages; // 页号 -> 页
+  std::function<addr_t(addr_t)> translate;
+
+  // mmap 的镜像
+  const uint8_t *image = nullptr;
+  size_t imageBytes = 0;
+  addr_t imageBase = 0;
+
+  // 统计
+  mutable uint64_t bytesRead = 0;
+  uint64_t bytesWritten = 0;
+
+  addr_t backingAddr(addr_t addr) const {
+    return translate ? translate(addr) : addr;
+  }
+  Page &touch(uint64_t page_no);
+  // 从镜像拷贝 [addr, addr + size)，镜像之外的部分填 0
+  void readImage(addr_t addr, uint8_t *dst, size_t size) const;
+};
+
+} // namespace GNN
+
+#endif
@@ -1,10 +1,12 @@
 #include "dram_arb.h"
+#include <algorithm>
 #include <iostream>
 #include <stdexcept>
 
 namespace GNN {
 
-DramArb::DramArb(const std::string &_name, int buf_size_, int num_upstreams_)
+DramArb::DramArb(const std::string &_name, int buf_size_, int num_upstreams_,
+                 int resp_per_cycle_)
     : SimObject(_name), 
       buf_size(buf_size_),
       num_upstreams(num_upstreams_),
@@ -13,9 +15,15 @@ DramArb::DramArb(const std::string &_name, int buf_size_, int num_upstreams_)
       sendResponseEvent([this] { sendResponse(); }, _name + ".sendResponseEvent"),
       // 轮询指针：每个bank的读写轮询起点
       rrReadIdx(num_banks, 0),
-      rrWriteIdx(num_banks, 0) {
+      rrWriteIdx(num_banks, 0),
+      // 响应返回路径：每个上游链路的预算与 bank 轮询起点
+      resp_per_cycle(resp_per_cycle_),
+      respBudgetTick(0),
+      respSentUp(num_upstreams_, 0),
+      rrRespBank(num_upstreams_, 0) {
   
-  D_INFO("DRAM_ARB", "DramArb构造函数: num_upstreams=%d", num_upstreams);
+  D_INFO("DRAM_ARB", "DramArb构造函数: num_upstreams=%d, resp_per_cycle=%d",
+         num_upstreams, resp_per_cycle);
   
   // 第一步：初始化基本状态
   initializeBasicState();
@@ -31,6 +39,7 @@ void DramArb::initializeBasicState() {
   // 初始化每个bank的读请求计数
   for (int bank = 0; bank < num_banks; bank++) {
     nbrOutstandingReads[bank] = 0;
+    nbrQueuedResps[bank] = 0;
   }
   
   // 初始化每个bank每个上游的重试标志
@@ -46,10 +55,12 @@ void DramArb::allocateInputBuffers() {
   // 为每个bank分配读缓冲区（每个上游一个队列）
   readInBufs.resize(num_banks);
   writeInBufs.resize(num_banks);
+  responseQueue.resize(num_banks);
   
   for (int bank = 0; bank < num_banks; bank++) {
     readInBufs[bank].resize(num_upstreams);   // 每个bank有num_upstreams个读队列
     writeInBufs[bank].resize(num_upstreams);  // 每个bank有num_upstreams个写队列
+    responseQueue[bank].resize(num_upstreams); // 每个bank有num_upstreams个响应队列
   }
 }
 
@@ -147,10 +158,16 @@ bool DramArb::recvTimingReqUp(PacketPtr pkt, int bank_id, int upstream_id) {
   assert(upstream_id >= 0 && upstream_id < num_upstreams);
   
   // 检查是否可以接受新请求
-  bool can_accept_read = nbrOutstandingReads[bank_id] + responseQueue[bank_id].size() < buf_size;
+  bool can_accept_read = nbrOutstandingReads[bank_id] + nbrQueuedResps[bank_id] < buf_size;
   
   bool accepted = false;
   
+  // 标记请求来自哪个上游，供 DRAMsim3 做分请求者统计；
+  // 已由地址交织单元标记过的包保留原编号
+  if (pkt->getRequester() < 0) {
+    pkt->setRequester(upstream_id);
+  }
+
   if (pkt->isRead()) {
     // 处理读请求
     if (can_accept_read) {
@@ -190,7 +207,7 @@ bool DramArb::recvTimingReqUp(PacketPtr pkt, int bank_id, int upstream_id) {
     
     D_INFO("DRAM_ARB", "拒绝请求: bank=%d, upstream=%d, 读计数=%d, 响应队列=%d", 
            bank_id, upstream_id, nbrOutstandingReads[bank_id], 
-           responseQueue[bank_id].size());
+           nbrQueuedResps[bank_id]);
     return false;
   }
 }
@@ -234,8 +251,9 @@ bool DramArb::recvTimingResp(PacketPtr pkt, int bank_id) {
 }
 
 void DramArb::accessAndRespond(int bank_id, PacketPtr pkt, int upstream_id) {
-  // 将响应包和对应的上游编号放入响应队列
-  responseQueue[bank_id].push_back({pkt, upstream_id});
+  // 将响应包放入对应 (bank, upstream) 的响应队列
+  responseQueue[bank_id][upstream_id].push_back(pkt);
+  ++nbrQueuedResps[bank_id];
   
   D_INFO("DRAM_ARB", "准备响应: addr=%d, bank=%d, upstream=%d", 
          pkt->getAddr(), bank_id, upstream_id);
@@ -249,45 +267,85 @@ void DramArb::accessAndRespond(int bank_id, PacketPtr pkt, int upstream_id) {
 }
 
 void DramArb::sendResponse() {
-  // 遍历所有bank和上游，尝试发送响应
+  // 新的周期：重置各上游链路的响应预算
+  if (respBudgetTick != curTick()) {
+    respBudgetTick = curTick();
+    std::fill(respSentUp.begin(), respSentUp.end(), 0);
+  }
+  
+  // 每个上游链路独立发送，互不阻塞
+  for (int upstream_id = 0; upstream_id < num_upstreams; upstream_id++) {
+    sendResponseUp(upstream_id);
+  }
+  
+  // 还有未被阻塞的响应（预算用完），下一周期继续；
+  // 被阻塞的队列等待对应上游的 recvRespRetry
+  if (hasSendableResponse() && !sendResponseEvent.scheduled()) {
+    schedule(sendResponseEvent, curTick() + 1);
+  }
+}
+
+bool DramArb::sendResponseUp(int upstream_id) {
+  bool sent_any = false;
+  bool progress = true;
+  
+  // 按 bank 轮询，每轮每个 bank 最多发一个，直到预算用完或没有可发送的响应
+  while (progress) {
+    progress = false;
+    int start = rrRespBank[upstream_id];
+    for (int k = 0; k < num_banks; k++) {
+      if (resp_per_cycle > 0 && respSentUp[upstream_id] >= resp_per_cycle) {
+        return sent_any;
+      }
+      int bank = (start + k) % num_banks;
+      auto &queue = responseQueue[bank][upstream_id];
+      // 该队列为空或正在等待重试，跳过
+      if (queue.empty() || retryResp[bank][upstream_id]) {
+        continue;
+      }
+      
+      PacketPtr pkt = queue.front();
+      if (responsePorts[bank][upstream_id].sendTimingResp(pkt)) {
+        // 发送成功，从队列中移除
+        queue.pop_front();
+        --nbrQueuedResps[bank];
+        ++respSentUp[upstream_id];
+        rrRespBank[upstream_id] = (bank + 1) % num_banks;
+        sent_any = true;
+        progress = true;
+        
+        // 该 bank 腾出了缓冲空间，唤醒被拒绝过的上游
+        wakeBlockedRequests(bank);
+      } else {
+        // 发送失败：只阻塞这一个 (bank, upstream) 队列
+        D_DEBUG("DRAM_ARB", "响应发送失败: bank=%d, upstream=%d", bank, upstream_id);
+        retryResp[bank][upstream_id] = true;
+      }
+    }
+  }
+  return sent_any;
+}
+
+void DramArb::wakeBlockedRequests(int bank) {
+  for (int up = 0; up < num_upstreams; up++) {
+    if (retryReq[bank][up]) {
+      // 先清标志：上游可能在 sendRetryReq 中立即重发并再次被拒绝
+      retryReq[bank][up] = false;
+      D_INFO("DRAM_ARB", "发送重试信号: bank=%d, upstream=%d", bank, up);
+      responsePorts[bank][up].sendRetryReq();
+    }
+  }
+}
+
+bool DramArb::hasSendableResponse() const {
   for (int bank = 0; bank < num_banks; bank++) {
-    for (int upstream_id = 0; upstream_id < num_upstreams; upstream_id++) {
-      // 检查该上游是否在等待重试
-      if (!retryResp[bank][upstream_id]) {
-        // 检查是否有待发送的响应
-        if (!responseQueue[bank].empty()) {
-          auto &front = responseQueue[bank].front();
-          PacketPtr pkt = front.first;
-          int target_upstream = front.second;  // 响应要发送到的上游
-          
-          // 尝试发送响应
-          bool success = responsePorts[bank][target_upstream].sendTimingResp(pkt);
-          
-          if (success) {
-            // 发送成功，从队列中移除
-            responseQueue[bank].pop_front();
-            
-            // 如果还有更多响应，继续调度
-            if (!responseQueue[bank].empty() && !sendResponseEvent.scheduled()) {
-              schedule(sendResponseEvent, curTick() + 1);
-            }
-            
-            // 如果该上游在等待重试，发送重试信号
-            if (retryReq[bank][upstream_id]) {
-              responsePorts[bank][target_upstream].sendRetryReq();
-              retryReq[bank][upstream_id] = false;
-              
-              D_INFO("DRAM_ARB", "发送重试信号: bank=%d, upstream=%d", bank, upstream_id);
-            }
-          } else {
-            // 发送失败，设置重试标志
-            D_DEBUG("DRAM_ARB", "响应发送失败: bank=%d, upstream=%d", bank, upstream_id);
-            retryResp[bank][upstream_id] = true;
-          }
-        }
+    for (int up = 0; up < num_upstreams; up++) {
+      if (!responseQueue[bank][up].empty() && !retryResp[bank][up]) {
+        return true;
       }
     }
   }
+  return false;
 }
 
 void DramArb::handleRespRetry(int bank_id, int upstream_id) {
@@ -296,7 +354,7 @@ void DramArb::handleRespRetry(int bank_id, int upstream_id) {
   
   D_INFO("DRAM_ARB", "收到响应重试: bank=%d, upstream=%d", bank_id, upstream_id);
   
-  // 清除重试标志，重新尝试发送
+  // 只重新开放被阻塞的这个队列，重新尝试发送
   retryResp[bank_id][upstream_id] = false;
   sendResponse();
 }
@@ -31,7 +31,9 @@ public:
   static constexpr int num_banks = 8;
   static constexpr int num_up = 5;
   // 多上游数量可配置，默认1保持兼容
-  DramArb(const std::string &_name, int buf_size, int num_upstreams_ = 1);
+  // resp_per_cycle: 每个上游链路每周期最多返回的响应数（<=0 表示不限）
+  DramArb(const std::string &_name, int buf_size, int num_upstreams_ = 1,
+          int resp_per_cycle_ = num_banks);
   void init() override {}
   // CAM表：addr -> 多个等待响应的请求
   std::unordered_map<addr_t, std::queue<PacketPtr>> outstandingReads[num_banks];
@@ -96,7 +98,10 @@ private:
   // 发送响应事件
   EventFunctionWrapper sendResponseEvent;
   EventFunctionWrapper arbEvent;
-  std::deque<std::pair<PacketPtr, int>> responseQueue[num_banks];
+  // 响应虚拟输出队列：按 [bank][upstream] 分开，避免某个上游阻塞时
+  // 同一 bank 上其他上游的响应被队头阻塞
+  std::vector<std::vector<std::deque<PacketPtr>>> responseQueue;
+  unsigned int nbrQueuedResps[num_banks]; // 每个bank排队中的响应总数（流控用）
   int buf_size;
   bool retryReq[num_banks][num_up];  // 记录每个bank是否等待发送请求的重试
   bool retryResp[num_banks][num_up]; // 记录每个bank是否等待发送响应的重试
@@ -104,6 +109,11 @@ private:
   // 每个 bank 的读/写轮询起点，实现多上游公平仲裁
   std::vector<int> rrReadIdx;  // size = num_banks
   std::vector<int> rrWriteIdx; // size = num_banks
+  // 响应返回路径带宽：每个上游链路每周期的响应预算
+  int resp_per_cycle;
+  Tick respBudgetTick;           // 预算所属的周期
+  std::vector<int> respSentUp;   // 本周期各上游已发送的响应数
+  std::vector<int> rrRespBank;   // 每个上游响应的 bank 轮询起点
   // 记录每个读请求的来源上游（与 outstandingReads 同步）
   std::unordered_map<addr_t, std::queue<int>> outstandingUpstream[num_banks];
 
@@ -116,6 +126,9 @@ private:
   bool arbitrateReadRequests(int bank);
   bool arbitrateWriteRequests(int bank);
   bool checkPendingRequests(int bank);
+  bool sendResponseUp(int upstream_id);
+  void wakeBlockedRequests(int bank);
+  bool hasSendableResponse() const;
 };
 
 } // namespace GNN
@@ -10,9 +10,11 @@ DRAMsim3::DRAMsim3(const std::string &name_, int channel,
       sendResponseEvent([this] { sendResponse(); }, name()),
       tickEvent([this] { tick(); }, name()) {
   wrapper->set_read_callback(
-      channel_id, [this](addr_t addr,data_t data=0) { this->readComplete(addr); });
+      channel_id,
+      [this](uint64_t id, addr_t addr) { this->readComplete(id, addr); });
   wrapper->set_write_callback(
-      channel_id, [this](addr_t addr,data_t data=0) { this->writeComplete(addr); });
+      channel_id,
+      [this](uint64_t id, addr_t addr) { this->writeComplete(id, addr); });
   // Register a callback to compensate for the destructor not
   // being called. The callback prints the DRAMsim3 stats.
   // registerExitCallback([this]() { wrapper->printStats(); });
@@ -67,19 +69,22 @@ bool DRAMsim3::recvTimingReq(PacketPtr pkt) {
   bool can_accept = wrapper->can_accept(pkt->getAddr(), pkt->isWrite());
   if (!pkt->isWrite()) {
     if (can_accept) {
-      outstandingReads[pkt->getAddr()].push(pkt);
       ++nbrOutstandingReads;
     }
   } else {
     if (can_accept) {
       outstandingWrites[pkt->getAddr()].push(pkt);
+      pendingWriteData[pkt->getAddr()].push_back(pkt->get_data());
       ++nbrOutstandingWrites;
       pendingDelete.reset(pkt);
     }
   }
   // D_DEBUG("DRAM_SIM3", "can_accept: %d", can_accept);
   if (can_accept) {
-    wrapper->send_request(pkt->getAddr(), pkt->isWrite());
+    // 写包马上会被释放，id 只对读有意义
+    wrapper->send_request(pkt->getAddr(), pkt->isWrite(),
+                          reinterpret_cast<uintptr_t>(pkt),
+                          pkt->getRequester());
     return true;
   } else {
     schedule(tickEvent, curTick() + 1);
@@ -108,29 +113,34 @@ void DRAMsim3::accessAndRespond(PacketPtr pkt) {
   }
 }
 
-void DRAMsim3::readComplete(addr_t addr,data_t data) {
+void DRAMsim3::readComplete(uint64_t id, addr_t addr) {
   D_INFO("DRAM_SIM3", "[Recv DRAMSIM3],channel_id: %d,readComplete addr: %d",
           channel_id, addr);
-  // get the outstanding reads for the address in question
-  auto p = outstandingReads.find(addr);
-  assert(p != outstandingReads.end());
-  // first in first out, which is not necessarily true, but it is
-  // the best we can do at this point
-  PacketPtr pkt = p->second.front();
-  p->second.pop();
-  if (p->second.empty())
-    outstandingReads.erase(p);
+  // id 即发送时的读包，合并的同地址读也各自带回自己的包
+  PacketPtr pkt = reinterpret_cast<PacketPtr>(id);
+  assert(pkt->getAddr() == addr);
 
   // no need to check for drain here as the next call will add a
   // response to the response queue straight away
   assert(nbrOutstandingReads != 0);
   --nbrOutstandingReads;
 
+  // 填充负载：同地址还有未完成的写（DRAMsim3 从写缓冲直接返回读），
+  // 取最新的写数据，否则从后备存储读
+  auto w = pendingWriteData.find(addr);
+  if (w != pendingWriteData.end()) {
+    std::vector<uint32_t> data = w->second.back();
+    data.resize((pkt->getSize() + sizeof(uint32_t) - 1) / sizeof(uint32_t));
+    pkt->setData(data);
+  } else {
+    wrapper->backing_store().fillPacket(pkt);
+  }
+
   // perform the actual memory access
   accessAndRespond(pkt);
 }
 
-void DRAMsim3::writeComplete(addr_t addr,data_t data) {
+void DRAMsim3::writeComplete(uint64_t id, addr_t addr) {
 
   auto p = outstandingWrites.find(addr);
   assert(p != outstandingWrites.end());
@@ -138,6 +148,14 @@ void DRAMsim3::writeComplete(addr_t addr,data_t data) {
   p->second.pop();
   if (p->second.empty())
     outstandingWrites.erase(p);
+
+  // 写完成：按接受顺序把负载提交到后备存储
+  auto w = pendingWriteData.find(addr);
+  assert(w != pendingWriteData.end());
+  wrapper->backing_store().commit(addr, w->second.front());
+  w->second.pop_front();
+  if (w->second.empty())
+    pendingWriteData.erase(w);
   assert(nbrOutstandingWrites != 0);
   --nbrOutstandingWrites;
 }
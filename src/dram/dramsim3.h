@@ -2,6 +2,7 @@
 #define __MEM_DRAMSIM3_HH__
 
 #include <functional>
+#include <deque>
 #include <queue>
 #include <unordered_map>
 #include <vector>
@@ -54,9 +55,11 @@ class DRAMsim3:  public SimObject{
     bool retryResp;
     // 记录 wrapper 启动时刻
     cycle_t startTick;
-    // 记录每个地址未完成的读写事务队列
-    std::unordered_map<addr_t, std::queue<PacketPtr> > outstandingReads;
+    // 读请求以包指针作为 DRAMsim3 请求 id，完成时直接取回包，无需按地址
+    // 排队；写包接受后即释放，仍按地址记录未完成的写
     std::unordered_map<addr_t, std::queue<PacketPtr> > outstandingWrites;
+    // 写请求负载的快照：写包被接受后可能已被释放，完成时再提交到后备存储
+    std::unordered_map<addr_t, std::deque<std::vector<uint32_t>> > pendingWriteData;
     // 统计未完成的事务数，用于流控
     unsigned int nbrOutstandingReads;
     unsigned int nbrOutstandingWrites;
@@ -81,9 +84,9 @@ class DRAMsim3:  public SimObject{
 
     DRAMsim3(const std::string &name_, int channel, dramsim3_wrapper* wrapper);
     // 读完成回调
-    void readComplete( addr_t addr,data_t data=0);
+    void readComplete(uint64_t id, addr_t addr);
     // 写完成回调
-    void writeComplete( addr_t addr,data_t data=0);
+    void writeComplete(uint64_t id, addr_t addr);
 
     void startup() ;
     void resetStats() ;
@@ -7,15 +7,19 @@
  * @Description: 这是默认设置,请设置`customMade`, 打开koroFileHeader查看配置 进行设置: https://github.com/OBKoro1/koro1FileHeader/wiki/%E9%85%8D%E7%BD%AE
  */
 #include "dramsim3_wrapper.h"
+#include <limits>
 namespace GNN
 {
     void dramsim3_wrapper::print_stats()
     {
+        // 事件驱动时模型时钟可能停在最后一个事件，先补齐周期统计
+        if (event_driven)
+            sync_to(curTick() - tick_base);
         memory_system_1->PrintStats();
     } // dramsim3 print_stats
     void dramsim3_wrapper::init()
     {
-
+        tick_base = curTick();
         schedule(tickEvent, curTick());
     }
     void dramsim3_wrapper::reset_stats()
@@ -23,16 +27,26 @@ namespace GNN
         memory_system_1->ResetStats();
     } // dramsim3 reset_stats
 
-    bool dramsim3_wrapper::can_accept(uint64_t addr, bool is_write)
+    bool dramsim3_wrapper::can_accept(uint64_t addr, bool is_write) const
     {
+        // 只查询不推进：tickEvent 先于同一时刻的请求执行，队列占用只在事件
+        // 周期变化，模型停在哪个空闲周期都与当前周期一致
         return memory_system_1->WillAcceptTransaction(addr, is_write);
     } // dramsim3 willAcceptTransaction
 
-    void dramsim3_wrapper::send_request(uint64_t addr, bool is_write)
+    void dramsim3_wrapper::send_request(uint64_t addr, bool is_write, uint64_t id,
+                                        int requester)
     {
-
-        bool success = memory_system_1->AddTransaction(addr, is_write);
+        // 与逐周期推进一致：当前周期先推进完，请求从下一个周期开始生效；
+        // 本周期的事件已由 tickEvent 处理，这里补齐其后没有事件的空闲周期
+        if (event_driven)
+            sync_to(curTick() - tick_base + 1);
+        bool success = memory_system_1->AddTransaction(addr, is_write, id,
+                                                      requester);
         assert(success);
+        // 新请求的完成事件可能早于已安排的唤醒时刻
+        if (event_driven)
+            schedule_next_tick();
     } // dramsim3 add read trans
 
     unsigned int dramsim3_wrapper::get_busrt_length() const
@@ -50,16 +64,91 @@ namespace GNN
         return 1 / (memory_system_1->GetTCK());
     } // dramsim3 get 1/TCK
 
-    unsigned int dramsim3_wrapper::get_channel(address_t addr) const
+    unsigned int dramsim3_wrapper::get_channel(uint64_t addr) const
     {
         return memory_system_1->GetChannel(addr);
     }
 
     void dramsim3_wrapper::tick()
     {
+        if (event_driven)
+        {
+            // 处理当前周期的事件，然后睡到下一个事件
+            sync_to(curTick() - tick_base + 1);
+            schedule_next_tick();
+            return;
+        }
+        if (tick_batch <= 1)
+        {
+            memory_system_1->ClockTick();
+            ++dram_clk;
+            if (!tickEvent.scheduled())
+                schedule(tickEvent, curTick() + 1);
+            return;
+        }
+
+        // 一次推进 tick_batch 个周期，完成的事务按其完成周期折算回仿真时刻
+        done_batch.clear();
+        memory_system_1->ClockTicks(tick_batch, done_batch);
+        for (const auto &done : done_batch)
+        {
+            pendingDone.push_back({curTick() + (done.cycle - dram_clk), done.addr,
+                                   done.id, done.channel, done.is_write});
+        }
+        dram_clk += tick_batch;
+        if (!pendingDone.empty() && !deliverEvent.scheduled())
+            schedule(deliverEvent, pendingDone.front().when);
+        if (!tickEvent.scheduled())
+            schedule(tickEvent, curTick() + tick_batch);
+    }
 
-        memory_system_1->ClockTick();
-        if(!tickEvent.scheduled())
-        schedule(tickEvent, curTick() + 1);
+    void dramsim3_wrapper::sync_to(uint64_t cycle)
+    {
+        uint64_t clk = memory_system_1->Clk();
+        if (cycle <= clk)
+            return;
+        // 唤醒时刻保证 cycle 之前没有未处理的完成事件，回调不会迟到；
+        // 回调中可能再次发送请求，因此用局部缓冲
+        std::vector<dramsim3::DoneTransaction> done;
+        memory_system_1->ClockTicks(cycle - clk, done);
+        dram_clk = cycle;
+        for (const auto &d : done)
+        {
+            if (d.is_write)
+                global_write_callback(d.id, d.addr, d.channel);
+            else
+                global_read_callback(d.id, d.addr, d.channel);
+        }
+    }
+
+    void dramsim3_wrapper::schedule_next_tick()
+    {
+        uint64_t next = memory_system_1->NextEventCycle();
+        if (next == std::numeric_limits<uint64_t>::max())
+            return; // 没有未完成的事务，等下一次 send_request
+        Tick when = tick_base + next;
+        if (tickEvent.scheduled())
+        {
+            if (tickEvent.when() <= when)
+                return;
+            deschedule(tickEvent);
+        }
+        schedule(tickEvent, when);
+    }
+
+    void dramsim3_wrapper::deliver_done()
+    {
+        // 与逐周期推进时相同：按周期、同周期内按通道顺序回调
+        while (!pendingDone.empty() && pendingDone.front().when <= curTick())
+        {
+            PendingDone done = pendingDone.front();
+            pendingDone.pop_front();
+            if (done.is_write)
+                global_write_callback(done.id, done.addr, done.channel);
+            else
+                global_read_callback(done.id, done.addr, done.channel);
+        }
+        if (!pendingDone.empty())
+            schedule(deliverEvent, pendingDone.front().when);
     }
 }
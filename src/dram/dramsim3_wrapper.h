@@ -1,9 +1,11 @@
 #ifndef DRAMSIM3_WRAPPER
 #define DRAMSIM3_WRAPPER
 #include "buffer/buffer.h"
+#include "dram/backing_store.h"
 #include <iostream>
 #include <stdexcept>
 #include <vector>
+#include <deque>
 #include <functional>
 #include <unordered_map>
 #include "define.h"
@@ -26,63 +28,87 @@ namespace GNN
 
         std::ofstream trace_out_file_;
 
-        bool vld4repeate_ch[CHANNEL_NUM][64];
-        bool channle_vld[CHANNEL_NUM] = {false};
-
         bool is_ch_rd_send[CHANNEL_NUM] = {false};
         bool is_ch_wr_send[CHANNEL_NUM] = {false};
 
-        // 事件驱动集成：记录每个请求地址等待的Buffer
-        std::unordered_map<uint64_t, Buffer *> waitingAddrToBuf;
+        // 多通道回调，id 为 send_request 时给出的请求标识。负载由通道侧处理：
+        // 读完成时从后备存储填充数据包，写在接受时保存、完成时提交，回调不带数据
+        std::vector<std::function<void(uint64_t, addr_t)>> read_callbacks;
+        std::vector<std::function<void(uint64_t, addr_t)>> write_callbacks;
 
-        // 多通道回调
-        std::vector<std::function<void(addr_t,data_t)>> read_callbacks;
-        std::vector<std::function<void(addr_t,data_t)>> write_callbacks;
+        // 批量推进：每 tick_batch 个周期同步一次 DRAMsim3，完成的事务
+        // 按 (周期, 通道) 顺序缓存，到对应的 tick 再回调
+        struct PendingDone
+        {
+            Tick when;
+            uint64_t addr;
+            uint64_t id;
+            int channel;
+            bool is_write;
+        };
+        int tick_batch = 1;
+        uint64_t dram_clk = 0;
+        std::vector<dramsim3::DoneTransaction> done_batch;
+        std::deque<PendingDone> pendingDone;
+        void deliver_done();
+
+        // 事件驱动：只在下一个完成/发射/刷新事件的周期唤醒 tickEvent，
+        // 发送请求前先把模型时钟追到当前时刻。DRAM 周期 c 对应仿真时刻
+        // tick_base + c。INI [system] memory_model = ANALYTIC 时默认开启
+        bool event_driven = false;
+        Tick tick_base = 0;
+        void sync_to(uint64_t cycle);
+        void schedule_next_tick();
+
+        // 功能性后备存储：读/写完成时填充/提交数据包负载
+        BackingStore store;
 
     public:
         int cycle_num;
         void init() override;
         dramsim3::MemorySystem *memory_system_1;
 
-        dramsim3_wrapper(const std::string &config_file, const std::string &output_dir, const std::string &trace_out_file) : SimObject("dramsim3_wrapper"), tickEvent([this]
-                                                                                                                                                                      { tick(); }, name())
+        // config_cache_dir: Config 二进制缓存目录（见 DRAMsim3 README 的 Config cache），为空时每次解析 INI
+        dramsim3_wrapper(const std::string &config_file, const std::string &output_dir, const std::string &trace_out_file,
+                         const std::string &config_cache_dir = "") : SimObject("dramsim3_wrapper"), tickEvent([this]
+                                                                                                                                                                      { tick(); }, name(), false, tick_pri),
+                                                                                                                                                                      deliverEvent([this]
+                                                                                                                                                                                   { deliver_done(); }, name() + ".deliverEvent")
         {
-            memory_system_1 = (new dramsim3::MemorySystem(config_file, output_dir,
-                                                          std::bind(&dramsim3_wrapper::global_read_callback, this, std::placeholders::_1),
-                                                          std::bind(&dramsim3_wrapper::global_write_callback, this, std::placeholders::_1)));
+            // 同一 INI 与输出目录的 Config 在进程内只解析一次，多个实例共享；
+            // 给出缓存目录时跨进程复用已解析的 Config
+            memory_system_1 = (new dramsim3::MemorySystem(dramsim3::Config::Shared(config_file, output_dir, config_cache_dir),
+                                                          [](uint64_t) {}, [](uint64_t) {}));
+            // 按请求 id 回调，DRAMsim3 同时给出服务的通道，无需按地址反查
+            memory_system_1->RegisterIdCallbacks(
+                std::bind(&dramsim3_wrapper::global_read_callback, this, std::placeholders::_1,
+                          std::placeholders::_2, std::placeholders::_3),
+                std::bind(&dramsim3_wrapper::global_write_callback, this, std::placeholders::_1,
+                          std::placeholders::_2, std::placeholders::_3));
+            event_driven = memory_system_1->GetConfig().memory_model ==
+                           dramsim3::MemoryModel::ANALYTIC;
             burst_length = memory_system_1->GetBurstLength();
             bandwidth = memory_system_1->GetQueueSize();
             frequency = 1 / (memory_system_1->GetTCK());
             std::cout << "burst_length:" << burst_length << " bandwidth:" << bandwidth << " frequency:" << frequency << std::endl;
-            for (int i = 0; i < CHANNEL_NUM; i++)
-            {
-                for (int j = 0; j < 64; j++)
-                {
-                    vld4repeate_ch[i][j] = false;
-                }
-            }
             read_callbacks.resize(CHANNEL_NUM);
             write_callbacks.resize(CHANNEL_NUM);
         }
-        void global_read_callback(uint64_t addr)
+        void global_read_callback(uint64_t id, uint64_t addr, int ch)
         {
-            data_t data = 0;
             // std::cout << "[Wrapper]    回调函数被触发！::" << addr<<std::endl;
-            int ch = this->get_channel(addr);
             if (read_callbacks[ch])
             {
                 //    std::cout << "[Wrapper]    回调函数被触发！ch:" << ch<<std::endl;
-                read_callbacks[ch](addr,data);
+                read_callbacks[ch](id, addr);
             }
         }
 
-        void global_write_callback(uint64_t addr)
+        void global_write_callback(uint64_t id, uint64_t addr, int ch)
         {
-           data_t data = 0;
-            int ch = this->get_channel(addr);
             if (write_callbacks[ch])
             {
-                write_callbacks[ch](addr,data);
+                write_callbacks[ch](id, addr);
             }
         }
         ~dramsim3_wrapper()
@@ -90,12 +116,12 @@ namespace GNN
         }
 
         // 注册回调
-        void set_read_callback(int channel, std::function<void(addr_t,data_t)> cb)
+        void set_read_callback(int channel, std::function<void(uint64_t, addr_t)> cb)
         {
             if (channel >= 0 && channel < CHANNEL_NUM)
                 read_callbacks[channel] = cb;
         }
-        void set_write_callback(int channel, std::function<void(addr_t,data_t)> cb)
+        void set_write_callback(int channel, std::function<void(uint64_t, addr_t)> cb)
         {
             if (channel >= 0 && channel < CHANNEL_NUM)
                 write_callbacks[channel] = cb;
@@ -105,63 +131,36 @@ namespace GNN
         {
         }
 
-        void request_read(uint64_t addr)
-        {
-
-            int ch = this->get_channel(addr);
-            std::cout << "[Wrapper]    回调函数被触发！" << std::endl;
-            // 1. 查表找到等待该地址的Buffer
-            auto it = waitingAddrToBuf.find(addr);
-            if (it != waitingAddrToBuf.end() && it->second)
-            {
-                Buffer *buf = it->second;
-
-                int data = rand() % 100;
-                // buf->DramDataReady(addr, data);
-                // 3. 清理登记
-                waitingAddrToBuf.erase(it);
-            }
-            else
-            {
-                // 没有登记，可能是bug或多余回调
-                std::cerr << "[dramsim3_wrapper] Warning: No Buffer waiting for addr " << addr << std::endl;
-            }
+        // tickEvent 排在同一时刻的其它事件之前：上游在某个时刻查询或发送请求时，
+        // 模型已处理完该周期及之前的所有事件，新请求总是从下一个周期开始生效
+        static const EventBase::Priority tick_pri = EventBase::Default_Pri - 1;
+        EventFunctionWrapper tickEvent;
+        EventFunctionWrapper deliverEvent;
 
-            //  std::cout << "read_call_back:" << "addr:" << addr << ", ch:" << ch << " clk:" << cycle_g << std::endl;
-            if (!channle_vld[ch])
-            {
-                channle_vld[ch] = true;
-            }
-            else
-            {
-                bool is_send = false;
-                for (int i = 0; i < 128; i++)
-                {
-                    if (!vld4repeate_ch[ch][i])
-                    {
-                        vld4repeate_ch[ch][i] = true;
-                        is_send = true;
-                        break;
-                    }
-                }
-                if (!is_send)
-                {
-                    throw std::invalid_argument("repeate full");
-                }
-            }
-        }
+        BackingStore &backing_store() { return store; }
 
-        EventFunctionWrapper tickEvent;
+        // 每次同步推进的周期数，1 为逐周期精确推进。大于 1 时控制器可在
+        // 工作线程上连续推进多个周期（见 INI [other] tick_threads），
+        // 代价是周期中途到达的请求最多晚 n 个周期生效
+        void set_tick_batch(int n) { tick_batch = n < 1 ? 1 : n; }
+        // JEDEC 模型也可事件驱动：控制器空闲时跳到下一个完成或刷新周期，
+        // 忙时仍逐周期推进。需在 init() 之前设置
+        void set_event_driven(bool on) { event_driven = on; }
 
         void print_stats();
         void reset_stats();
-        bool can_accept(uint64_t addr, bool is_write);
-        void send_request(uint64_t addr, bool is_write); // 已被替换
+        bool can_accept(uint64_t addr, bool is_write) const;
+        // id 原样回传给通道回调，用于精确匹配完成的请求；
+        // requester 为上游编号，INI [system] num_requesters 设为 DramArb
+        // 的上游数即可在统计中得到每个上游的延迟、带宽和行命中率
+        void send_request(uint64_t addr, bool is_write, uint64_t id,
+                          int requester = -1);
 
         unsigned int get_busrt_length() const;
         unsigned int get_bandwidth() const;
         double get_frequency() const;
-        unsigned int get_channel(address_t address) const;
+        unsigned int get_channel(uint64_t address) const;
+        const dramsim3::Config &get_config() const { return memory_system_1->GetConfig(); }
 
         unsigned int validate_dram_reads(address_t *read_address);
 
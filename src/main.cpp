@@ -12,6 +12,12 @@
 #include "buffer/UpBuffer.h"
 #include "dram/dram.h"
 #include "dram/dram_arb.h"
+#include "dram/addr_mapper.h"
+#include "noc/crossbar.h"
+#include "noc/crossbar_check.h"
+#include <cstring>
+#include <memory>
+#include <sys/stat.h>
 using namespace GNN;
 
 class PrintEvent : public Event
@@ -41,8 +47,38 @@ void forEachObject(void (SimObject::*mem_func)())
     }
 }
 
-int main()
+// 命令行：
+//   --noc=none|crossbar|mesh  地址交织单元与 DramArb 之间的片上互连（默认 none，直连）
+//   --check-noc               只运行 Crossbar 行为自检
+//   --check-spread            运行结束后检查交织是否覆盖所有 bank，未覆盖时返回 1
+//   --config-cache=<dir>      DRAMsim3 Config 二进制缓存目录（默认 ./output/config_cache，为空则关闭）
+int main(int argc, char **argv)
 {
+    std::string noc = "none";
+    std::string config_cache_dir = "./output/config_cache";
+    bool check_spread = false;
+    for (int i = 1; i < argc; ++i)
+    {
+        if (std::strncmp(argv[i], "--noc=", 6) == 0)
+            noc = argv[i] + 6;
+        else if (std::strncmp(argv[i], "--config-cache=", 15) == 0)
+            config_cache_dir = argv[i] + 15;
+        else if (std::strcmp(argv[i], "--check-spread") == 0)
+            check_spread = true;
+        else if (std::strcmp(argv[i], "--check-noc") == 0)
+            return runCrossbarCheck(std::cout) == 0 ? 0 : 1;
+        else
+        {
+            std::cerr << "未知参数: " << argv[i] << std::endl;
+            return 1;
+        }
+    }
+    if (noc != "none" && noc != "crossbar" && noc != "mesh")
+    {
+        std::cerr << "未知互连类型: " << noc << std::endl;
+        return 1;
+    }
+    const bool use_noc = noc != "none";
     const int num_banks = 8;
     const int buf_size = 10;
     const int num_upstreams = 4;
@@ -50,16 +86,37 @@ int main()
     std::string output_dir = ".";
     std::string trace_out_file = "./output/trace_out_file.txt";
     gSim = new EventQueue("main_queue");
-    dramsim3_wrapper *dramsim3_wrapper_ = new dramsim3_wrapper(config_file, output_dir, trace_out_file);
+    if (!config_cache_dir.empty())
+        mkdir(config_cache_dir.c_str(), 0755); // 已存在时忽略
+    dramsim3_wrapper *dramsim3_wrapper_ = new dramsim3_wrapper(config_file, output_dir, trace_out_file, config_cache_dir);
     miniDebugLevel = DBG_INFO;                                                                // 只显示 info 及以上
-    miniDebugModules = {"DRAM", "BUFFER", "DRAM_ARB", "DRAM_SIM3", "DRAM_WRAPPER", "EVENTQ"}; // 只显示这两个模块的日志
+    miniDebugModules = {"DRAM", "BUFFER", "DRAM_ARB", "DRAM_SIM3", "DRAM_WRAPPER", "EVENTQ", "ADDR_MAP"}; // 只显示这两个模块的日志
 
-    // 1. 创建 DramArb
-    DramArb dram_arb("dram_arb", buf_size, num_upstreams);
-    UpBuffer up_buffer_0("up_buffer_0", dramsim3_wrapper_, 0);
-    UpBuffer up_buffer_1("up_buffer_1", dramsim3_wrapper_, 16384);
-    UpBuffer up_buffer_2("up_buffer_2", dramsim3_wrapper_, 32768);
-    UpBuffer up_buffer_3("up_buffer_3", dramsim3_wrapper_, 49152);
+    // 1. 创建 DramArb：经过片上互连时每个通道只有互连一个上游
+    DramArb dram_arb("dram_arb", buf_size, use_noc ? 1 : num_upstreams);
+    // 地址交织单元：按 DRAMsim3 的真实映射把请求分发到对应通道
+    AddrMapper addr_mapper("addr_mapper", dramsim3_wrapper_, num_banks, num_upstreams,
+                           UpBuffer::num_ports, AddrMapper::InterleaveMode::XOR_HASH);
+    // 后备存储按原始地址组织，DRAM 侧看到的是交织后的地址
+    dramsim3_wrapper_->backing_store().setAddrTranslator(
+        [&addr_mapper](addr_t a) { return addr_mapper.unmap(a); });
+    // 每个上游 buffer 占 16KiB 地址窗口，远够不到行地址位：按实际访问范围选哈希源位
+    const addr_t up_window = 16384;
+    addr_mapper.setAddressRange(num_upstreams * up_window);
+    UpBuffer up_buffer_0("up_buffer_0", dramsim3_wrapper_, 0 * up_window);
+    UpBuffer up_buffer_1("up_buffer_1", dramsim3_wrapper_, 1 * up_window);
+    UpBuffer up_buffer_2("up_buffer_2", dramsim3_wrapper_, 2 * up_window);
+    UpBuffer up_buffer_3("up_buffer_3", dramsim3_wrapper_, 3 * up_window);
+    // 片上互连：每个 (通道, 上游) 的交织单元出口是一个请求方，每个通道是一个响应方
+    std::unique_ptr<Crossbar> noc_xbar;
+    if (use_noc)
+    {
+        noc_xbar.reset(new Crossbar("noc", num_banks * num_upstreams, num_banks, 1, 32, 4,
+                                    noc == "mesh" ? Crossbar::Topology::MESH2D
+                                                  : Crossbar::Topology::CROSSBAR));
+        // 交织单元已经重映射过地址，按 DRAMsim3 的通道号路由
+        noc_xbar->setRouteFn([&addr_mapper](addr_t a) { return addr_mapper.route(a); });
+    }
     std::vector<DRAMsim3 *> dramsim3_vec;
     for (int i = 0; i < num_banks; ++i)
     {
@@ -71,16 +128,25 @@ int main()
         port1.bind(port2);
         port2.bind(port1);
     };
-    // 绑定上游buffer到dram_arb的响应端口
+    // 绑定上游buffer到地址交织单元，再由交织单元按通道绑定到dram_arb的响应端口（或经片上互连）
+    std::vector<UpBuffer *> up_buffers = {&up_buffer_0, &up_buffer_1, &up_buffer_2, &up_buffer_3};
+    for (int up = 0; up < num_upstreams; ++up) {
+        for (int p = 0; p < UpBuffer::num_ports; ++p) {
+            bindPorts(up_buffers[up]->getPort("buf_side" + std::to_string(p)),
+                      addr_mapper.getPort("up_side" + std::to_string(p) + "_" + std::to_string(up)));
+        }
+    }
     for (int i = 0; i < num_banks; ++i) {
-        bindPorts(up_buffer_0.getPort("buf_side" + std::to_string(i)), 
-                  dram_arb.getPort("response" + std::to_string(i) + "_0"));
-        bindPorts(up_buffer_1.getPort("buf_side" + std::to_string(i)), 
-                  dram_arb.getPort("response" + std::to_string(i) + "_1"));
-        bindPorts(up_buffer_2.getPort("buf_side" + std::to_string(i)), 
-                  dram_arb.getPort("response" + std::to_string(i) + "_2"));
-        bindPorts(up_buffer_3.getPort("buf_side" + std::to_string(i)), 
-                  dram_arb.getPort("response" + std::to_string(i) + "_3"));
+        for (int up = 0; up < num_upstreams; ++up) {
+            Port &mem_side = addr_mapper.getPort("mem_side" + std::to_string(i) + "_" + std::to_string(up));
+            if (use_noc)
+                bindPorts(mem_side, noc_xbar->getPort("cpu_side" + std::to_string(up * num_banks + i)));
+            else
+                bindPorts(mem_side, dram_arb.getPort("response" + std::to_string(i) + "_" + std::to_string(up)));
+        }
+        if (use_noc)
+            bindPorts(noc_xbar->getPort("mem_side" + std::to_string(i)),
+                      dram_arb.getPort("response" + std::to_string(i) + "_0"));
         // 绑定dram_arb的请求端口到DRAM
         bindPorts(dram_arb.getPort("request" + std::to_string(i)), 
                   dramsim3_vec[i]->getPort("mem_side"));
@@ -93,7 +159,6 @@ int main()
     // }
     // 发送请求示例
 
-    int addr = 0;
     std::cout << "---- Simulation Start ----" << std::endl;
     while (!gSim->empty() && gSim->getCurTick() < 1000)
     {
@@ -101,6 +166,15 @@ int main()
         gSim->serviceOne();
     }
     std::cout << "---- Simulation End ----" << std::endl;
+    addr_mapper.printStats(std::cout);
+    if (use_noc)
+        noc_xbar->printStats(std::cout);
+    dramsim3_wrapper_->backing_store().printStats(std::cout);
+    // 显式要求时检查交织是否把流量分散到所有 bank（短仿真或小访问范围本就可能覆盖不全）
+    bool spread = addr_mapper.banksUsed() == addr_mapper.numBanks();
+    if (check_spread && !spread)
+        std::cerr << "地址交织未覆盖所有 bank: " << addr_mapper.banksUsed() << "/"
+                  << addr_mapper.numBanks() << std::endl;
     delete gSim;
-    return 0;
+    return check_spread && !spread ? 1 : 0;
 }
\ No newline at end of file
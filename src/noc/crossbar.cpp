@@ -0,0 +1,361 @@
+#include "noc/crossbar.h"
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <limits>
+#include <stdexcept>
+
+namespace GNN {
+
+namespace {
+constexpr Tick kNoEvent = std::numeric_limits<Tick>::max();
+// 网格链路方向
+enum MeshDir { EAST = 0, WEST = 1, SOUTH = 2, NORTH = 3 };
+} // namespace
+
+Crossbar::Crossbar(const std::string &_name, int num_requesters_,
+                   int num_responders_, Tick latency_, int flit_bytes_,
+                   int buf_size_, Topology topology_, int mesh_cols_)
+    : SimObject(_name), num_requesters(num_requesters_),
+      num_responders(num_responders_), latency(latency_),
+      flit_bytes(std::max(1, flit_bytes_)), buf_size(buf_size_),
+      topology(topology_), mesh_cols(mesh_cols_), mesh_rows(1),
+      statsStartTick(0), tickEvent([this] { tick(); }, _name + ".tickEvent") {
+  // 第一步：拓扑
+  if (topology == Topology::MESH2D) {
+    int nodes = std::max(num_requesters, num_responders);
+    if (mesh_cols <= 0) {
+      mesh_cols = static_cast<int>(std::ceil(std::sqrt((double)nodes)));
+    }
+    mesh_rows = (nodes + mesh_cols - 1) / mesh_cols;
+    meshLinks.resize(mesh_cols * mesh_rows);
+  }
+
+  // 第二步：默认按 64B 交织
+  setInterleave(64);
+
+  // 第三步：两个方向的虚拟输出队列
+  initDirection(reqDir, num_responders, num_requesters);
+  initDirection(respDir, num_requesters, num_responders);
+
+  // 第四步：创建端口
+  cpuPorts.reserve(num_requesters);
+  for (int i = 0; i < num_requesters; i++) {
+    cpuPorts.emplace_back(_name + ".cpu_side" + std::to_string(i), *this, i);
+  }
+  memPorts.reserve(num_responders);
+  for (int j = 0; j < num_responders; j++) {
+    memPorts.emplace_back(_name + ".mem_side" + std::to_string(j), *this, j);
+  }
+
+  D_INFO("XBAR", "Crossbar构造函数: %dx%d, latency=%d, flit=%dB, topology=%d",
+         num_requesters, num_responders, (int)latency, flit_bytes,
+         (int)topology);
+}
+
+void Crossbar::initDirection(Direction &dir, int num_out, int num_in) {
+  dir.voq.assign(num_out, std::vector<std::deque<Flit>>(num_in));
+  dir.linkFreeAt.assign(num_out, 0);
+  dir.outBlocked.assign(num_out, false);
+  dir.rrIdx.assign(num_out, 0);
+  dir.inBlocked.assign(num_out, std::vector<bool>(num_in, false));
+  dir.stats.assign(num_out, LinkStats());
+}
+
+void Crossbar::setInterleave(addr_t interleave_bytes) {
+  int n = num_responders;
+  routeFn = [interleave_bytes, n](addr_t addr) {
+    return static_cast<int>((addr / interleave_bytes) % n);
+  };
+}
+
+void Crossbar::init() {
+  for (auto &port : cpuPorts) {
+    if (!port.isConnected()) {
+      D_WARN("XBAR", "请求方端口未连接: %s", port.name().c_str());
+    }
+  }
+  for (auto &port : memPorts) {
+    if (!port.isConnected()) {
+      D_WARN("XBAR", "响应方端口未连接: %s", port.name().c_str());
+    }
+  }
+}
+
+Port &Crossbar::getPort(const std::string &if_name, int idx) {
+  // 端口名如 "cpu_side<requester>" / "mem_side<responder>"
+  try {
+    if (if_name.find("cpu_side") == 0) {
+      int id = std::stoi(if_name.substr(8));
+      if (id >= 0 && id < num_requesters)
+        return cpuPorts[id];
+    } else if (if_name.find("mem_side") == 0) {
+      int id = std::stoi(if_name.substr(8));
+      if (id >= 0 && id < num_responders)
+        return memPorts[id];
+    }
+  } catch (const std::invalid_argument &) {
+  }
+  throw std::runtime_error("未知端口名: " + if_name);
+}
+
+// ---------------- 拓扑 ----------------
+
+int Crossbar::requesterNode(int req_id) const { return req_id; }
+
+int Crossbar::responderNode(int resp_id) const {
+  // 通道均匀散布在网格上，与引擎共享路由器
+  int nodes = std::max(num_requesters, num_responders);
+  return static_cast<int>((int64_t)resp_id * nodes / num_responders);
+}
+
+int Crossbar::hops(int src_node, int dst_node) const {
+  return std::abs(src_node % mesh_cols - dst_node % mesh_cols) +
+         std::abs(src_node / mesh_cols - dst_node / mesh_cols);
+}
+
+Tick Crossbar::traversal(int req_id, int resp_id) const {
+  if (topology == Topology::CROSSBAR) {
+    return latency;
+  }
+  // 注入路由器本身也算一跳
+  return latency * (hops(requesterNode(req_id), responderNode(resp_id)) + 1);
+}
+
+void Crossbar::recordMeshPath(int src_node, int dst_node, int nflits,
+                              uint64_t bytes) {
+  // XY 路由：先走 X 再走 Y
+  int x = src_node % mesh_cols, y = src_node / mesh_cols;
+  int dx = dst_node % mesh_cols, dy = dst_node / mesh_cols;
+  auto record = [&](int dir) {
+    LinkStats &link = meshLinks[y * mesh_cols + x][dir];
+    link.busyCycles += nflits;
+    ++link.packets;
+    link.bytes += bytes;
+  };
+  while (x != dx) {
+    record(x < dx ? EAST : WEST);
+    x += x < dx ? 1 : -1;
+  }
+  while (y != dy) {
+    record(y < dy ? SOUTH : NORTH);
+    y += y < dy ? 1 : -1;
+  }
+}
+
+int Crossbar::flits(PacketPtr pkt) const {
+  int n = static_cast<int>((pkt->getSize() + flit_bytes - 1) / flit_bytes);
+  return std::max(1, n);
+}
+
+// ---------------- 请求/响应接收 ----------------
+
+bool Crossbar::recvTimingReq(PacketPtr pkt, int req_id) {
+  assert(req_id >= 0 && req_id < num_requesters);
+  int out = routeFn(pkt->getAddr());
+  assert(out >= 0 && out < num_responders);
+
+  auto &queue = reqDir.voq[out][req_id];
+  if ((int)queue.size() >= buf_size) {
+    reqDir.inBlocked[out][req_id] = true;
+    D_DEBUG("XBAR", "拒绝请求: requester=%d, responder=%d", req_id, out);
+    return false;
+  }
+
+  // 读请求登记来源，写请求下游不返回响应
+  if (pkt->isRead()) {
+    origins[pkt] = req_id;
+  }
+  Tick ready = curTick() + traversal(req_id, out);
+  queue.push_back({pkt, ready});
+  D_DEBUG("XBAR", "接受请求: addr=%d, requester=%d, responder=%d, ready=%d",
+          pkt->getAddr(), req_id, out, (int)ready);
+  scheduleTick(ready);
+  return true;
+}
+
+bool Crossbar::recvTimingResp(PacketPtr pkt, int resp_id) {
+  assert(resp_id >= 0 && resp_id < num_responders);
+  auto it = origins.find(pkt);
+  assert(it != origins.end());
+  int out = it->second;
+
+  auto &queue = respDir.voq[out][resp_id];
+  if ((int)queue.size() >= buf_size) {
+    respDir.inBlocked[out][resp_id] = true;
+    return false;
+  }
+  origins.erase(it);
+  Tick ready = curTick() + traversal(out, resp_id);
+  queue.push_back({pkt, ready});
+  scheduleTick(ready);
+  return true;
+}
+
+void Crossbar::handleReqRetry(int resp_id) {
+  reqDir.outBlocked[resp_id] = false;
+  scheduleTick(curTick());
+}
+
+void Crossbar::handleRespRetry(int req_id) {
+  respDir.outBlocked[req_id] = false;
+  scheduleTick(curTick());
+}
+
+// ---------------- 出口仲裁 ----------------
+
+void Crossbar::scheduleTick(Tick when) {
+  when = std::max(when, curTick());
+  if (tickEvent.scheduled()) {
+    if (tickEvent.when() <= when) {
+      return;
+    }
+    deschedule(tickEvent);
+  }
+  schedule(tickEvent, when);
+}
+
+void Crossbar::tick() {
+  Tick next = std::min(arbitrate(reqDir, true), arbitrate(respDir, false));
+  if (next != kNoEvent) {
+    // 同一周期内已处理过的出口，最早下一周期再仲裁
+    scheduleTick(std::max(next, curTick() + 1));
+  }
+}
+
+Tick Crossbar::arbitrate(Direction &dir, bool is_req) {
+  Tick now = curTick();
+  Tick next = kNoEvent;
+  int num_out = dir.voq.size();
+
+  for (int out = 0; out < num_out; out++) {
+    auto &inputs = dir.voq[out];
+    int num_in = inputs.size();
+
+    // 链路空闲且未被下游阻塞：轮询选出一个已到达出口的包
+    if (!dir.outBlocked[out] && dir.linkFreeAt[out] <= now) {
+      for (int k = 0; k < num_in; k++) {
+        int in = (dir.rrIdx[out] + k) % num_in;
+        if (inputs[in].empty() || inputs[in].front().ready > now) {
+          continue;
+        }
+        PacketPtr pkt = inputs[in].front().pkt;
+        if (!sendOut(dir, is_req, out, in, pkt)) {
+          // 下游拒绝：整个出口等待重试
+          dir.outBlocked[out] = true;
+          break;
+        }
+        inputs[in].pop_front();
+        dir.rrIdx[out] = (in + 1) % num_in;
+        // 腾出了队列空间，唤醒被拒绝过的输入
+        wakeInput(dir, is_req, out, in);
+        break;
+      }
+    }
+
+    // 计算该出口下一次可以发送的时刻
+    if (dir.outBlocked[out]) {
+      continue;
+    }
+    for (int in = 0; in < num_in; in++) {
+      if (!inputs[in].empty()) {
+        next = std::min(next,
+                        std::max(inputs[in].front().ready, dir.linkFreeAt[out]));
+      }
+    }
+  }
+  return next;
+}
+
+bool Crossbar::sendOut(Direction &dir, bool is_req, int out, int in,
+                       PacketPtr pkt) {
+  // 先取出包信息：发送成功后包可能已被下游释放（如写请求）
+  uint64_t bytes = pkt->getSize();
+  int nflits = flits(pkt);
+
+  bool ok = is_req ? memPorts[out].sendTimingReq(pkt)
+                   : cpuPorts[out].sendTimingResp(pkt);
+  if (!ok) {
+    return false;
+  }
+
+  dir.linkFreeAt[out] = curTick() + nflits;
+  LinkStats &link = dir.stats[out];
+  link.busyCycles += nflits;
+  ++link.packets;
+  link.bytes += bytes;
+  if (topology == Topology::MESH2D) {
+    if (is_req) {
+      recordMeshPath(requesterNode(in), responderNode(out), nflits, bytes);
+    } else {
+      recordMeshPath(responderNode(in), requesterNode(out), nflits, bytes);
+    }
+  }
+  return true;
+}
+
+void Crossbar::wakeInput(Direction &dir, bool is_req, int out, int in) {
+  if (!dir.inBlocked[out][in]) {
+    return;
+  }
+  // 先清标志：对端可能在重试回调中立即重发并再次被拒绝
+  dir.inBlocked[out][in] = false;
+  if (is_req) {
+    cpuPorts[in].sendRetryReq();
+  } else {
+    memPorts[in].sendRetryResp();
+  }
+}
+
+// ---------------- 统计 ----------------
+
+void Crossbar::printLinks(std::ostream &os, const char *prefix,
+                          const std::vector<LinkStats> &links,
+                          double elapsed) const {
+  for (size_t i = 0; i < links.size(); i++) {
+    const LinkStats &link = links[i];
+    double util = elapsed > 0 ? 100.0 * link.busyCycles / elapsed : 0.0;
+    os << "  " << prefix << std::setw(2) << i << " packets=" << std::setw(8)
+       << link.packets << " bytes=" << std::setw(10) << link.bytes
+       << " util=" << std::fixed << std::setprecision(1) << std::setw(5)
+       << util << "%" << std::defaultfloat << std::endl;
+  }
+}
+
+void Crossbar::printStats(std::ostream &os) const {
+  double elapsed = static_cast<double>(curTick() - statsStartTick);
+  os << "---- Crossbar link utilisation (" << num_requesters << "x"
+     << num_responders << ", " << elapsed << " cycles) ----" << std::endl;
+  printLinks(os, "req->mem", reqDir.stats, elapsed);
+  printLinks(os, "resp->cpu", respDir.stats, elapsed);
+
+  if (topology != Topology::MESH2D) {
+    return;
+  }
+  // 网格链路：只打印有流量的链路
+  static const char *dir_names[4] = {"E", "W", "S", "N"};
+  for (int node = 0; node < (int)meshLinks.size(); node++) {
+    for (int d = 0; d < 4; d++) {
+      const LinkStats &link = meshLinks[node][d];
+      if (link.packets == 0) {
+        continue;
+      }
+      double util = elapsed > 0 ? 100.0 * link.busyCycles / elapsed : 0.0;
+      os << "  mesh(" << node % mesh_cols << "," << node / mesh_cols << ")."
+         << dir_names[d] << " packets=" << link.packets
+         << " util=" << std::fixed << std::setprecision(1) << util << "%"
+         << std::defaultfloat << std::endl;
+    }
+  }
+}
+
+void Crossbar::resetStats() {
+  std::fill(reqDir.stats.begin(), reqDir.stats.end(), LinkStats());
+  std::fill(respDir.stats.begin(), respDir.stats.end(), LinkStats());
+  for (auto &links : meshLinks) {
+    links.fill(LinkStats());
+  }
+  statsStartTick = curTick();
+}
+
+} // namespace GNN
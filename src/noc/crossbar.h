@@ -0,0 +1,150 @@
+#ifndef CROSSBAR_H
+#define CROSSBAR_H
+
+#include "common/debug.h"
+#include "common/object.h"
+#include "common/packet.h"
+#include "common/port.h"
+#include "event/eventq.h"
+#include <array>
+#include <deque>
+#include <functional>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace GNN {
+
+// 片上互连：N 个请求方（计算引擎）× M 个响应方（存储通道）。
+// 每个输出链路独立仲裁（轮询），输入按 [输出][输入] 分虚拟输出队列，
+// 避免队头阻塞。包按 flit 宽度拆分，占用输出链路 ceil(size/flit) 个周期。
+// MESH2D 模式下请求方/响应方挂在二维网格节点上，延迟按 XY 路由跳数计，
+// 经过的每条网格链路都记录占用；竞争只在出口链路上建模。
+class Crossbar : public SimObject {
+public:
+  enum class Topology {
+    CROSSBAR, // 单级全互连，固定延迟
+    MESH2D    // 二维网格，延迟 = 跳数 × 每跳延迟
+  };
+
+  // 请求路由：地址 -> 响应方编号
+  using RouteFn = std::function<int(addr_t)>;
+
+  // latency: 全互连的穿越延迟，或网格每跳延迟（周期）
+  // flit_bytes: 链路宽度（字节/周期）
+  // buf_size: 每个虚拟输出队列的深度
+  // mesh_cols: 网格列数（<=0 时取能放下所有节点的最小方阵）
+  Crossbar(const std::string &_name, int num_requesters_, int num_responders_,
+           Tick latency_ = 1, int flit_bytes_ = 32, int buf_size_ = 4,
+           Topology topology_ = Topology::CROSSBAR, int mesh_cols_ = 0);
+  void init() override;
+  Port &getPort(const std::string &if_name, int idx = -1) override;
+
+  // 默认按 interleave_bytes 粒度在响应方之间交织
+  void setRouteFn(RouteFn fn) { routeFn = fn; }
+  void setInterleave(addr_t interleave_bytes);
+
+  void printStats(std::ostream &os) const;
+  void resetStats();
+
+  // 请求方侧端口：引擎的请求端口绑定于此
+  class CpuSidePort : public ResponsePort {
+    Crossbar &xbar;
+    int req_id;
+
+  public:
+    CpuSidePort(const std::string &name, Crossbar &_xbar, int _req_id)
+        : ResponsePort(name), xbar(_xbar), req_id(_req_id) {}
+    bool recvTimingReq(PacketPtr pkt) override {
+      return xbar.recvTimingReq(pkt, req_id);
+    }
+    void recvRespRetry() override { xbar.handleRespRetry(req_id); }
+  };
+  // 响应方侧端口：绑定到存储通道的响应端口
+  class MemSidePort : public RequestPort {
+    Crossbar &xbar;
+    int resp_id;
+
+  public:
+    MemSidePort(const std::string &name, Crossbar &_xbar, int _resp_id)
+        : RequestPort(name), xbar(_xbar), resp_id(_resp_id) {}
+    bool recvTimingResp(PacketPtr pkt) override {
+      return xbar.recvTimingResp(pkt, resp_id);
+    }
+    void recvReqRetry() override { xbar.handleReqRetry(resp_id); }
+  };
+
+  std::vector<CpuSidePort> cpuPorts; // [requester]
+  std::vector<MemSidePort> memPorts; // [responder]
+
+  bool recvTimingReq(PacketPtr pkt, int req_id);
+  bool recvTimingResp(PacketPtr pkt, int resp_id);
+  void handleReqRetry(int resp_id);
+  void handleRespRetry(int req_id);
+
+private:
+  // 队列中的包及其到达出口的时刻
+  struct Flit {
+    PacketPtr pkt;
+    Tick ready;
+  };
+  // 链路统计
+  struct LinkStats {
+    uint64_t busyCycles = 0;
+    uint64_t packets = 0;
+    uint64_t bytes = 0;
+  };
+  // 一个方向的出口：每个输出链路从多个输入的虚拟输出队列中轮询选择
+  struct Direction {
+    std::vector<std::vector<std::deque<Flit>>> voq; // [output][input]
+    std::vector<Tick> linkFreeAt;                   // 输出链路空闲时刻
+    std::vector<bool> outBlocked;                   // 等待下游重试
+    std::vector<int> rrIdx;                         // 轮询起点
+    std::vector<std::vector<bool>> inBlocked;       // [output][input] 被拒绝
+    std::vector<LinkStats> stats;                   // [output]
+  };
+
+  int num_requesters;
+  int num_responders;
+  Tick latency;
+  int flit_bytes;
+  int buf_size;
+  Topology topology;
+  int mesh_cols;
+  int mesh_rows;
+  RouteFn routeFn;
+
+  Direction reqDir;  // 请求方 -> 响应方，输出为响应方
+  Direction respDir; // 响应方 -> 请求方，输出为请求方
+  // 读请求的来源请求方，用于响应回送
+  std::unordered_map<PacketPtr, int> origins;
+
+  // 网格链路占用：[node][dir]，dir 为 东/西/南/北
+  std::vector<std::array<LinkStats, 4>> meshLinks;
+  Tick statsStartTick;
+
+  EventFunctionWrapper tickEvent;
+
+  void tick();
+  void scheduleTick(Tick when);
+  // 对一个方向做一轮出口仲裁，返回下一次需要处理的时刻（无则返回 Tick 最大值）
+  Tick arbitrate(Direction &dir, bool is_req);
+  bool sendOut(Direction &dir, bool is_req, int out, int in, PacketPtr pkt);
+  void wakeInput(Direction &dir, bool is_req, int out, int in);
+  int flits(PacketPtr pkt) const;
+
+  // 拓扑
+  int requesterNode(int req_id) const;
+  int responderNode(int resp_id) const;
+  int hops(int src_node, int dst_node) const;
+  Tick traversal(int req_id, int resp_id) const;
+  void recordMeshPath(int src_node, int dst_node, int nflits, uint64_t bytes);
+  void initDirection(Direction &dir, int num_out, int num_in);
+  void printLinks(std::ostream &os, const char *prefix,
+                  const std::vector<LinkStats> &links, double elapsed) const;
+};
+
+} // namespace GNN
+
+#endif
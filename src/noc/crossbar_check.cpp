@@ -0,0 +1,292 @@
+#include "noc/crossbar_check.h"
+#include "noc/crossbar.h"
+#include <deque>
+#include <functional>
+#include <memory>
+#include <vector>
+
+namespace GNN {
+
+namespace {
+
+// 测试请求方：把排队的包尽快发出，被拒绝后等待 recvReqRetry
+class CheckRequester : public SimObject {
+public:
+  struct Arrival {
+    addr_t addr;
+    Tick tick;
+  };
+
+  class ReqPort : public RequestPort {
+    CheckRequester &owner;
+
+  public:
+    ReqPort(const std::string &name, CheckRequester &_owner)
+        : RequestPort(name), owner(_owner) {}
+    bool recvTimingResp(PacketPtr pkt) override {
+      owner.responses.push_back({pkt->getAddr(), curTick()});
+      PacketManager::free_packet(pkt);
+      return true;
+    }
+    void recvReqRetry() override {
+      ++owner.retries;
+      owner.blocked = false;
+      owner.trySend();
+    }
+  };
+
+  explicit CheckRequester(const std::string &_name)
+      : SimObject(_name), port(_name + ".port", *this),
+        sendEvent([this] { trySend(); }, _name + ".sendEvent") {}
+  Port &getPort(const std::string &if_name, int idx = -1) override {
+    return port;
+  }
+
+  void push(PacketPtr pkt) { pending.push_back(pkt); }
+  void start(Tick when) { schedule(sendEvent, when); }
+
+  ReqPort port;
+  std::deque<PacketPtr> pending;
+  std::vector<Arrival> responses;
+  bool blocked = false;
+  int rejects = 0;
+  int retries = 0;
+
+private:
+  EventFunctionWrapper sendEvent;
+
+  void trySend() {
+    while (!blocked && !pending.empty()) {
+      if (!port.sendTimingReq(pending.front())) {
+        ++rejects;
+        blocked = true;
+        return;
+      }
+      pending.pop_front();
+    }
+  }
+};
+
+// 测试响应方：最多缓存 capacity 个请求，每 service 个周期处理一个；
+// 读请求原包返回，写请求直接释放。满时拒绝，腾出空间后发重试
+class CheckResponder : public SimObject {
+public:
+  class RespPort : public ResponsePort {
+    CheckResponder &owner;
+
+  public:
+    RespPort(const std::string &name, CheckResponder &_owner)
+        : ResponsePort(name), owner(_owner) {}
+    bool recvTimingReq(PacketPtr pkt) override {
+      return owner.recvTimingReq(pkt);
+    }
+    void recvRespRetry() override { owner.sendResponses(); }
+  };
+
+  CheckResponder(const std::string &_name, size_t _capacity, Tick _service)
+      : SimObject(_name), port(_name + ".port", *this), capacity(_capacity),
+        service(_service),
+        serviceEvent([this] { serve(); }, _name + ".serviceEvent") {}
+  Port &getPort(const std::string &if_name, int idx = -1) override {
+    return port;
+  }
+
+  RespPort port;
+  std::vector<CheckRequester::Arrival> arrivals;
+  int refused = 0;
+
+private:
+  size_t capacity;
+  Tick service;
+  bool needRetry = false;
+  std::deque<PacketPtr> queue;
+  std::deque<PacketPtr> respQueue;
+  EventFunctionWrapper serviceEvent;
+
+  bool recvTimingReq(PacketPtr pkt) {
+    if (queue.size() >= capacity) {
+      ++refused;
+      needRetry = true;
+      return false;
+    }
+    arrivals.push_back({pkt->getAddr(), curTick()});
+    queue.push_back(pkt);
+    if (!serviceEvent.scheduled()) {
+      schedule(serviceEvent, curTick() + service);
+    }
+    return true;
+  }
+
+  void serve() {
+    PacketPtr pkt = queue.front();
+    queue.pop_front();
+    if (pkt->isRead()) {
+      respQueue.push_back(pkt);
+      sendResponses();
+    } else {
+      PacketManager::free_packet(pkt);
+    }
+    if (needRetry) {
+      needRetry = false;
+      port.sendRetryReq();
+    }
+    if (!queue.empty() && !serviceEvent.scheduled()) {
+      schedule(serviceEvent, curTick() + service);
+    }
+  }
+
+  void sendResponses() {
+    while (!respQueue.empty() && port.sendTimingResp(respQueue.front())) {
+      respQueue.pop_front();
+    }
+  }
+};
+
+void bindPorts(Port &port1, Port &port2) {
+  port1.bind(port2);
+  port2.bind(port1);
+}
+
+// 在独立的事件队列上运行一项检查，结束后恢复全局队列并撤下本项的对象
+bool runCheck(std::ostream &os, const char *name,
+              const std::function<bool(std::ostream &)> &body) {
+  EventQueue *saved = gSim;
+  size_t num_objects = SimObject::simObjectList.size();
+  gSim = new EventQueue(name);
+  bool ok = body(os);
+  delete gSim;
+  gSim = saved;
+  SimObject::simObjectList.resize(num_objects);
+  os << (ok ? "[PASS] " : "[FAIL] ") << name << std::endl;
+  return ok;
+}
+
+void runUntil(Tick limit) {
+  while (!gSim->empty() && gSim->getCurTick() < limit) {
+    gSim->serviceOne();
+  }
+}
+
+PacketPtr writePacket(addr_t addr) {
+  // 8 字节负载，占一个 flit
+  return PacketManager::create_write_packet(addr, std::vector<uint32_t>(8));
+}
+
+// 反压：VOQ 满时拒绝请求方，下游拒绝时出口挂起，
+// 两级重试之后所有包按序送达
+bool checkBackpressure(std::ostream &os) {
+  const int num_pkts = 6;
+  Crossbar xbar("xbar", 1, 1, 1, 32, 2);
+  CheckRequester req("req");
+  CheckResponder mem("mem", 1, 8);
+  bindPorts(req.getPort("port"), xbar.getPort("cpu_side0"));
+  bindPorts(xbar.getPort("mem_side0"), mem.getPort("port"));
+
+  for (int i = 0; i < num_pkts; i++) {
+    req.push(writePacket(i * 64));
+  }
+  req.start(0);
+  runUntil(1000);
+
+  bool ok = (int)mem.arrivals.size() == num_pkts && req.pending.empty() &&
+            req.rejects > 0 && req.retries == req.rejects && mem.refused > 0;
+  for (int i = 0; ok && i < num_pkts; i++) {
+    ok = mem.arrivals[i].addr == (addr_t)(i * 64);
+  }
+  os << "  delivered=" << mem.arrivals.size() << "/" << num_pkts
+     << " requester_rejects=" << req.rejects << " retries=" << req.retries
+     << " downstream_refused=" << mem.refused << std::endl;
+  return ok;
+}
+
+// 公平性：4 个请求方同时压满同一出口，出口每周期一个包且严格轮询
+bool checkRoundRobin(std::ostream &os) {
+  const int num_req = 4;
+  const int per_req = 8;
+  Crossbar xbar("xbar", num_req, 1, 1, 32, 4);
+  xbar.setRouteFn([](addr_t) { return 0; });
+  std::vector<std::unique_ptr<CheckRequester>> reqs;
+  CheckResponder mem("mem", num_req * per_req, 1);
+  for (int r = 0; r < num_req; r++) {
+    reqs.emplace_back(new CheckRequester("req" + std::to_string(r)));
+    bindPorts(reqs[r]->getPort("port"),
+              xbar.getPort("cpu_side" + std::to_string(r)));
+    // 地址高位记录请求方编号
+    for (int i = 0; i < per_req; i++) {
+      reqs[r]->push(writePacket(r * 4096 + i * 64));
+    }
+    reqs[r]->start(0);
+  }
+  bindPorts(xbar.getPort("mem_side0"), mem.getPort("port"));
+  runUntil(1000);
+
+  bool ok = (int)mem.arrivals.size() == num_req * per_req;
+  for (size_t k = 0; ok && k < mem.arrivals.size(); k++) {
+    int r = static_cast<int>(mem.arrivals[k].addr / 4096);
+    ok = r == (int)(k % num_req) &&
+         mem.arrivals[k].tick == mem.arrivals[0].tick + k;
+  }
+  os << "  delivered=" << mem.arrivals.size() << "/" << num_req * per_req;
+  if (!mem.arrivals.empty()) {
+    os << " first=" << mem.arrivals.front().tick
+       << " last=" << mem.arrivals.back().tick;
+  }
+  os << std::endl;
+  return ok;
+}
+
+// MESH2D：2x2 网格、每跳 3 周期，请求方 0 访问 0/1/2 跳外的通道，
+// 单程延迟为 3 × (跳数 + 1)，响应沿原路返回
+bool checkMeshLatency(std::ostream &os) {
+  const Tick hop = 3;
+  Crossbar xbar("xbar", 4, 4, hop, 32, 4, Crossbar::Topology::MESH2D, 2);
+  std::vector<std::unique_ptr<CheckRequester>> reqs;
+  std::vector<std::unique_ptr<CheckResponder>> mems;
+  for (int i = 0; i < 4; i++) {
+    reqs.emplace_back(new CheckRequester("req" + std::to_string(i)));
+    mems.emplace_back(new CheckResponder("mem" + std::to_string(i), 4, 1));
+    bindPorts(reqs[i]->getPort("port"),
+              xbar.getPort("cpu_side" + std::to_string(i)));
+    bindPorts(xbar.getPort("mem_side" + std::to_string(i)),
+              mems[i]->getPort("port"));
+  }
+  // 默认 64B 交织：地址 64*j 落在通道 j，节点 j 位于 (j%2, j/2)
+  const int targets[3] = {0, 1, 3};
+  const int hops[3] = {0, 1, 2};
+  for (int t : targets) {
+    reqs[0]->push(PacketManager::create_read_packet(t * 64, 64));
+  }
+  reqs[0]->start(0);
+  runUntil(1000);
+
+  bool ok = reqs[0]->responses.size() == 3;
+  for (int k = 0; k < 3; k++) {
+    Tick one_way = hop * (hops[k] + 1);
+    auto &arrivals = mems[targets[k]]->arrivals;
+    ok = ok && arrivals.size() == 1 && arrivals[0].tick == one_way;
+    // 响应方 1 周期后返回，再经过同样的跳数
+    bool found = false;
+    for (auto &resp : reqs[0]->responses) {
+      found |= resp.addr == (addr_t)(targets[k] * 64) &&
+               resp.tick == 2 * one_way + 1;
+    }
+    ok = ok && found;
+    os << "  channel " << targets[k] << " hops=" << hops[k] << " arrive="
+       << (arrivals.empty() ? -1 : (long long)arrivals[0].tick)
+       << " expect=" << one_way << std::endl;
+  }
+  return ok;
+}
+
+} // namespace
+
+int runCrossbarCheck(std::ostream &os) {
+  os << "---- Crossbar Check ----" << std::endl;
+  int failed = 0;
+  failed += !runCheck(os, "voq backpressure/retry", checkBackpressure);
+  failed += !runCheck(os, "round-robin fairness", checkRoundRobin);
+  failed += !runCheck(os, "mesh2d hop latency", checkMeshLatency);
+  return failed;
+}
+
+} // namespace GNN
@@ -0,0 +1,14 @@
+#ifndef CROSSBAR_CHECK_H
+#define CROSSBAR_CHECK_H
+
+#include <ostream>
+
+namespace GNN {
+
+// Crossbar 行为自检：VOQ 反压与重试、出口轮询公平性、MESH2D 跳数延迟。
+// 每项在独立的事件队列上运行，结果写入 os，返回失败项数。
+int runCrossbarCheck(std::ostream &os);
+
+} // namespace GNN
+
+#endif